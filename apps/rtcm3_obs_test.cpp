@@ -0,0 +1,199 @@
+/**
+ *  Function:
+ *  check Rtcm3ObsDecoder with a short MSM capture
+ *
+ *  test/rtcm/msm_short.rtcm3 holds 4 epochs, 10 h apart from GPS week
+ *  2190 518400 s, so the last one is in the next week:
+ *
+ *   - GPS G05/G12 (1C, 2W), MSM7 at epochs 0 and 2, MSM4 at 1 and 3;
+ *     the lock time of G12 decreases at epoch 2
+ *   - GLONASS R07 (1C, frequency number +1 in MSM7), MSM7 and MSM4 as
+ *     GPS; half-cycle ambiguity at epoch 1
+ *   - BDS C19 (2I), MSM4, the last message of each epoch
+ */
+
+// System
+#include <iostream>
+#include <string>
+#include <cmath>
+
+// 命令行参数解析
+#include "OptionUtil.hpp"
+
+#include "Rtcm3ObsDecoder.hpp"
+#include "GPSWeekSecond.hpp"
+#include "StringUtils.hpp"
+
+using namespace std;
+using namespace gnssSpace;
+using namespace utilSpace;
+
+// number of failed checks
+static int numFailed(0);
+
+static void check(bool ok, const string& what)
+{
+    if (!ok)
+    {
+        cout << "failed: " << what << endl;
+        numFailed++;
+    }
+}
+
+// the type is in the epoch, with the given LLI
+static void checkType( Rx3ObsData& obsData, const SatID& sat,
+                       const string& type, double lli, const string& epoch )
+{
+    TypeID typeID(type);
+    string what = epoch + " " + sat.toString() + " " + type;
+
+    satTypeValueMap::iterator it = obsData.stvData.find(sat);
+    if (it == obsData.stvData.end() ||
+        it->second.find(typeID) == it->second.end())
+    {
+        check(false, what + " is missing");
+        return;
+    }
+
+    check(obsData.stvDataLLI[sat][typeID] == lli, what + " LLI");
+}
+
+// the type is not in the epoch
+static void checkNoType( Rx3ObsData& obsData, const SatID& sat,
+                         const string& type, const string& epoch )
+{
+    TypeID typeID(type);
+    satTypeValueMap::iterator it = obsData.stvData.find(sat);
+    check( it == obsData.stvData.end() ||
+           it->second.find(typeID) == it->second.end(),
+           epoch + " " + sat.toString() + " " + type + " is not expected" );
+}
+
+int main(int argc, char* argv[])
+{
+    string helpInfo
+       =
+    "Usage: \n"
+    "  check the epochs, types and LLI decoded from a MSM capture \n"
+    "\n"
+    "required options:\n"
+    "  --rtcmFile <fileName>         test/rtcm/msm_short.rtcm3 \n"
+    "\n"
+    "optional options:\n"
+    "  --help                        Prints this help \n"
+    "\n";
+
+    // map for attribute/value data
+    OptionAttMap optAttData;
+    OptionValueMap optValData;
+
+    OptionAttribute rtcmAttribute(1, 0);
+    OptionAttribute helpAttribute(0, 0);
+
+    optAttData["--rtcmFile"] = rtcmAttribute;
+    optAttData["--help"] = helpAttribute;
+
+    parseOption(argc, argv, optAttData, optValData, helpInfo);
+
+    string rtcmFile;
+    if (optValData.find("--rtcmFile") != optValData.end())
+    {
+        rtcmFile = optValData["--rtcmFile"][0];
+    }
+    else
+    {
+        cerr << "--rtcmFile is required!" << endl;
+        exit(-1);
+    }
+
+    CommonTime firstTime
+        = GPSWeekSecond(2190, 518400.0, TimeSystem::GPS).convertToCommonTime();
+    firstTime.setTimeSystem(TimeSystem::GPS);
+
+    // only the first epoch is resolved with the reference time
+    Rtcm3ObsDecoder decoder;
+    decoder.setRefTime(firstTime);
+
+    int numEpochs(0);
+    try
+    {
+        numEpochs = decoder.loadFile(rtcmFile);
+    }
+    catch (Exception& e)
+    {
+        cerr << e << endl;
+        exit(-1);
+    }
+
+    check(numEpochs == 4, "4 epochs are expected");
+    check(decoder.getNumCrcErrors() == 0, "CRC errors");
+    check(decoder.header.glonassFreqNo[SatID(SatelliteSystem::GLONASS, 7)] == 1,
+          "R07 frequency number");
+
+    SatID g05(SatelliteSystem::GPS, 5);
+    SatID g12(SatelliteSystem::GPS, 12);
+    SatID r07(SatelliteSystem::GLONASS, 7);
+    SatID c19(SatelliteSystem::BDS, 19);
+
+    Rx3ObsData obsData;
+    int ep(0);
+    while (decoder.getEpoch(obsData))
+    {
+        string epoch = "epoch " + asString(ep);
+        bool isMsm7 = (ep % 2 == 0);
+
+        // GPS, GLONASS and BDS of an epoch have the same time
+        CommonTime expected(firstTime);
+        expected += 36000.0*ep;
+        check(std::fabs(obsData.currEpoch - expected) < 1.0e-6, epoch + " time");
+
+        check(obsData.stvData.size() == 4, epoch + " satellites");
+
+        // lock time of G12 decreases at epoch 2, half cycle of R07 at 1
+        checkType(obsData, g05, "C1CG", 0, epoch);
+        checkType(obsData, g05, "L1CG", 0, epoch);
+        checkType(obsData, g05, "S1CG", 0, epoch);
+        checkType(obsData, g05, "C2WG", 0, epoch);
+        checkType(obsData, g05, "L2WG", 0, epoch);
+        checkType(obsData, g12, "L1CG", (ep == 2) ? 1 : 0, epoch);
+        checkType(obsData, r07, "C1CR", 0, epoch);
+        checkType(obsData, r07, "L1CR", (ep == 1) ? 2 : 0, epoch);
+        checkType(obsData, c19, "C2IC", 0, epoch);
+        checkType(obsData, c19, "L2IC", 0, epoch);
+
+        // the dopplers are only in MSM7
+        if (isMsm7)
+        {
+            checkType(obsData, g05, "D1CG", 0, epoch);
+            checkType(obsData, r07, "D1CR", 0, epoch);
+        }
+        else
+        {
+            checkNoType(obsData, g05, "D1CG", epoch);
+            checkNoType(obsData, r07, "D1CR", epoch);
+        }
+        checkNoType(obsData, c19, "D2IC", epoch);
+
+        // rough range 70 ms + 100/1024 ms, fine pseudorange 1000 (MSM7)
+        // or 100 (MSM4) units
+        const double rangeMs = 299792458.0*0.001;
+        double c1 = (70.0 + 100.0/1024.0)*rangeMs
+                  + (isMsm7 ? 1000.0*std::pow(2.0, -29)
+                            : 100.0*std::pow(2.0, -24))*rangeMs;
+        check(std::fabs(obsData.stvData[g05][TypeID("C1CG")] - c1) < 1.0e-3,
+              epoch + " G05 C1CG value");
+
+        ep++;
+    }
+
+    check(ep == 4, "4 epochs are expected from getEpoch()");
+
+    if (numFailed > 0)
+    {
+        cout << numFailed << " checks failed" << endl;
+        return 1;
+    }
+
+    cout << "all checks passed" << endl;
+    return 0;
+}
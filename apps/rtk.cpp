@@ -18,6 +18,8 @@
 #include "ConfigReader.hpp"
 #include "Rx3NavStore.hpp"
 #include "Rx3ObsData.hpp"
+#include "Rx3ObsPrefetcher.hpp"
+#include "Rx3ObsEpochAligner.hpp"
 #include "ChooseOptimalTypes.hpp"
 #include "KeepSystems.hpp"
 #include "FilterCode.hpp"
@@ -64,6 +66,8 @@ int main(int argc,char* argv[])
     "optional options:\n"
     "  --help                        Prints this help \n"
     "  --outputFile <out_file>       output file name \n"
+    "  --mmapObs                     read obs files with the memory-mapped reader \n"
+    "  --prefetch                    decode epochs ahead in a reader thread \n"
     "\n"
     "Examples: "
     "   \n"
@@ -88,6 +92,8 @@ int main(int argc,char* argv[])
     OptionAttribute navAttribute(1, 1);
     OptionAttribute outAttribute(1, 0);
     OptionAttribute baseXYZAttribute(0, 0);
+    OptionAttribute mmapAttribute(0, 0);
+    OptionAttribute prefetchAttribute(0, 0);
     OptionAttribute helpAttribute(0, 0);
 
     /// define and insert
@@ -96,6 +102,8 @@ int main(int argc,char* argv[])
     optAttData["--baseXYZ"] = baseXYZAttribute;
     optAttData["--navFile"] = navAttribute;
     optAttData["--outputFile"] = outAttribute;
+    optAttData["--mmapObs"] = mmapAttribute;
+    optAttData["--prefetch"] = prefetchAttribute;
     optAttData["--help"] = helpAttribute;
 
     ///prase the options
@@ -106,6 +114,8 @@ int main(int argc,char* argv[])
     string roverObsFile;
     std::vector<string> navFileVec;
     string outputFile;
+    bool useMmap(false);
+    bool usePrefetch(false);
 
     ///--baseObsFile
     if (optValData.find("--baseObsFile") != optValData.end())
@@ -150,6 +160,18 @@ int main(int argc,char* argv[])
         exit(-1);
     }
 
+    ///--mmapObs
+    if (optValData.find("--mmapObs") != optValData.end())
+    {
+        useMmap = true;
+    }
+
+    ///--prefetch
+    if (optValData.find("--prefetch") != optValData.end())
+    {
+        usePrefetch = true;
+    }
+
     //===============================================================
     // now, Let's load configuration data from conf file
     //===============================================================
@@ -197,27 +219,30 @@ int main(int argc,char* argv[])
     ///>now, read nav files
     Rx3NavStore navStore;
 
-    for (auto f: navFileVec)
+    if (debug)
     {
-        if (debug)
+        for (auto f: navFileVec)
         {
             cout << "nav file:" << f << endl;
-
-
         }
+    }
 
-        try
-        {
-
-            navStore.loadFile(f);
+    // the files are parsed in parallel, then merged in their order
+    try
+    {
+        navStore.loadFiles(navFileVec);
+    }
+    catch (Exception &e)
+    {
+        cerr << e << endl;
+        cerr << "unknow error in read nav data" << endl;
+        exit(-1);
+    }
 
-        }
-        catch (Exception &e)
-        {
-            cerr << e << endl;
-            cerr << "unknow error in read nav data" << endl;
-            exit(-1);
-        }
+    if (debug)
+    {
+        cout << "duplicated eph:" << navStore.getNumDuplicates()
+             << " replaced eph:" << navStore.getNumReplaced() << endl;
     }
     cout<<"after nav load"<<endl;
 
@@ -298,6 +323,58 @@ int main(int argc,char* argv[])
     Triple rcvPosBase = rxHeaderBase.antennaPosition;
     rxDataBase.pHeader = &rxHeaderBase;
 
+    // map the obs files and continue reading after the headers
+    MappedFile rxMappedRover;
+    MappedFile rxMappedBase;
+    if (useMmap)
+    {
+        try
+        {
+            rxMappedRover.open(roverObsFile);
+            rxMappedRover.seek(rxStreamRover.tellg());
+            rxMappedBase.open(baseObsFile);
+            rxMappedBase.seek(rxStreamBase.tellg());
+        }
+        catch (Exception &e)
+        {
+            cerr << e << endl;
+            exit(-1);
+        }
+    }
+
+    // rover and base epochs within syncTolerance are processed together
+    double syncTolerance(5.0);
+
+    // epoch index, the rover and the base jump to firstEpoch
+    Rx3ObsEpochIndex rxIndexRover;
+    Rx3ObsEpochIndex rxIndexBase;
+    if (rxHeaderRover.version >= 3 && rxHeaderBase.version >= 3)
+    {
+        try
+        {
+            rxIndexRover.loadOrBuild(roverObsFile, rxHeaderRover);
+            rxIndexBase.loadOrBuild(baseObsFile, rxHeaderBase);
+            rxDataRover.pIndex = &rxIndexRover;
+            rxDataBase.pIndex = &rxIndexBase;
+
+            if (useMmap)
+            {
+                rxDataRover.seekTime(rxMappedRover, firstEpoch);
+                rxDataBase.seekTime(rxMappedBase, firstEpoch - syncTolerance);
+            }
+            else
+            {
+                rxDataRover.seekTime(rxStreamRover, firstEpoch);
+                rxDataBase.seekTime(rxStreamBase, firstEpoch - syncTolerance);
+            }
+        }
+        catch (Exception &e)
+        {
+            cerr << e << endl;
+            exit(-1);
+        }
+    }
+
 
     //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
     // the following classes are for rover and base station;
@@ -466,18 +543,58 @@ int main(int argc,char* argv[])
 
     PrintSols printSols(outStream);
 
+    // merge-join of the rover and base epochs
+    Rx3ObsEpochAligner epochAligner(syncTolerance);
+    if (useMmap)
+    {
+        epochAligner.addStream(rxDataRover, rxMappedRover);
+        epochAligner.addStream(rxDataBase, rxMappedBase);
+    }
+    else
+    {
+        epochAligner.addStream(rxDataRover, rxStreamRover);
+        epochAligner.addStream(rxDataBase, rxStreamBase);
+    }
+
+    // or the same alignment done ahead in a reader thread
+    Rx3ObsPrefetcher prefetcher(8, syncTolerance);
+    if (usePrefetch)
+    {
+        if (useMmap)
+        {
+            prefetcher.addStream(rxDataRover, rxMappedRover);
+            prefetcher.addStream(rxDataBase, rxMappedBase);
+        }
+        else
+        {
+            prefetcher.addStream(rxDataRover, rxStreamRover);
+            prefetcher.addStream(rxDataBase, rxStreamBase);
+        }
+        prefetcher.start();
+    }
+
     // now, let's process gnss data for curret station
     while (true)
     {
         ///////////////////////////////////////
         // data processing for rover station
         ///////////////////////////////////////
+        Rx3ObsEpochAligner::Status syncStatus;
         try
         {
-            rxStreamRover >> rxDataRover;
+            if (usePrefetch)
+                syncStatus = prefetcher.next();
+            else
+                syncStatus = epochAligner.next();
         }
-        catch (EndOfFile &e)
+        catch (Exception &e)
+        {
+            cerr << e << endl;
+            exit(-1);
+        }
+        if (syncStatus == Rx3ObsEpochAligner::End)
         {
+            cout << "end of file" << endl;
             break;
         }
 
@@ -563,15 +680,20 @@ int main(int argc,char* argv[])
         ///////////////////////////////////////
         // data processing for base station
         ///////////////////////////////////////
-        try
-        {
-            rxDataBase.readRecordByTime(rxStreamBase,currEpoch);
-        }
-        catch (EndOfFile &e)
+
+        // the rover epoch went through spp and the cycle-slip detection
+        // above, so the arcs have no gap when the base drops out
+        if (syncStatus == Rx3ObsEpochAligner::RoverOnly)
         {
-            cout << "end of file" << endl;
-            break;
-        }catch (bool &flag){
+            // no more base data
+            bool baseEnded = usePrefetch ? prefetcher.isEnded(1)
+                                         : epochAligner.isEnded(1);
+            if (baseEnded)
+            {
+                cout << "end of file" << endl;
+                break;
+            }
+
             cout<<"同步失败"<<endl;
             continue;
         }
@@ -689,11 +811,26 @@ int main(int argc,char* argv[])
 
     }
 
+    if (usePrefetch)
+    {
+        prefetcher.stop();
+        prefetcher.dumpStats(cout);
+    }
+
     // close streams
     rxStreamRover.close();
     rxStreamBase.close();
     outStream.close();
 
+    // heap chunks of the GDS node pools, constant after the first epochs
+    if (debug)
+    {
+        PoolStats poolStats = getPoolStats();
+        cout << "pool: heap chunks " << poolStats.heapAllocations
+             << " bytes " << poolStats.bytesReserved
+             << " nodes " << poolStats.nodeAllocations << endl;
+    }
+
     cout << "end of processing file:" << outputFile << endl;
     return 0;
 }
@@ -183,23 +183,30 @@ int main(int argc,char* argv[])
     ///>now, read nav files
     Rx3NavStore navStore;
 
-    for (auto f: navFileVec)
+    if (debug)
     {
-        if (debug)
+        for (auto f: navFileVec)
         {
             cout << "nav file:" << f << endl;
         }
+    }
 
-        try
-        {
-            navStore.loadFile(f);
-        }
-        catch (Exception &e)
-        {
-            cerr << e << endl;
-            cerr << "unknow error in read nav data" << endl;
-            exit(-1);
-        }
+    // the files are parsed in parallel, then merged in their order
+    try
+    {
+        navStore.loadFiles(navFileVec);
+    }
+    catch (Exception &e)
+    {
+        cerr << e << endl;
+        cerr << "unknow error in read nav data" << endl;
+        exit(-1);
+    }
+
+    if (debug)
+    {
+        cout << "duplicated eph:" << navStore.getNumDuplicates()
+             << " replaced eph:" << navStore.getNumReplaced() << endl;
     }
     cout<<"after nav load"<<endl;
 
@@ -18,6 +18,7 @@
 #include "ConfigReader.hpp"
 #include "Rx3NavStore.hpp"
 #include "Rx3ObsData.hpp"
+#include "Rx3ObsPrefetcher.hpp"
 #include "ChooseOptimalTypes.hpp"
 #include "KeepSystems.hpp"
 #include "FilterCode.hpp"
@@ -56,6 +57,8 @@ int main(int argc,char* argv[])
     "optional options:\n"
     "  --help                        Prints this help \n"
     "  --outputFile <out_file>       output file name \n"
+    "  --mmapObs                     read obs file with the memory-mapped reader \n"
+    "  --prefetch                    decode epochs ahead in a reader thread \n"
     "\n"
     "Examples: "
     "   \n"
@@ -74,12 +77,16 @@ int main(int argc,char* argv[])
     OptionAttribute obsAttribute(1, 0);
     OptionAttribute navAttribute(1, 1);
     OptionAttribute outAttribute(1, 0);
+    OptionAttribute mmapAttribute(0, 0);
+    OptionAttribute prefetchAttribute(0, 0);
     OptionAttribute helpAttribute(0, 0);
 
     /// define and insert
     optAttData["--obsFile"] = obsAttribute;
     optAttData["--navFile"] = navAttribute;
     optAttData["--outputFile"] = outAttribute;
+    optAttData["--mmapObs"] = mmapAttribute;
+    optAttData["--prefetch"] = prefetchAttribute;
     optAttData["--help"] = helpAttribute;
 
     ///prase the options
@@ -89,6 +96,8 @@ int main(int argc,char* argv[])
     string obsFile;
     std::vector<string> navFileVec;
     string outputFile;
+    bool useMmap(false);
+    bool usePrefetch(false);
 
     ///--obsFile
     if (optValData.find("--obsFile") != optValData.end())
@@ -122,6 +131,18 @@ int main(int argc,char* argv[])
         exit(-1);
     }
 
+    ///--mmapObs
+    if (optValData.find("--mmapObs") != optValData.end())
+    {
+        useMmap = true;
+    }
+
+    ///--prefetch
+    if (optValData.find("--prefetch") != optValData.end())
+    {
+        usePrefetch = true;
+    }
+
     //===============================================================
     // now, Let's load configuration data from conf file
     //===============================================================
@@ -170,23 +191,30 @@ int main(int argc,char* argv[])
     ///>now, read nav files
     Rx3NavStore navStore;
 
-    for (auto f: navFileVec)
+    if (debug)
     {
-        if (debug)
+        for (auto f: navFileVec)
         {
             cout << "nav file:" << f << endl;
         }
+    }
 
-        try
-        {
-            navStore.loadFile(f);
-        }
-        catch (Exception &e)
-        {
-            cerr << e << endl;
-            cerr << "unknow error in read nav data" << endl;
-            exit(-1);
-        }
+    // the files are parsed in parallel, then merged in their order
+    try
+    {
+        navStore.loadFiles(navFileVec);
+    }
+    catch (Exception &e)
+    {
+        cerr << e << endl;
+        cerr << "unknow error in read nav data" << endl;
+        exit(-1);
+    }
+
+    if (debug)
+    {
+        cout << "duplicated eph:" << navStore.getNumDuplicates()
+             << " replaced eph:" << navStore.getNumReplaced() << endl;
     }
     cout<<"after nav load"<<endl;
 
@@ -218,6 +246,22 @@ int main(int argc,char* argv[])
         cout << "after read rxHeader" << endl;
     }
 
+    // map the obs file and continue reading after the header
+    MappedFile rxMapped;
+    if (useMmap)
+    {
+        try
+        {
+            rxMapped.open(obsFile);
+            rxMapped.seek(rxStream.tellg());
+        }
+        catch (Exception &e)
+        {
+            cerr << e << endl;
+            exit(-1);
+        }
+    }
+
     ChooseOptimalTypes chooseOptimalTypes;
     SysTypesMap sysPrioriTypes = chooseOptimalTypes.get(rxHeader.mapObsTypes);
 
@@ -252,6 +296,28 @@ int main(int argc,char* argv[])
     // set the header pointer to rxData for data reading.
     rxData.pHeader = &rxHeader;
 
+    // jump to firstEpoch with the epoch index instead of reading
+    // all the records before it
+    Rx3ObsEpochIndex rxIndex;
+    if (rxHeader.version >= 3)
+    {
+        try
+        {
+            rxIndex.loadOrBuild(obsFile, rxHeader);
+            rxData.pIndex = &rxIndex;
+
+            if (useMmap)
+                rxData.seekTime(rxMapped, firstEpoch);
+            else
+                rxData.seekTime(rxStream, firstEpoch);
+        }
+        catch (Exception &e)
+        {
+            cerr << e << endl;
+            exit(-1);
+        }
+    }
+
     // keep satellite system for positioning
     KeepSystems keepSystems(system);
 
@@ -375,6 +441,17 @@ int main(int argc,char* argv[])
     PrintSols printSppSols(sppOutStream);
     printSppSols.printHeader();
 
+    // decode epochs ahead in a reader thread
+    Rx3ObsPrefetcher prefetcher(8);
+    if (usePrefetch)
+    {
+        if (useMmap)
+            prefetcher.addStream(rxData, rxMapped);
+        else
+            prefetcher.addStream(rxData, rxStream);
+        prefetcher.start();
+    }
+
     // now, let's process gnss data for curret station
     bool firstTime(true);
     while (true)
@@ -385,7 +462,18 @@ int main(int argc,char* argv[])
             // read data
             try
             {
-                rxStream >> rxData;
+                if (usePrefetch)
+                {
+                    if (prefetcher.next() == Rx3ObsEpochAligner::End)
+                    {
+                        cout << "end of file" << endl;
+                        break;
+                    }
+                }
+                else if (useMmap)
+                    rxData.readRecord(rxMapped);
+                else
+                    rxStream >> rxData;
             }
             catch (EndOfFile &e)
             {
@@ -552,9 +640,24 @@ int main(int argc,char* argv[])
         }
     }
 
+    if (usePrefetch)
+    {
+        prefetcher.stop();
+        prefetcher.dumpStats(cout);
+    }
+
     // close streams
     rxStream.close();
 
+    // heap chunks of the GDS node pools, constant after the first epochs
+    if (debug)
+    {
+        PoolStats poolStats = getPoolStats();
+        cout << "pool: heap chunks " << poolStats.heapAllocations
+             << " bytes " << poolStats.bytesReserved
+             << " nodes " << poolStats.nodeAllocations << endl;
+    }
+
     cout << "end of processing file:" << outputFile << endl;
     return 0;
 }
@@ -88,44 +88,59 @@ namespace gnssSpace
         return drift;
     }
 
-    // Compute satellite relativity correction (sec) at the given time
-    // throw Invalid Request if the required data has not been stored.
-    double BDSEphemeris::svRelativity(const CommonTime& t) const
+    // Compute the orbit constants of this ephemeris into oc
+    void BDSEphemeris::computeOrbitConstants(KeplerOrbitConst& oc) const
     {
         WGS84Ellipsoid ell;
+
         ///Semi-major axis
-        double A = sqrt_A*sqrt_A;
+        oc.A = sqrt_A*sqrt_A;
+
+        ///Corrected mean motion (rad/sec)
+        double n0 = std::sqrt(ell.gm()/(oc.A*oc.A*oc.A));
+        oc.n = n0 + Delta_n;
+
+        oc.q = std::sqrt(1.0 - ecc*ecc);
+        oc.dlkFactor = sqrt_A * oc.q * std::sqrt(ell.gm());
+
+        ///Longitude of ascending node at the start of the week
+        oc.OMEGA_t0 = OMEGA_0 - ell.angVelocity() * Toe;
+        oc.OMEGA_rate = OMEGA_DOT - ell.angVelocity();
 
-        ///Computed mean motion (rad/sec)
-        double n0 = std::sqrt(ell.gm()/(A*A*A));
+        oc.relFactor = REL_CONST_BDS * ecc * std::sqrt(oc.A);
+
+        oc.valid = true;
+    }
+
+    void BDSEphemeris::setOrbitConstants()
+    {
+        computeOrbitConstants(orbConst);
+    }
+
+    const KeplerOrbitConst& BDSEphemeris::orbitConstants(KeplerOrbitConst& tmp) const
+    {
+        if(orbConst.valid) return orbConst;
+
+        computeOrbitConstants(tmp);
+        return tmp;
+    }
+
+    // Compute satellite relativity correction (sec) at the given time
+    // throw Invalid Request if the required data has not been stored.
+    double BDSEphemeris::svRelativity(const CommonTime& t) const
+    {
+        KeplerOrbitConst tmpConst;
+        const KeplerOrbitConst& oc = orbitConstants(tmpConst);
 
         ///Time from ephemeris reference epoch
         double tk = t - ctToe;
         if(tk > 302400)  tk = tk-604800;
         if(tk < -302400) tk = tk+604800;
 
-        ///Corrected mean motion
-        double n = n0 + Delta_n;
-
-        ///Mean anomaly
-        double Mk = M0 + n*tk;
-
-        ///Kepler's Equation for Eccentric Anomaly
-        ///solved by iteration
-        double twoPI = 2.0e0 * PI;
-        Mk = fmod(Mk, twoPI);
-        double Ek = Mk + ecc* ::sin(Mk);
-        int loop_cnt = 1;
-        double F,G,delea;
-        do  {
-            F = Mk - (Ek - ecc * ::sin(Ek));
-            G = 1.0 - ecc * ::cos(Ek);
-            delea = F/G;
-            Ek = Ek + delea;
-            loop_cnt++;
-        } while ((fabs(delea) > 1.0e-11) && (loop_cnt <= 20));
-
-        return (REL_CONST_BDS * ecc * std::sqrt(A) * ::sin(Ek));
+        ///Eccentric Anomaly
+        double Ek = solveKepler(M0 + oc.n*tk, ecc);
+
+        return (oc.relFactor * ::sin(Ek));
     }
 
     Xvt BDSEphemeris::svXvt(const SatID& sat, const CommonTime& t) const
@@ -133,11 +148,10 @@ namespace gnssSpace
         Xvt sv;
         WGS84Ellipsoid ell;
 
-        ///Semi-major axis
-        double A = sqrt_A*sqrt_A;
-
-        ///Computed mean motion (rad/sec)
-        double n0 = std::sqrt(ell.gm()/(A*A*A));
+        KeplerOrbitConst tmpConst;
+        const KeplerOrbitConst& oc = orbitConstants(tmpConst);
+        double A = oc.A;
+        double n = oc.n;
 
         ///Time from ephemeris reference epoch
         ///remind here, t must be BDT
@@ -145,35 +159,18 @@ namespace gnssSpace
         if(tk > 302400)  tk = tk-604800;
         if(tk < -302400) tk = tk+604800;
 
-        ///Corrected mean motion
-        double n = n0 + Delta_n;
-
-        ///Mean anomaly
-        double Mk = M0 + n*tk;
-
-        ///Kepler's Equation for Eccentric Anomaly
-        ///solved by iteration
-        double twoPI = 2.0e0 * PI;
-        Mk = fmod(Mk, twoPI);
-        double Ek = Mk + ecc* ::sin(Mk);
-        int loop_cnt = 1;
-        double F,G,delea;
-        do  {
-            F = Mk - (Ek - ecc * ::sin(Ek));
-            G = 1.0 - ecc * ::cos(Ek);
-            delea = F/G;
-            Ek = Ek + delea;
-            loop_cnt++;
-        } while ((fabs(delea) > 1.0e-11) && (loop_cnt <= 20));
+        ///Kepler's Equation for Eccentric Anomaly, solved only once
+        ///for the position and the relativity correction
+        double Ek = solveKepler(M0 + n*tk, ecc);
 
         ///compute clock corrections
-        sv.relcorr = svRelativity(t);
+        sv.relcorr = oc.relFactor * ::sin(Ek);
         sv.clkbias = svClockBias(t);
         sv.clkdrift = svClockDrift(t);
         sv.frame = ReferenceFrame::WGS84;
 
         ///True Anomaly
-        double q = std::sqrt(1.0 - ecc*ecc);
+        double q = oc.q;
         double sinEk = ::sin(Ek);
         double cosEk = ::cos(Ek);
 
@@ -206,8 +203,7 @@ namespace gnssSpace
         ///the prn between 1-5 and 59-61 is GEO satellites
         if(sat.id<=5 ||sat.id>=59)
         {
-            double OMEGA_k = OMEGA_0 + OMEGA_DOT*tk
-                             - ell.angVelocity() * Toe;
+            double OMEGA_k = oc.OMEGA_t0 + OMEGA_DOT*tk;
 
             double sinOMG_k = ::sin(OMEGA_k);
             double cosOMG_k = ::cos(OMEGA_k);
@@ -255,8 +251,8 @@ namespace gnssSpace
 
             /// derivatives of true anamoly and arg of latitude
             double dek,dlk,div,duv,drv,dxp,dyp;
-            dek = n / G;
-            dlk = sqrt_A * q * std::sqrt(ell.gm()) / (rk*rk);
+            dek = n / (1.0 - ecc*cosEk);
+            dlk = oc.dlkFactor / (rk*rk);
 
             div = IDOT - 2.0e0 * dlk * (Cis*cos2phi_k - Cic*sin2phi_k);
             duv = dlk*(1.e0+ 2.e0 * (Cus*cos2phi_k - Cuc*sin2phi_k));
@@ -302,8 +298,7 @@ namespace gnssSpace
         }
 
         ///Corrected longitude of ascending node.
-        double OMEGA_k = OMEGA_0 + (OMEGA_DOT - ell.angVelocity())*tk
-                         - ell.angVelocity() * Toe;
+        double OMEGA_k = oc.OMEGA_t0 + oc.OMEGA_rate*tk;
 
         ///Earth-fixed coordinates.
         double sinOMG_k = ::sin(OMEGA_k);
@@ -321,9 +316,9 @@ namespace gnssSpace
         /// Compute velocity of rotation coordinates
         double dek,dlk,div,domk,duv,drv,dxp,dyp;
         dek = n * A / rk;
-        dlk = sqrt_A * q * std::sqrt(ell.gm()) / (rk*rk);
+        dlk = oc.dlkFactor / (rk*rk);
         div = IDOT - 2.0e0 * dlk * (Cic*sin2phi_k - Cis*cos2phi_k);
-        domk = OMEGA_DOT - ell.angVelocity();
+        domk = oc.OMEGA_rate;
         duv = dlk*(1.e0+ 2.e0 * (Cus*cos2phi_k - Cuc*sin2phi_k));
         drv = A * ecc * dek * sinEk - 2.e0 * dlk * (Crc * sin2phi_k - Crs * cos2phi_k);
         dxp = drv * ::cos(uk) - rk * ::sin(uk)*duv;
@@ -15,6 +15,7 @@
 #include "CivilTime.hpp"
 #include "SatID.hpp"
 #include "Xvt.hpp"
+#include "KeplerOrbit.hpp"
 #include "WGS84Ellipsoid.hpp"
 
 using namespace timeSpace;
@@ -59,6 +60,15 @@ namespace gnssSpace
        /// Compute satellite position at the given time.
        Xvt svXvt(const SatID& sat, const CommonTime& t) const;
 
+       /// Derive the orbit constants (orbConst) from the broadcast
+       /// elements. Called once when the ephemeris is stored; svXvt()
+       /// computes them on the fly if it was not called.
+       void setOrbitConstants();
+
+       /// Return orbConst, or the constants computed into tmp if
+       /// setOrbitConstants() was not called
+       const KeplerOrbitConst& orbitConstants(KeplerOrbitConst& tmp) const;
+
        bool isValid(const CommonTime& ct) const;
 
        ///Ephemeris data
@@ -117,11 +127,16 @@ namespace gnssSpace
        CommonTime beginValid;     ///< Time at beginning of validity
        CommonTime endValid;       ///< Time at end of fit validity
 
+       KeplerOrbitConst orbConst;  ///< constants derived from the elements
+
    private:
 
        /// Get the fit interval in hours from the fit interval flag and the IODC
        static short getFitInterval(const short IODC, const short fitIntFlag);
 
+       /// Compute the orbit constants of this ephemeris into oc
+       void computeOrbitConstants(KeplerOrbitConst& oc) const;
+
 
    }; // end class BDSEphemeris
 
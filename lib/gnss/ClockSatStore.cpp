@@ -4,6 +4,7 @@
 
 #include "ClockSatStore.hpp"
 #include "YDSTime.hpp"
+#include "SnapshotRecords.hpp"
 
 using namespace std;
 using namespace utilSpace;
@@ -320,6 +321,95 @@ namespace gnssSpace
       catch(InvalidRequest& e) { RETHROW(e); }
    }
 
+   // Clock bias and drift of several satellites at ttag. The interval and
+   // the weights are computed for the first satellite of each grid, and
+   // kept for the next ones with the same epochs.
+   int ClockSatStore::getClockBatch(const std::vector<SatID>& sats,
+                                    const CommonTime& ttag,
+                                    std::vector<double>& bias,
+                                    std::vector<double>& drift,
+                                    std::vector<char>& valid) const
+   {
+      bias.resize(sats.size());
+      drift.resize(sats.size());
+      valid.assign(sats.size(), 0);
+
+      try {
+         checkTimeSystem(ttag.getTimeSystem());
+      }
+      catch(InvalidRequest& e) { return 0; }
+
+      // the Lagrange interpolation needs at least 4 points, the linear
+      // interpolation is that of 2 points
+      const UniformGrid* pLast(0);
+      bool ok(false), isExact(false);
+      int first(0), match(0);
+      double L[2*maxGridHalf], dL[2*maxGridHalf];
+      const int S(gridSize), n(2*Nhalf);
+
+      int num(0);
+      for(size_t i=0; i<sats.size(); i++) {
+         const UniformGrid* pGrid(interpType == 2 && Nhalf < 2 ?
+                                  0 : findGrid(sats[i], Nhalf));
+         if(!pGrid) {
+            try {
+               ClockRecord rec(getValue(sats[i], ttag));
+               bias[i] = rec.bias;
+               drift[i] = rec.drift;
+               valid[i] = 1;
+               num++;
+            }
+            catch(InvalidRequest& e) { }
+            continue;
+         }
+
+         if(!pLast || pGrid->step != pLast->step ||
+            pGrid->times.size() != pLast->times.size() ||
+            pGrid->times[0] != pLast->times[0])
+         {
+            pLast = pGrid;
+            try {
+               isExact = getGridInterval(*pGrid, sats[i], ttag, Nhalf,
+                                         haveClockDrift, first, match);
+               if(!(isExact && haveClockDrift))
+                  getGridBasis(*pGrid, ttag, Nhalf, first,
+                               (isExact ? match : -1), L, dL);
+               ok = true;
+            }
+            catch(InvalidRequest& e) { ok = false; }
+         }
+         if(!ok) continue;
+
+         const double *r(&pGrid->data[first*S]);
+         if(isExact && haveClockDrift) {
+            bias[i] = r[gridBias];
+            drift[i] = r[gridDrift];
+         }
+         else {
+            double b(0.0), d(0.0);
+            if(haveClockDrift) {
+               for(int m=0; m<n; m++, r += S) {
+                  b += L[m]*r[gridBias];
+                  d += L[m]*r[gridDrift];
+               }
+            }
+            else {      // must interpolate biases to get drift
+               for(int m=0; m<n; m++, r += S) {
+                  b += L[m]*r[gridBias];
+                  d += dL[m]*r[gridBias];
+               }
+            }
+            bias[i] = b;
+            drift[i] = d;
+         }
+
+         valid[i] = 1;
+         num++;
+      }
+
+      return num;
+   }
+
    // Add a ClockRecord to the store.
    void ClockSatStore::addClockRecord(const SatID& sat, const CommonTime& ttag,
                                       const ClockRecord& rec)
@@ -327,6 +417,7 @@ namespace gnssSpace
    {
       try {
          checkTimeSystem(ttag.getTimeSystem());
+         gridChanged(sat);
 
          if(rec.drift != 0.0) haveClockDrift = true;
          if(rec.accel != 0.0) haveClockAccel = true;
@@ -359,6 +450,7 @@ namespace gnssSpace
    {
       try {
          checkTimeSystem(ttag.getTimeSystem());
+         gridChanged(sat);
 
          if(tables.find(sat) != tables.end() &&
             tables[sat].find(ttag) != tables[sat].end()) {
@@ -387,6 +479,7 @@ namespace gnssSpace
    {
       try {
          checkTimeSystem(ttag.getTimeSystem());
+         gridChanged(sat);
 
          haveClockDrift = true;
 
@@ -417,6 +510,7 @@ namespace gnssSpace
    {
       try {
          checkTimeSystem(ttag.getTimeSystem());
+         gridChanged(sat);
 
          haveClockAccel = true;
 
@@ -440,4 +534,73 @@ namespace gnssSpace
       catch(InvalidRequest& ir) { RETHROW(ir); }
    }
 
+   // Write the tables to a binary snapshot, for each satellite the
+   // number of records, then the times and records
+   void ClockSatStore::writeSnapshot(BinarySnapshotWriter& w) const
+   {
+      w.beginSection("CLOCK", tables.size());
+      w.putBool(haveClockDrift);
+      w.putBool(haveClockAccel);
+
+      for(SatTable::const_iterator itSat = tables.begin();
+          itSat != tables.end(); ++itSat)
+      {
+         putSat(w, itSat->first);
+         w.putInt(itSat->second.size());
+
+         for(DataTableIterator it = itSat->second.begin();
+             it != itSat->second.end(); ++it)
+         {
+            putTime(w, it->first);
+            w.putDouble(it->second.bias);
+            w.putDouble(it->second.sig_bias);
+            w.putDouble(it->second.drift);
+            w.putDouble(it->second.sig_drift);
+            w.putDouble(it->second.accel);
+            w.putDouble(it->second.sig_accel);
+         }
+      }
+   }
+
+   // Add the tables of a binary snapshot
+   void ClockSatStore::readSnapshot(BinarySnapshotReader& r)
+      noexcept(false)
+   {
+      try {
+         uint64_t numSats = r.beginSection("CLOCK");
+         if(r.getBool()) haveClockDrift = true;
+         if(r.getBool()) haveClockAccel = true;
+
+         ClockRecord rec;
+
+         for(uint64_t i=0; i<numSats; i++) {
+            SatID sat = getSat(r);
+            int64_t num = r.getInt();
+
+            DataTable& table(tables[sat]);
+            gridChanged(sat);
+
+            for(int64_t k=0; k<num; k++) {
+               CommonTime ttag = getTime(r);
+               rec.bias = r.getDouble();
+               rec.sig_bias = r.getDouble();
+               rec.drift = r.getDouble();
+               rec.sig_drift = r.getDouble();
+               rec.accel = r.getDouble();
+               rec.sig_accel = r.getDouble();
+
+               checkTimeSystem(ttag.getTimeSystem());
+
+                  // the records were written in the order of the table, so
+                  // they are appended unless the store already had data
+               if(table.empty() || table.rbegin()->first < ttag)
+                  table.insert(table.end(), make_pair(ttag, rec));
+               else
+                  addClockRecord(sat, ttag, rec);
+            }
+         }
+      }
+      catch(InvalidRequest& ir) { RETHROW(ir); }
+   }
+
 }  // End of namespace gnssSpace
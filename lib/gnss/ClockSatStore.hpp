@@ -17,6 +17,7 @@
 
 #include "TabularSatStore.hpp"
 #include "FileStore.hpp"
+#include "BinarySnapshot.hpp"
 
 using namespace utilSpace;
 using namespace coordSpace;
@@ -80,6 +81,26 @@ namespace gnssSpace
       /// Flag to reject bad clock data; default true
       bool rejectBadClockFlag;
 
+   private:
+
+      /// Values of a record in the uniform grids (TabularSatStore)
+      enum GridValues { gridBias = 0, gridSigBias = 1, gridDrift = 2,
+                        gridSigDrift = 3, gridAccel = 4, gridSigAccel = 5,
+                        gridSize = 6 };
+
+      virtual int gridRecordSize() const
+         { return gridSize; }
+
+      virtual void putGridRecord(const ClockRecord& rec, double* values) const
+      {
+         values[gridBias] = rec.bias;
+         values[gridSigBias] = rec.sig_bias;
+         values[gridDrift] = rec.drift;
+         values[gridSigDrift] = rec.sig_drift;
+         values[gridAccel] = rec.accel;
+         values[gridSigAccel] = rec.sig_accel;
+      }
+
    // member functions
    public:
 
@@ -136,6 +157,21 @@ namespace gnssSpace
       double getClockDrift(const SatID& sat, const CommonTime& ttag)
          const noexcept(false);
 
+      /// Clock bias and drift of several satellites at the same time, as
+      /// getValue() computes them (to the rounding). The satellites whose
+      /// tables are on the same uniform grid share the interpolation
+      /// interval and weights, the others are computed one by one.
+      /// @param[in] sats the satellites of interest
+      /// @param[in] ttag the time of interest
+      /// @param[out] bias the clock bias of each satellite
+      /// @param[out] drift the clock drift of each satellite
+      /// @param[out] valid 1 if the clock of the satellite is computed, 0
+      ///    if getValue() would have thrown InvalidRequest
+      /// @return the number of satellites computed
+      int getClockBatch(const std::vector<SatID>& sats, const CommonTime& ttag,
+                        std::vector<double>& bias, std::vector<double>& drift,
+                        std::vector<char>& valid) const;
+
       /// Dump information about the object to an ostream.
       /// @param[in] os ostream to receive the output; defaults to std::cout
       /// @param[in] detail integer level of detail to provide; allowed values are
@@ -191,6 +227,7 @@ namespace gnssSpace
          if(interpType == 2) Nhalf = (order+1)/2;
          else                Nhalf = 1;
          interpOrder = 2*Nhalf;
+         gridCache.valid = false;         // new weights
       }
 
       /// Set the flag; if true then bad position values are rejected when
@@ -198,6 +235,15 @@ namespace gnssSpace
       void rejectBadClocks(const bool flag)
          { rejectBadClockFlag = flag; }
 
+      /// Write the tables to a binary snapshot (BinarySnapshot.hpp)
+      void writeSnapshot(BinarySnapshotWriter& w) const;
+
+      /// Add the tables written by writeSnapshot(), as addClockRecord()
+      /// does for each record.
+      /// @throw InvalidRequest if the time system differs from the store's
+      void readSnapshot(BinarySnapshotReader& r)
+         noexcept(false);
+
       /// Set the type of interpolation to Lagrange (default)
       void setLagrangeInterp(void) throw()
          { interpType = 2; setInterpolationOrder(10); }
@@ -51,7 +51,12 @@ namespace gnssSpace
         {
             SatIDSet satRejectedSet;
 
-            // Loop through all the satellites
+            batchSats.clear();
+            batchIters.clear();
+            transmitTimes.clear();
+
+            // Loop through all the satellites, and get the transmit time
+            // from the code observable
             for(satTypeValueMap::iterator it = gData.begin();
                 it != gData.end();
                 ++it)
@@ -67,121 +72,169 @@ namespace gnssSpace
                     cout << getClassName() << "sat:" << sat << endl;
                 }
 
+                // Scalar to hold temporal value
+                double obs(0.0);
+
+                // firstly, find the optimal code observable for current satellite 
+
+                TypeID codeType;
+                if(sat.system == SatelliteSystem::GPS)
+                {
+                    codeType = TypeID::PC12G;
+                }
+                else if(sat.system == SatelliteSystem::Galileo)
+                {
+                    codeType = TypeID::PC15E;
+                }
+                else if(sat.system == SatelliteSystem::BDS)
+                {
+                    codeType = TypeID::PC26C;
+                }
+                else
+                {
+                    cerr << getClassName() << "please modify the code!";
+                    exit(-1);
+                }
+
+                // code obs
                 try
                 {
-                   Xvt svPosVel;
-
-                   // compute satellite ephemeris at transmitting time
-                   // Scalar to hold temporal value
-                   double obs(0.0);
-
-                   // firstly, find the optimal code observable for current satellite 
-
-                   TypeID codeType;
-                   if(sat.system == SatelliteSystem::GPS)
-                   {
-                       codeType = TypeID::PC12G;
-                   }
-                   else if(sat.system == SatelliteSystem::Galileo)
-                   {
-                       codeType = TypeID::PC15E;
-                   }
-                   else if(sat.system == SatelliteSystem::BDS)
-                   {
-                       codeType = TypeID::PC26C;
-                   }
-                   else
-                   {
-                       cerr << getClassName() << "please modify the code!";
-                       exit(-1);
-                   }
-
-/*
-                   // 2-char Types for current satellite
-                   vector<TypeID> shortTypes = satShortTypes[sat];
-
-                   TypeID codeType;
-                   for(int i=0; i<shortTypes.size(); i++)
-                   {
-                       string typeStr = shortTypes[i].asString();
-                       if(typeStr[0] == 'C')
-                       {
-                           codeType = shortTypes[i];
-                           break;
-                       }
-                   }
-*/
-
-                   // code obs
-                   try
-                   {
-                       obs = (*it).second(codeType);
-                   }
-                   catch(TypeIDNotFound& e)
-                   {
-                       // remove this satellite
-                       satRejectedSet.insert(sat);
-
-                       // the next satellite
-                       continue;
-                   }
-
-                   // now, compute svPosVel
-                   try
-                   {
-                       svPosVel = ComputeAtTransmitTime(time, obs,  sat);
-                   }
-                   catch(InvalidRequest& e)
-                   {
-                       // If some problem appears, then schedule this satellite
-                       // for removal
-                       satRejectedSet.insert( sat );
-                       continue;
-                   }
-
-                   //
-                   // transmitting-time related parameters
-                   //
-
-                   // relativity
-                   double relativity(0.0);
-                   relativity = svPosVel.computeRelativityCorrection()*C_MPS;
-
-                   // clock bias, clock drift
-                   double svClkBias(0.0), svClkDrift(0.0);
-
-                   svClkBias  = svPosVel.getClockBias()*C_MPS;
-                   svClkDrift = svPosVel.getClockDrift()*C_MPS;
-
-                   // warning: the sign is changed!
-                   // see that in LinearCombination.
-                   (*it).second[TypeID::relativity] = -relativity;
-
-                   // Let's insert satellite clock bias at transmit time
-                   (*it).second[TypeID::cdtSat] = svClkBias;
-                   (*it).second[TypeID::cdtSatDot] = svClkDrift;
-
-                   // Let's insert satellite position at transmit time
-                   (*it).second[TypeID::satXECEF] = svPosVel.x[0];
-                   (*it).second[TypeID::satYECEF] = svPosVel.x[1];
-                   (*it).second[TypeID::satZECEF] = svPosVel.x[2];
-
-                   // Let's insert satellite velocity at transmit time
-                   (*it).second[TypeID::satVXECEF] = svPosVel.v[0];
-                   (*it).second[TypeID::satVYECEF] = svPosVel.v[1];
-                   (*it).second[TypeID::satVZECEF] = svPosVel.v[2];
+                    obs = (*it).second(codeType);
+                }
+                catch(TypeIDNotFound& e)
+                {
+                    // remove this satellite
+                    satRejectedSet.insert(sat);
 
+                    // the next satellite
+                    continue;
                 }
-                catch(InvalidRequest& e)
+
+                CommonTime transmit = time;
+                transmit -= obs/C_MPS;
+
+                batchSats.push_back(sat);
+                batchIters.push_back(it);
+                transmitTimes.push_back(transmit);
+
+            } // End of loop for(satTypeValueMap = gData.begin()...
+
+            // satellites found in the state cache, and the ones to compute
+            size_t nsat = batchSats.size();
+
+            stateXvts.resize(nsat);
+            stateValid.assign(nsat, 0);
+
+            missIndex.clear();
+            missSats.clear();
+            missTimes.clear();
+
+            for(size_t i=0; i<nsat; i++)
+            {
+                if(findSatState(batchSats[i], transmitTimes[i], stateXvts[i]))
+                {
+                    stateValid[i] = 1;
+                    cacheHits++;
+                }
+                else
+                {
+                    missIndex.push_back(i);
+                    missSats.push_back(batchSats[i]);
+                    missTimes.push_back(transmitTimes[i]);
+                    cacheMisses++;
+                }
+            }
+
+            if(pEphStore==NULL && !missSats.empty())
+            {
+                cerr << getClassName() << "pEphStore should be given" << endl;
+                exit(-1);
+            }
+
+            // compute satellite ephemeris at transmitting time, the first
+            // time at the time of flight, then corrected by the clock of
+            // the satellite, for all the satellites at once
+            if(!missSats.empty())
+            {
+                batchTimes = missTimes;
+                pEphStore->getXvtBatch(missSats, batchTimes, batchXvts, batchValid);
+
+                firstValid = batchValid;
+                for(size_t k=0; k<missSats.size(); k++)
+                {
+                    if(batchValid[k])
+                    {
+                        batchTimes[k] -= ( batchXvts[k].clkbias +
+                                           batchXvts[k].relcorr );
+                    }
+                }
+
+                pEphStore->getXvtBatch(missSats, batchTimes, batchXvts, batchValid);
+
+                for(size_t k=0; k<missSats.size(); k++)
+                {
+                    if(!firstValid[k] || !batchValid[k]) continue;
+
+                    size_t i = missIndex[k];
+                    stateXvts[i] = batchXvts[k];
+                    stateValid[i] = 1;
+
+                    // keep the state before the earth rotation
+                    SatState& state = satStates[missSats[k]];
+                    state.transmit = missTimes[k];
+                    state.xvt = batchXvts[k];
+                }
+            }
+
+            for(size_t i=0; i<nsat; i++)
+            {
+                if(!stateValid[i])
                 {
                     // If some problem appears, then schedule this satellite
                     // for removal
-                    satRejectedSet.insert( sat );
+                    satRejectedSet.insert( batchSats[i] );
                     continue;
                 }
 
+                Xvt& svPosVel = stateXvts[i];
+                satTypeValueMap::iterator it = batchIters[i];
 
-            } // End of loop for(satTypeValueMap = gData.begin()...
+                // earth rotation
+                rotateEarth(svPosVel);
+
+                //
+                // transmitting-time related parameters
+                //
+
+                // relativity
+                double relativity(0.0);
+                relativity = svPosVel.computeRelativityCorrection()*C_MPS;
+
+                // clock bias, clock drift
+                double svClkBias(0.0), svClkDrift(0.0);
+
+                svClkBias  = svPosVel.getClockBias()*C_MPS;
+                svClkDrift = svPosVel.getClockDrift()*C_MPS;
+
+                // warning: the sign is changed!
+                // see that in LinearCombination.
+                (*it).second[TypeID::relativity] = -relativity;
+
+                // Let's insert satellite clock bias at transmit time
+                (*it).second[TypeID::cdtSat] = svClkBias;
+                (*it).second[TypeID::cdtSatDot] = svClkDrift;
+
+                // Let's insert satellite position at transmit time
+                (*it).second[TypeID::satXECEF] = svPosVel.x[0];
+                (*it).second[TypeID::satYECEF] = svPosVel.x[1];
+                (*it).second[TypeID::satZECEF] = svPosVel.x[2];
+
+                // Let's insert satellite velocity at transmit time
+                (*it).second[TypeID::satVXECEF] = svPosVel.v[0];
+                (*it).second[TypeID::satVYECEF] = svPosVel.v[1];
+                (*it).second[TypeID::satVZECEF] = svPosVel.v[2];
+
+            } // End of loop for(i = 0; i < nsat...
 
             // Remove satellites with missing data
             gData.removeSatID(satRejectedSet);
@@ -203,6 +256,50 @@ namespace gnssSpace
     }  // End of method 'ComputeSatPos::Process()'
 
 
+    bool ComputeSatPos::findSatState( const SatID& sat,
+                                      const CommonTime& transmit,
+                                      Xvt& xvt ) const
+    {
+        std::map<SatID, SatState>::const_iterator it = satStates.find(sat);
+        if(it == satStates.end())
+        {
+            return false;
+        }
+
+        double dt = transmit - it->second.transmit;
+        if(std::fabs(dt) > stateTolerance)
+        {
+            return false;
+        }
+
+        xvt = it->second.xvt;
+
+        // move the state to the new transmit time, with the central
+        // gravity and the centrifugal and coriolis terms of the ECEF frame
+        if(dt != 0.0)
+        {
+            double r = RSS(xvt.x[0], xvt.x[1], xvt.x[2]);
+            double gmr3 = GM_EARTH/(r*r*r);
+            double w2 = OMEGA_EARTH*OMEGA_EARTH;
+
+            double acc[3];
+            acc[0] = -gmr3*xvt.x[0] + w2*xvt.x[0] + 2.0*OMEGA_EARTH*xvt.v[1];
+            acc[1] = -gmr3*xvt.x[1] + w2*xvt.x[1] - 2.0*OMEGA_EARTH*xvt.v[0];
+            acc[2] = -gmr3*xvt.x[2];
+
+            for(int j=0; j<3; j++)
+            {
+                xvt.x[j] += xvt.v[j]*dt + 0.5*acc[j]*dt*dt;
+                xvt.v[j] += acc[j]*dt;
+            }
+            xvt.clkbias += xvt.clkdrift*dt;
+        }
+
+        return true;
+
+    }  // End of method 'ComputeSatPos::findSatState()'
+
+
     Xvt ComputeSatPos::ComputeAtTransmitTime(const CommonTime& tr,
                                               const double& pr,
                                               const SatID& sat)
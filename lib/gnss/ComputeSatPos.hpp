@@ -15,6 +15,9 @@
 #ifndef ComputeSatPos_HPP
 #define ComputeSatPos_HPP
 
+#include <map>
+#include <cmath>
+
 #include "XvtStore.hpp"
 #include "Position.hpp"
 #include "Rx3ObsData.hpp"
@@ -46,7 +49,8 @@ namespace gnssSpace
          /// and satellites with elevation less than 10 degrees will be
          /// deleted.
         ComputeSatPos()
-            : pEphStore(NULL) 
+            : pEphStore(NULL), stateTolerance(0.002),
+              cacheHits(0), cacheMisses(0)
         {
             beginTime=Counter::now();
         };
@@ -62,8 +66,9 @@ namespace gnssSpace
           *
           */
         ComputeSatPos( XvtStore<SatID>& ephStore)
+            : pEphStore(&ephStore), stateTolerance(0.002),
+              cacheHits(0), cacheMisses(0)
         {
-            pEphStore = &ephStore;
         };
 
 
@@ -99,6 +104,38 @@ namespace gnssSpace
         virtual void rotateEarth(Xvt& svPosVel);
 
 
+         /** Set the tolerance of the satellite state cache (seconds).
+          *
+          * The orbits computed by Process() are kept, before the earth
+          * rotation, with their transmit time. When the same satellite
+          * is processed again with a transmit time within the tolerance,
+          * e.g. in the next SPP iteration, or for the base station of a
+          * short baseline, the kept state is moved to the new transmit
+          * time with its velocity and clock drift, and only the earth
+          * rotation is computed again. The default 2 ms covers the clock
+          * offsets of the rover and base receivers; 0 keeps the exact
+          * matches only, and a negative value disables the cache.
+          */
+        virtual void setStateTolerance(double tol)
+        {
+            stateTolerance = tol;
+        };
+
+         /// Drop the kept satellite states, e.g. if the ephemerides in
+         /// the store are changed
+        virtual void clearStateCache()
+        {
+            satStates.clear();
+        };
+
+         /// Number of satellites taken from / missed in the state cache
+        unsigned long getCacheHits() const
+        { return cacheHits; };
+
+        unsigned long getCacheMisses() const
+        { return cacheMisses; };
+
+
         void printTimeUsed(std::ostream& os)
         {
             os << timeUsed << endl;
@@ -126,6 +163,47 @@ namespace gnssSpace
         /// Pointer to XvtStore<SatID> object
         XvtStore<SatID>* pEphStore;
 
+        /// satellites of the epoch given to getXvtBatch(), kept to reuse
+        /// the memory
+        std::vector<SatID> batchSats;
+        std::vector<satTypeValueMap::iterator> batchIters;
+        std::vector<CommonTime> transmitTimes;
+        std::vector<CommonTime> batchTimes;
+        std::vector<Xvt> batchXvts;
+        std::vector<char> batchValid;
+        std::vector<char> firstValid;
+
+        /// satellites of the epoch missing in the state cache
+        std::vector<size_t> missIndex;
+        std::vector<SatID> missSats;
+        std::vector<CommonTime> missTimes;
+
+        /// state of each satellite of the epoch
+        std::vector<Xvt> stateXvts;
+        std::vector<char> stateValid;
+
+
+        /// satellite state kept between the calls of Process()
+        struct SatState
+        {
+            CommonTime transmit;    ///< transmit time from the code
+            Xvt xvt;                ///< orbit before the earth rotation
+        };
+
+        std::map<SatID, SatState> satStates;
+
+        /// tolerance of the transmit time to use a kept state (s)
+        double stateTolerance;
+
+        unsigned long cacheHits;
+        unsigned long cacheMisses;
+
+        /// Return true and the state of the satellite at transmit if it
+        /// is found in satStates
+        bool findSatState( const SatID& sat,
+                           const CommonTime& transmit,
+                           Xvt& xvt ) const;
+
     }; // End of class 'ComputeSatPos'
 
 }  // End of namespace gnssSpace
@@ -0,0 +1,541 @@
+#pragma ident "$Id$"
+
+/**
+ * @file ConcurrentNavStore.cpp
+ * Broadcast ephemeris store for many reader threads and a live writer.
+ */
+
+#include "ConcurrentNavStore.hpp"
+
+#define debug 0
+
+namespace gnssSpace
+{
+
+      /// Find the ephemeris nearest to epoch among the ones of the satellite
+   template <class EphType>
+   static const EphType* findNearest(
+      const std::map<SatID, std::shared_ptr<const std::map<CommonTime, EphType> > >& ephData,
+      const SatID& sat,
+      const CommonTime& epoch,
+      double validity )
+   {
+      typename std::map<SatID, std::shared_ptr<const std::map<CommonTime, EphType> > >::const_iterator
+         itSat = ephData.find(sat);
+      if(itSat == ephData.end())
+      {
+         return NULL;
+      }
+
+      return Rx3NavStore::nearestEphemeris(*itSat->second, epoch, validity);
+   }
+
+
+      /// Copy the map of the satellite in ephData, add the ephemerides
+      /// of ephMap to the copy, and put the copy into ephData
+   template <class EphType>
+   static void mergeSat(
+      std::map<SatID, std::shared_ptr<const std::map<CommonTime, EphType> > >& ephData,
+      const SatID& sat,
+      const std::map<CommonTime, EphType>& ephMap )
+   {
+      if(ephMap.empty()) return;
+
+      std::shared_ptr< std::map<CommonTime, EphType> > newMap;
+
+      typename std::map<SatID, std::shared_ptr<const std::map<CommonTime, EphType> > >::iterator
+         itSat = ephData.find(sat);
+      if(itSat != ephData.end())
+      {
+         newMap = std::make_shared< std::map<CommonTime, EphType> >(*itSat->second);
+      }
+      else
+      {
+         newMap = std::make_shared< std::map<CommonTime, EphType> >();
+      }
+
+      for(typename std::map<CommonTime, EphType>::const_iterator it = ephMap.begin();
+          it != ephMap.end();
+          ++it)
+      {
+         (*newMap)[it->first] = it->second;
+      }
+
+      ephData[sat] = newMap;
+   }
+
+
+      /// Merge the satellites of storeData into ephData, all of them if
+      /// pSats is NULL
+   template <class EphType>
+   static void mergeSys(
+      std::map<SatID, std::shared_ptr<const std::map<CommonTime, EphType> > >& ephData,
+      const map<SatID, std::map<CommonTime, EphType> >& storeData,
+      const std::vector<SatID>* pSats )
+   {
+      typename map<SatID, std::map<CommonTime, EphType> >::const_iterator it;
+
+      if(pSats == NULL)
+      {
+         for(it = storeData.begin(); it != storeData.end(); ++it)
+         {
+            mergeSat(ephData, it->first, it->second);
+         }
+         return;
+      }
+
+      for(size_t i=0; i<pSats->size(); i++)
+      {
+         it = storeData.find((*pSats)[i]);
+         if(it != storeData.end())
+         {
+            mergeSat(ephData, it->first, it->second);
+         }
+      }
+   }
+
+
+      /// Keep the ephemerides with reference time in [tmin, tmax] only
+   template <class EphType>
+   static void editSys(
+      std::map<SatID, std::shared_ptr<const std::map<CommonTime, EphType> > >& ephData,
+      const CommonTime& tmin,
+      const CommonTime& tmax )
+   {
+      typename std::map<SatID, std::shared_ptr<const std::map<CommonTime, EphType> > >::iterator
+         itSat = ephData.begin();
+      while(itSat != ephData.end())
+      {
+         const std::map<CommonTime, EphType>& ephMap = *itSat->second;
+         if(ephMap.empty())
+         {
+            ephData.erase(itSat++);
+            continue;
+         }
+
+         // the keys are in the time system of the satellite system
+         TimeSystem ts = ephMap.begin()->first.getTimeSystem();
+         CommonTime t1 = convertTimeSystem(tmin, ts);
+         CommonTime t2 = convertTimeSystem(tmax, ts);
+
+         std::shared_ptr< std::map<CommonTime, EphType> > newMap
+            = std::make_shared< std::map<CommonTime, EphType> >(
+                 ephMap.lower_bound(t1), ephMap.upper_bound(t2));
+
+         if(newMap->empty())
+         {
+            ephData.erase(itSat++);
+         }
+         else
+         {
+            itSat->second = newMap;
+            ++itSat;
+         }
+      }
+   }
+
+
+      /// Earliest or latest reference time of the system, in GPS time
+   template <class EphType>
+   static void limitSys(
+      const std::map<SatID, std::shared_ptr<const std::map<CommonTime, EphType> > >& ephData,
+      bool first,
+      CommonTime& limit,
+      bool& found )
+   {
+      typename std::map<SatID, std::shared_ptr<const std::map<CommonTime, EphType> > >::const_iterator
+         itSat;
+      for(itSat = ephData.begin(); itSat != ephData.end(); ++itSat)
+      {
+         const std::map<CommonTime, EphType>& ephMap = *itSat->second;
+         if(ephMap.empty()) continue;
+
+         CommonTime t = first ? ephMap.begin()->first : ephMap.rbegin()->first;
+         t = convertTimeSystem(t, TimeSystem::GPS);
+
+         if(!found || (first ? t < limit : t > limit))
+         {
+            limit = t;
+            found = true;
+         }
+      }
+   }
+
+
+   const GPSEphemeris* NavSnapshot::findGPSEphemeris( const SatID& sat,
+                                                      const CommonTime& epoch ) const
+   {
+      return findNearest(gpsEphData, sat, epoch, Rx3NavStore::validGPSEph);
+   }
+
+   const BDSEphemeris* NavSnapshot::findBDSEphemeris( const SatID& sat,
+                                                      const CommonTime& epoch ) const
+   {
+      return findNearest(bdsEphData, sat, epoch, Rx3NavStore::validBDSEph);
+   }
+
+   const GalEphemeris* NavSnapshot::findGalEphemeris( const SatID& sat,
+                                                      const CommonTime& epoch ) const
+   {
+      return findNearest(galEphData, sat, epoch, Rx3NavStore::validGalEph);
+   }
+
+   const GloEphemeris* NavSnapshot::findGloEphemeris( const SatID& sat,
+                                                      const CommonTime& epoch ) const
+   {
+      return findNearest(gloEphData, sat, epoch, Rx3NavStore::validGloEph);
+   }
+
+
+   Xvt NavSnapshot::getXvt(const SatID& sat, const CommonTime& epoch) const
+      noexcept(false)
+   {
+      if(sat.system == SatelliteSystem::GPS)
+      {
+         CommonTime realEpoch = convertTimeSystem(epoch, TimeSystem::GPS);
+         const GPSEphemeris* pEph = findGPSEphemeris(sat, realEpoch);
+         if(pEph != NULL)
+         {
+            return pEph->svXvt(realEpoch);
+         }
+      }
+      else if(sat.system == SatelliteSystem::BDS)
+      {
+         CommonTime realEpoch = convertTimeSystem(epoch, TimeSystem::BDT);
+         const BDSEphemeris* pEph = findBDSEphemeris(sat, realEpoch);
+         if(pEph != NULL)
+         {
+            return pEph->svXvt(sat, realEpoch);
+         }
+      }
+      else if(sat.system == SatelliteSystem::Galileo)
+      {
+         CommonTime realEpoch = convertTimeSystem(epoch, TimeSystem::GAL);
+         const GalEphemeris* pEph = findGalEphemeris(sat, realEpoch);
+         if(pEph != NULL)
+         {
+            return pEph->svXvt(realEpoch);
+         }
+      }
+      else if(sat.system == SatelliteSystem::GLONASS)
+      {
+         CommonTime realEpoch = convertTimeSystem(epoch, TimeSystem::GLO);
+         const GloEphemeris* pEph = findGloEphemeris(sat, realEpoch);
+         if(pEph != NULL)
+         {
+            return pEph->svXvt(realEpoch);
+         }
+      }
+
+      InvalidRequest e("NavSnapshot: no valid ephemeris for " + sat.toString()
+                       + " at " + epoch.asString());
+      THROW(e);
+
+      return Xvt();
+
+   }  // End of method 'NavSnapshot::getXvt()'
+
+
+      /// Put the orbit of the ephemeris at t into the batch, and the clock
+      /// into xvt
+   template <class EphType>
+   static void addToBatch( KeplerBatch& batch,
+                           const EphType& eph,
+                           const CommonTime& t,
+                           Xvt& xvt )
+   {
+      double tk = t - eph.ctToe;
+      if(tk > 302400)  tk = tk-604800;
+      if(tk < -302400) tk = tk+604800;
+
+      KeplerOrbitConst tmpConst;
+      batch.add(eph, eph.orbitConstants(tmpConst), tk);
+
+      xvt.clkbias = eph.svClockBias(t);
+      xvt.clkdrift = eph.svClockDrift(t);
+      xvt.frame = ReferenceFrame::WGS84;
+   }
+
+
+   int NavSnapshot::getXvtBatch( const std::vector<SatID>& sats,
+                                 const std::vector<CommonTime>& times,
+                                 std::vector<Xvt>& xvts,
+                                 std::vector<char>& valid ) const
+   {
+      // the batch is kept by each thread, to reuse the memory
+      static thread_local KeplerBatch keplerBatch;
+      static thread_local std::vector<size_t> batchIndex;
+
+      xvts.resize(sats.size());
+      valid.assign(sats.size(), 0);
+
+      keplerBatch.clear();
+      batchIndex.clear();
+
+      int num(0);
+      for(size_t i=0; i<sats.size(); i++)
+      {
+         const SatID& sat = sats[i];
+
+         if(sat.system == SatelliteSystem::GPS)
+         {
+            CommonTime realEpoch = convertTimeSystem(times[i], TimeSystem::GPS);
+            const GPSEphemeris* pEph = findGPSEphemeris(sat, realEpoch);
+            if(pEph == NULL) continue;
+
+            addToBatch(keplerBatch, *pEph, realEpoch, xvts[i]);
+            batchIndex.push_back(i);
+         }
+         else if(sat.system == SatelliteSystem::Galileo)
+         {
+            CommonTime realEpoch = convertTimeSystem(times[i], TimeSystem::GAL);
+            const GalEphemeris* pEph = findGalEphemeris(sat, realEpoch);
+            if(pEph == NULL) continue;
+
+            addToBatch(keplerBatch, *pEph, realEpoch, xvts[i]);
+            batchIndex.push_back(i);
+         }
+         else if( sat.system == SatelliteSystem::BDS &&
+                  !(sat.id<=5 || sat.id>=59) )
+         {
+            CommonTime realEpoch = convertTimeSystem(times[i], TimeSystem::BDT);
+            const BDSEphemeris* pEph = findBDSEphemeris(sat, realEpoch);
+            if(pEph == NULL) continue;
+
+            addToBatch(keplerBatch, *pEph, realEpoch, xvts[i]);
+            batchIndex.push_back(i);
+         }
+         else
+         {
+            // BDS GEO and GLONASS, one by one
+            try
+            {
+               xvts[i] = getXvt(sat, times[i]);
+            }
+            catch(InvalidRequest& e)
+            {
+               continue;
+            }
+         }
+
+         valid[i] = 1;
+         num++;
+      }
+
+      keplerBatch.compute();
+
+      for(size_t k=0; k<batchIndex.size(); k++)
+      {
+         Xvt& xvt = xvts[batchIndex[k]];
+         xvt.x[0] = keplerBatch.x[k];
+         xvt.x[1] = keplerBatch.y[k];
+         xvt.x[2] = keplerBatch.z[k];
+         xvt.v[0] = keplerBatch.vx[k];
+         xvt.v[1] = keplerBatch.vy[k];
+         xvt.v[2] = keplerBatch.vz[k];
+         xvt.relcorr = keplerBatch.relcorr[k];
+      }
+
+      return num;
+
+   }  // End of method 'NavSnapshot::getXvtBatch()'
+
+
+   bool NavSnapshot::isPresent(const SatID& sat) const
+   {
+      switch(sat.system)
+      {
+         case SatelliteSystem::GPS:     return gpsEphData.count(sat) > 0;
+         case SatelliteSystem::BDS:     return bdsEphData.count(sat) > 0;
+         case SatelliteSystem::Galileo: return galEphData.count(sat) > 0;
+         case SatelliteSystem::GLONASS: return gloEphData.count(sat) > 0;
+         default:                       return false;
+      }
+   }
+
+
+   Xvt ConcurrentNavStore::getXvt(const SatID& sat, const CommonTime& epoch)
+      noexcept(false)
+   {
+      ReadGuard snap(snapshots);
+
+      try
+      {
+         return snap->getXvt(sat, epoch);
+      }
+      catch(InvalidRequest& e)
+      {
+         RETHROW(e);
+      }
+   }
+
+
+   int ConcurrentNavStore::getXvtBatch( const std::vector<SatID>& sats,
+                                        const std::vector<CommonTime>& times,
+                                        std::vector<Xvt>& xvts,
+                                        std::vector<char>& valid )
+   {
+      ReadGuard snap(snapshots);
+      return snap->getXvtBatch(sats, times, xvts, valid);
+   }
+
+
+   void ConcurrentNavStore::update(const Rx3NavStore& store)
+   {
+      snapshots.update([&](const NavSnapshot& old)
+      {
+         NavSnapshot* next = new NavSnapshot(old);
+         mergeSys(next->gpsEphData, store.gpsEphData, NULL);
+         mergeSys(next->bdsEphData, store.bdsEphData, NULL);
+         mergeSys(next->galEphData, store.galEphData, NULL);
+         mergeSys(next->gloEphData, store.gloEphData, NULL);
+         return next;
+      });
+   }
+
+
+   void ConcurrentNavStore::update( const Rx3NavStore& store,
+                                    const std::vector<SatID>& sats )
+   {
+      snapshots.update([&](const NavSnapshot& old)
+      {
+         NavSnapshot* next = new NavSnapshot(old);
+         mergeSys(next->gpsEphData, store.gpsEphData, &sats);
+         mergeSys(next->bdsEphData, store.bdsEphData, &sats);
+         mergeSys(next->galEphData, store.galEphData, &sats);
+         mergeSys(next->gloEphData, store.gloEphData, &sats);
+         return next;
+      });
+   }
+
+
+   void ConcurrentNavStore::addEphemeris(const SatID& sat, const GPSEphemeris& eph)
+   {
+      snapshots.update([&](const NavSnapshot& old)
+      {
+         NavSnapshot* next = new NavSnapshot(old);
+         mergeSat(next->gpsEphData, sat, NavSnapshot::GPSEphMap{{eph.ctToe, eph}});
+         return next;
+      });
+   }
+
+   void ConcurrentNavStore::addEphemeris(const SatID& sat, const BDSEphemeris& eph)
+   {
+      snapshots.update([&](const NavSnapshot& old)
+      {
+         NavSnapshot* next = new NavSnapshot(old);
+         mergeSat(next->bdsEphData, sat, NavSnapshot::BDSEphMap{{eph.ctToe, eph}});
+         return next;
+      });
+   }
+
+   void ConcurrentNavStore::addEphemeris(const SatID& sat, const GalEphemeris& eph)
+   {
+      snapshots.update([&](const NavSnapshot& old)
+      {
+         NavSnapshot* next = new NavSnapshot(old);
+         mergeSat(next->galEphData, sat, NavSnapshot::GalEphMap{{eph.ctToe, eph}});
+         return next;
+      });
+   }
+
+   void ConcurrentNavStore::addEphemeris(const SatID& sat, const GloEphemeris& eph)
+   {
+      snapshots.update([&](const NavSnapshot& old)
+      {
+         NavSnapshot* next = new NavSnapshot(old);
+         mergeSat(next->gloEphData, sat, NavSnapshot::GloEphMap{{eph.ctToe, eph}});
+         return next;
+      });
+   }
+
+
+   void ConcurrentNavStore::dump(std::ostream& s, short /*detail*/) const
+   {
+      ReadGuard snap(snapshots);
+
+      s << "ConcurrentNavStore: version " << getVersion() << endl;
+
+      std::map<SatID, size_t> numEphs;
+      for(auto it = snap->gpsEphData.begin(); it != snap->gpsEphData.end(); ++it)
+         numEphs[it->first] = it->second->size();
+      for(auto it = snap->bdsEphData.begin(); it != snap->bdsEphData.end(); ++it)
+         numEphs[it->first] = it->second->size();
+      for(auto it = snap->galEphData.begin(); it != snap->galEphData.end(); ++it)
+         numEphs[it->first] = it->second->size();
+      for(auto it = snap->gloEphData.begin(); it != snap->gloEphData.end(); ++it)
+         numEphs[it->first] = it->second->size();
+
+      for(auto it = numEphs.begin(); it != numEphs.end(); ++it)
+      {
+         s << it->first << " " << it->second << endl;
+      }
+   }
+
+
+   void ConcurrentNavStore::edit(const CommonTime& tmin, const CommonTime& tmax)
+   {
+      snapshots.update([&](const NavSnapshot& old)
+      {
+         NavSnapshot* next = new NavSnapshot(old);
+         editSys(next->gpsEphData, tmin, tmax);
+         editSys(next->bdsEphData, tmin, tmax);
+         editSys(next->galEphData, tmin, tmax);
+         editSys(next->gloEphData, tmin, tmax);
+         return next;
+      });
+   }
+
+
+   void ConcurrentNavStore::clear(void)
+   {
+      snapshots.update([](const NavSnapshot& /*old*/)
+      {
+         return new NavSnapshot;
+      });
+   }
+
+
+   CommonTime ConcurrentNavStore::getLimitTime(bool first) const
+      noexcept(false)
+   {
+      ReadGuard snap(snapshots);
+
+      CommonTime limit;
+      bool found(false);
+      limitSys(snap->gpsEphData, first, limit, found);
+      limitSys(snap->bdsEphData, first, limit, found);
+      limitSys(snap->galEphData, first, limit, found);
+      limitSys(snap->gloEphData, first, limit, found);
+
+      if(!found)
+      {
+         InvalidRequest e("ConcurrentNavStore: the store is empty");
+         THROW(e);
+      }
+
+      return limit;
+   }
+
+
+   CommonTime ConcurrentNavStore::getInitialTime(void) const
+      noexcept(false)
+   {
+      return getLimitTime(true);
+   }
+
+
+   CommonTime ConcurrentNavStore::getFinalTime(void) const
+      noexcept(false)
+   {
+      return getLimitTime(false);
+   }
+
+
+   bool ConcurrentNavStore::isPresent(const SatID& sat) const
+   {
+      ReadGuard snap(snapshots);
+      return snap->isPresent(sat);
+   }
+
+}  // End of namespace gnssSpace
@@ -0,0 +1,179 @@
+#pragma ident "$Id$"
+
+/**
+ * @file ConcurrentNavStore.hpp
+ * Broadcast ephemeris store for many reader threads and a live writer.
+ *
+ * The ephemerides are kept in immutable snapshots (NavSnapshot). The
+ * readers, e.g. one thread per satellite group computing the orbits,
+ * take the current snapshot without any lock (SnapshotPtr), while a
+ * writer, e.g. the RTCM decoder (Rtcm3NavStore::setConcurrentStore()),
+ * publishes new snapshots. A reader keeps the snapshot it started with
+ * until it is done, and the old snapshots are deleted once no reader
+ * holds them.
+ *
+ * The map of each satellite is shared by the snapshots through a
+ * shared_ptr, so an update only copies the maps of the satellites it
+ * changes, and the small table of pointers.
+ *
+ * The GLONASS node cache of GloEphemeris is filled by the readers under
+ * the mutex of each ephemeris, the other ephemerides are only read.
+ */
+
+#ifndef ConcurrentNavStore_HPP
+#define ConcurrentNavStore_HPP
+
+#include <map>
+#include <vector>
+#include <memory>
+
+#include "Exception.hpp"
+#include "SnapshotPtr.hpp"
+#include "XvtStore.hpp"
+#include "Rx3NavStore.hpp"
+
+namespace gnssSpace
+{
+
+      /// Immutable set of ephemerides, shared by the readers
+   struct NavSnapshot
+   {
+      typedef std::map<CommonTime, GPSEphemeris> GPSEphMap;
+      typedef std::map<CommonTime, BDSEphemeris> BDSEphMap;
+      typedef std::map<CommonTime, GalEphemeris> GalEphMap;
+      typedef std::map<CommonTime, GloEphemeris> GloEphMap;
+
+      std::map<SatID, std::shared_ptr<const GPSEphMap> > gpsEphData;
+      std::map<SatID, std::shared_ptr<const BDSEphMap> > bdsEphData;
+      std::map<SatID, std::shared_ptr<const GalEphMap> > galEphData;
+      std::map<SatID, std::shared_ptr<const GloEphMap> > gloEphData;
+
+         /// Find the ephemeris nearest to epoch, as Rx3NavStore does.
+         /// The epoch must be in the time system of the satellite system.
+         /// @return NULL if none is valid
+      const GPSEphemeris* findGPSEphemeris(const SatID& sat, const CommonTime& epoch) const;
+      const BDSEphemeris* findBDSEphemeris(const SatID& sat, const CommonTime& epoch) const;
+      const GalEphemeris* findGalEphemeris(const SatID& sat, const CommonTime& epoch) const;
+      const GloEphemeris* findGloEphemeris(const SatID& sat, const CommonTime& epoch) const;
+
+         /// Position, velocity and clock of the satellite
+         /// @throw InvalidRequest if no valid ephemeris is found
+      Xvt getXvt(const SatID& sat, const CommonTime& epoch) const
+         noexcept(false);
+
+         /// Xvt of several satellites, as Rx3NavStore::getXvtBatch()
+      int getXvtBatch(const std::vector<SatID>& sats,
+                      const std::vector<CommonTime>& times,
+                      std::vector<Xvt>& xvts,
+                      std::vector<char>& valid) const;
+
+      bool isPresent(const SatID& sat) const;
+
+   }; // End of struct 'NavSnapshot'
+
+
+      /** Ephemeris store with lock-free readers.
+       *
+       * @code
+       *   ConcurrentNavStore navStore;
+       *   navStore.update(rx3NavStore);
+       *
+       *   // any thread
+       *   Xvt xvt = navStore.getXvt(sat, time);
+       *
+       *   // several lookups in the same snapshot
+       *   ConcurrentNavStore::ReadGuard snap(navStore.getSnapshots());
+       *   const GPSEphemeris* pEph = snap->findGPSEphemeris(sat, time);
+       * @endcode
+       */
+   class ConcurrentNavStore : public XvtStore<SatID>
+   {
+   public:
+
+      typedef SnapshotPtr<NavSnapshot>::ReadGuard ReadGuard;
+
+      ConcurrentNavStore()
+         : snapshots(new NavSnapshot)
+      {};
+
+         /// Snapshots, to be read with a ReadGuard
+      const SnapshotPtr<NavSnapshot>& getSnapshots() const
+      { return snapshots; };
+
+         /// Returns the position, velocity and clock of the satellite.
+         /// @throw InvalidRequest if no valid ephemeris is found
+      virtual Xvt getXvt(const SatID& sat, const CommonTime& epoch)
+         noexcept(false);
+
+         /// Xvt of several satellites in the same snapshot
+      virtual int getXvtBatch(const std::vector<SatID>& sats,
+                              const std::vector<CommonTime>& times,
+                              std::vector<Xvt>& xvts,
+                              std::vector<char>& valid);
+
+         /// Publish the ephemerides of the store, added to the current
+         /// ones; an ephemeris with the same reference time is replaced.
+      void update(const Rx3NavStore& store);
+
+         /// Same as above, for the satellites sats of the store only
+      void update(const Rx3NavStore& store, const std::vector<SatID>& sats);
+
+         /// Publish one ephemeris
+      void addEphemeris(const SatID& sat, const GPSEphemeris& eph);
+      void addEphemeris(const SatID& sat, const BDSEphemeris& eph);
+      void addEphemeris(const SatID& sat, const GalEphemeris& eph);
+      void addEphemeris(const SatID& sat, const GloEphemeris& eph);
+
+         /// Number of snapshots published
+      unsigned long getVersion() const
+      { return snapshots.numUpdates(); };
+
+         /// Replaced snapshots still held by the readers
+      size_t getNumRetired() const
+      { return snapshots.numRetired(); };
+
+         /// Number of ephemerides of each satellite
+      virtual void dump(std::ostream& s = std::cout, short detail = 0) const;
+
+         /// Publish the ephemerides whose reference time is within
+         /// [tmin, tmax] only
+      virtual void edit(const CommonTime& tmin,
+                        const CommonTime& tmax = CommonTime::END_OF_TIME);
+
+         /// Publish an empty snapshot
+      virtual void clear(void);
+
+         /// The satellites are in their own time systems
+      virtual TimeSystem getTimeSystem(void) const
+      { return TimeSystem::Any; };
+
+         /// Earliest and latest reference time of the ephemerides, in GPS
+         /// time
+         /// @throw InvalidRequest if the store is empty
+      virtual CommonTime getInitialTime(void) const
+         noexcept(false);
+
+      virtual CommonTime getFinalTime(void) const
+         noexcept(false);
+
+      virtual bool hasVelocity(void) const
+      { return true; };
+
+      virtual bool isPresent(const SatID& sat) const;
+
+      virtual ~ConcurrentNavStore()
+      {};
+
+   private:
+
+         /// Earliest (first true) or latest reference time
+      CommonTime getLimitTime(bool first) const
+         noexcept(false);
+
+      SnapshotPtr<NavSnapshot> snapshots;
+
+   }; // End of class 'ConcurrentNavStore'
+
+}  // End of namespace gnssSpace
+
+#endif   // ConcurrentNavStore_HPP
@@ -43,6 +43,7 @@
 #include "SatID.hpp"
 #include "SourceID.hpp"
 #include "MiscMath.hpp"
+#include "PoolAllocator.hpp"
 
 using namespace std;
 
@@ -94,8 +95,13 @@ namespace gnssSpace
     typedef std::set<SatID> SatIDSet;
     typedef std::set<SourceID> SourceIDSet;
 
+       /// std::map with nodes recycled by PoolAllocator
+    typedef std::map< TypeID, double, std::less<TypeID>,
+                      PoolAllocator< std::pair<const TypeID, double> > >
+                                                    typeValueMapBase;
+
        /// Map holding TypeID with corresponding numeric value.
-    struct typeValueMap : std::map<TypeID, double>
+    struct typeValueMap : typeValueMapBase
     {
 
         /// Return the number of different types available.
@@ -164,8 +170,13 @@ namespace gnssSpace
     };  // End typeValueMap
 
 
+      /// std::map with nodes recycled by PoolAllocator
+    typedef std::map< SatID, double, std::less<SatID>,
+                      PoolAllocator< std::pair<const SatID, double> > >
+                                                    satValueMapBase;
+
       /// Map holding SatID with corresponding numeric value.
-    struct satValueMap : std::map<SatID, double>
+    struct satValueMap : satValueMapBase
     {
 
          /// Return the number of satellites available.
@@ -233,8 +244,13 @@ namespace gnssSpace
     };  // End of 'satValueMap'
 
 
+      /// std::map with nodes recycled by PoolAllocator
+    typedef std::map< SatID, typeValueMap, std::less<SatID>,
+                      PoolAllocator< std::pair<const SatID, typeValueMap> > >
+                                                    satTypeValueMapBase;
+
       /// Map holding SatID with corresponding typeValueMap.
-    struct satTypeValueMap : std::map<SatID, typeValueMap>
+    struct satTypeValueMap : satTypeValueMapBase
     {
 
          /// Return the number of available satellites.
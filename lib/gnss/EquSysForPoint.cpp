@@ -41,10 +41,14 @@
 #include "CommonTime.hpp"
 #include "EquSysForPoint.hpp"
 #include <iterator>
+#include <unordered_map>
 
 #define debug 0
 #define debugArc 0
 
+// compare each incremental epoch with the default mode
+#define debugIncremental 0
+
 using namespace utilSpace;
 using namespace timeSpace;
 using namespace mathSpace;
@@ -71,6 +75,7 @@ namespace gnssSpace
 
          // We must "Prepare()" this EquSysForPoint
       isPrepared = false;
+      isCompiled = false;
 
       return (*this);
 
@@ -84,6 +89,7 @@ namespace gnssSpace
       equDescripSet.clear();
 
       isPrepared = false;
+      isCompiled = false;
 
       return (*this);
 
@@ -101,6 +107,19 @@ namespace gnssSpace
                                             satTypeValueMap& satData )
    {
 
+      if( incremental )
+      {
+         prepareIncremental(epoch, source, satData);
+
+         if(debugIncremental)
+         {
+            checkIncremental(source, satData);
+         }
+
+         isPrepared = true;
+         return (*this);
+      }
+
       // Prepare set of current unknowns and set of current equations
       currentUnkSet = prepareEquations(source, satData);
 
@@ -270,6 +289,560 @@ namespace gnssSpace
 
 
 
+      // Incremental version of Prepare()
+   void EquSysForPoint::prepareIncremental( CommonTime& epoch,
+                                            SourceID& currentSource,
+                                            satTypeValueMap& satData )
+   {
+      bool changed(false);
+
+      bool reset(false);
+      if( !isCompiled )
+      {
+         reset = compileEquations();
+         isCompiled = true;
+      }
+
+      if( currentSource != source )
+      {
+         source = currentSource;
+         reset = true;
+      }
+
+      if( reset )
+      {
+         resetBlocks();
+         changed = true;
+      }
+
+         // Both maps are sorted by satellite: the blocks without data are
+         // the satellites that set
+      std::map<SatID, SatBlock>::iterator itBlock = satBlocks.begin();
+      for( satTypeValueMap::const_iterator itSat = satData.begin();
+           itSat != satData.end();
+           ++itSat )
+      {
+         const SatID& sat( itSat->first );
+
+         while( itBlock != satBlocks.end() && itBlock->first < sat )
+         {
+            removeBlock(itBlock->second);
+            satBlocks.erase(itBlock++);
+            changed = true;
+         }
+
+         makeSignature(sat, itSat->second);
+
+         if( itBlock != satBlocks.end() && itBlock->first == sat )
+         {
+            SatBlock& block( itBlock->second );
+            block.pData = &(itSat->second);
+
+               // Rebuild the satellite if it has new types or a slip
+            if( block.state != sigState || block.arcs != sigArcs )
+            {
+               removeBlock(block);
+               addBlock(sat, block);
+               changed = true;
+            }
+
+            ++itBlock;
+         }
+         else
+         {
+               // New satellite
+            std::map<SatID, SatBlock>::iterator itNew
+               = satBlocks.insert(itBlock, std::make_pair(sat, SatBlock()));
+            itNew->second.pData = &(itSat->second);
+            addBlock(sat, itNew->second);
+            changed = true;
+         }
+      }
+
+      while( itBlock != satBlocks.end() )
+      {
+         removeBlock(itBlock->second);
+         satBlocks.erase(itBlock++);
+         changed = true;
+      }
+
+      if(currentEquSet.size() ==0)
+      {
+          InvalidEquSysForPoint e("equation number is zero!");
+          THROW(e);
+      }
+
+      if( changed || !indexSettled )
+      {
+         setUpIncrementalIndex(changed);
+      }
+
+      fillIncremental(epoch, changed);
+
+   }  // End of method 'EquSysForPoint::prepareIncremental()'
+
+
+      // Compile equDescripSet into equTemplates
+   bool EquSysForPoint::compileEquations()
+   {
+      std::vector<EquTemplate> templates;
+      templates.reserve(equDescripSet.size());
+
+      for( std::set<Equation>::const_iterator itEqu = equDescripSet.begin();
+           itEqu != equDescripSet.end();
+           ++itEqu )
+      {
+         EquTemplate tmpl;
+         tmpl.descrip = (*itEqu);
+         tmpl.descrip.clear();
+         tmpl.indepType = itEqu->header.indTerm.getType();
+
+         for( VarCoeffMap::const_iterator itVar = itEqu->body.begin();
+              itVar != itEqu->body.end();
+              ++itVar )
+         {
+            tmpl.vars.push_back(itVar->first);
+            tmpl.coefs.push_back(itVar->second);
+
+               // 模糊度参数, BL1G: the arc number is in satArcL1G
+            TypeID arcType;
+            if( itVar->first.getArcIndexed() )
+            {
+               std::string name( itVar->first.getType().asString() );
+               arcType = TypeID( "satArc" + name.substr(1, name.length()) );
+            }
+            tmpl.arcTypes.push_back(arcType);
+         }
+
+         templates.push_back(tmpl);
+      }
+
+         // Same descriptions: keep the equations of the previous epoch
+      bool same( templates.size() == equTemplates.size() );
+      for( size_t i = 0; same && i < templates.size(); i++ )
+      {
+         const EquTemplate& a( templates[i] );
+         const EquTemplate& b( equTemplates[i] );
+
+         same = ( a.indepType == b.indepType &&
+                  a.descrip.header.satSys == b.descrip.header.satSys &&
+                  a.descrip.header.constWeight == b.descrip.header.constWeight &&
+                  a.descrip.header.orderIndex == b.descrip.header.orderIndex &&
+                  a.vars.size() == b.vars.size() );
+
+         for( size_t j = 0; same && j < a.vars.size(); j++ )
+         {
+            const Variable& va( a.vars[j] );
+            const Variable& vb( b.vars[j] );
+            same = ( va == vb &&
+                     va.getModel() == vb.getModel() &&
+                     va.getSourceIndexed() == vb.getSourceIndexed() &&
+                     va.getSatIndexed() == vb.getSatIndexed() &&
+                     va.getArcIndexed() == vb.getArcIndexed() &&
+                     va.getInitialVariance() == vb.getInitialVariance() &&
+                     va.getTypeOrder() == vb.getTypeOrder() &&
+                     a.coefs[j] == b.coefs[j] );
+         }
+      }
+
+      if( same )
+      {
+         return false;
+      }
+
+      equTemplates.swap(templates);
+      return true;
+
+   }  // End of method 'EquSysForPoint::compileEquations()'
+
+
+      // Structure of the equations of a satellite into sigState/sigArcs
+   void EquSysForPoint::makeSignature( const SatID& sat,
+                                       const typeValueMap& tvData )
+   {
+      sigState.assign(equTemplates.size(), 0);
+      sigArcs.clear();
+
+      for( size_t i = 0; i < equTemplates.size(); i++ )
+      {
+         const EquTemplate& tmpl( equTemplates[i] );
+
+         if( tmpl.descrip.header.satSys != sat.system ||
+             tvData.find(tmpl.indepType) == tvData.end() )
+         {
+            continue;
+         }
+
+         bool found(true);
+         for( size_t j = 0; j < tmpl.vars.size(); j++ )
+         {
+            if( !tmpl.coefs[j].isConst &&
+                tvData.find(tmpl.coefs[j].coeffType) == tvData.end() )
+            {
+               found = false;
+            }
+
+            if( tmpl.vars[j].getArcIndexed() )
+            {
+               typeValueMap::const_iterator itArc
+                  = tvData.find(tmpl.arcTypes[j]);
+               if( itArc == tvData.end() )
+               {
+                  cerr << "EquSysForPoint: no " << tmpl.arcTypes[j]
+                       << " for " << sat << endl;
+                  exit(-1);
+               }
+               sigArcs.push_back(itArc->second);
+            }
+         }
+
+         sigState[i] = found ? 2 : 1;
+      }
+
+   }  // End of method 'EquSysForPoint::makeSignature()'
+
+
+      // Add the equations and unknowns of a satellite, from sigState and
+      // sigArcs
+   void EquSysForPoint::addBlock( const SatID& sat, SatBlock& block )
+   {
+      block.state = sigState;
+      block.arcs = sigArcs;
+      block.equs.clear();
+
+      size_t iArc(0);
+      for( size_t i = 0; i < equTemplates.size(); i++ )
+      {
+         if( block.state[i] == 0 )
+         {
+            continue;
+         }
+
+         const EquTemplate& tmpl( equTemplates[i] );
+
+         SatBlock::Equ equ;
+         equ.tmpl = i;
+         equ.hasRow = false;
+
+         Equation equation( tmpl.descrip );
+         equation.header.equationSource = source;
+         equation.header.equationSat = sat;
+
+         for( size_t j = 0; j < tmpl.vars.size(); j++ )
+         {
+            Variable var( tmpl.vars[j] );
+
+            if( var.getSourceIndexed() )
+            {
+               var.setSource( source );
+            }
+
+            if( var.getSatIndexed() )
+            {
+               var.setSatellite( sat );
+            }
+
+            if( var.getArcIndexed() )
+            {
+               var.setArc( block.arcs[iArc++] );
+            }
+
+            std::pair<UnkMap::iterator, bool> res
+               = unkMap.insert( std::make_pair(var, UnkInfo()) );
+            if( res.second && !resetIndex.empty() )
+            {
+               std::map<Variable, int>::const_iterator itOld
+                  = resetIndex.find(var);
+               if( itOld != resetIndex.end() )
+               {
+                  res.first->second.index = itOld->second;
+               }
+            }
+            res.first->second.refs++;
+            equ.unks.push_back(res.first);
+
+            equation.addVariable(var, tmpl.coefs[j]);
+         }
+
+         if( block.state[i] == 2 )
+         {
+            std::pair<std::set<Equation>::iterator, bool> res
+               = currentEquSet.insert(equation);
+            equ.hasRow = res.second;
+            equ.row = res.first;
+         }
+
+         block.equs.push_back(equ);
+      }
+
+   }  // End of method 'EquSysForPoint::addBlock()'
+
+
+      // Remove the equations and unknowns of a satellite. The unknowns are
+      // only erased by setUpIncrementalIndex(), so a satellite removed and
+      // added again keeps them, with their index.
+   void EquSysForPoint::removeBlock( SatBlock& block )
+   {
+      for( size_t i = 0; i < block.equs.size(); i++ )
+      {
+         SatBlock::Equ& equ( block.equs[i] );
+
+         if( equ.hasRow )
+         {
+            currentEquSet.erase(equ.row);
+         }
+
+         for( size_t j = 0; j < equ.unks.size(); j++ )
+         {
+            equ.unks[j]->second.refs--;
+         }
+      }
+
+      block.equs.clear();
+      block.state.clear();
+      block.arcs.clear();
+
+   }  // End of method 'EquSysForPoint::removeBlock()'
+
+
+      // Remove all the satellites, keeping the indexes of the unknowns
+   void EquSysForPoint::resetBlocks()
+   {
+      resetIndex.clear();
+      for( UnkMap::const_iterator it = unkMap.begin();
+           it != unkMap.end();
+           ++it )
+      {
+         if( it->second.index >= 0 )
+         {
+            resetIndex.insert( resetIndex.end(),
+                               std::make_pair(it->first, it->second.index) );
+         }
+      }
+
+      satBlocks.clear();
+      currentEquSet.clear();
+      unkMap.clear();
+
+   }  // End of method 'EquSysForPoint::resetBlocks()'
+
+
+      // Indexes of the unknowns, row plans and origins
+   void EquSysForPoint::setUpIncrementalIndex( bool changed )
+   {
+      currentUnkSet.clear();
+
+      int nowIndex(0);
+      UnkMap::iterator itUnk = unkMap.begin();
+      while( itUnk != unkMap.end() )
+      {
+         if( itUnk->second.refs == 0 )
+         {
+            unkMap.erase(itUnk++);
+            continue;
+         }
+
+         UnkInfo& info( itUnk->second );
+
+            // the index of the previous epoch, -1 for a new unknown
+         info.preIndex = info.index;
+         info.index = nowIndex++;
+         if( changed )
+         {
+            info.origin = NULL;
+         }
+
+         Variable var( itUnk->first );
+         var.setNowIndex( info.index );
+         var.setPreIndex( info.preIndex );
+         currentUnkSet.insert( currentUnkSet.end(), var );
+
+         ++itUnk;
+      }
+
+      resetIndex.clear();
+
+         // Next epoch, if nothing changes, all the preIndex are nowIndex
+      indexSettled = !changed;
+      for( UnkMap::const_iterator it = unkMap.begin();
+           indexSettled && it != unkMap.end();
+           ++it )
+      {
+         indexSettled = ( it->second.preIndex == it->second.index );
+      }
+
+      if( !changed )
+      {
+         return;
+      }
+
+         // Rows of the equations, in the order of 'currentEquSet'
+      std::unordered_map<const Equation*, int> rowOf;
+      int row(0);
+      for( std::set<Equation>::const_iterator itEqu = currentEquSet.begin();
+           itEqu != currentEquSet.end();
+           ++itEqu )
+      {
+         rowOf[&(*itEqu)] = row++;
+      }
+
+      rowPlans.resize( currentEquSet.size() );
+
+      for( std::map<SatID, SatBlock>::const_iterator itBlock = satBlocks.begin();
+           itBlock != satBlocks.end();
+           ++itBlock )
+      {
+         const SatBlock& block( itBlock->second );
+
+         for( size_t i = 0; i < block.equs.size(); i++ )
+         {
+            const SatBlock::Equ& equ( block.equs[i] );
+
+            for( size_t j = 0; j < equ.unks.size(); j++ )
+            {
+               if( equ.unks[j]->second.origin == NULL )
+               {
+                  equ.unks[j]->second.origin = &block;
+               }
+            }
+
+            if( !equ.hasRow )
+            {
+               continue;
+            }
+
+            RowPlan& plan( rowPlans[ rowOf[&(*equ.row)] ] );
+            plan.pBlock = &block;
+            plan.pTmpl = &equTemplates[equ.tmpl];
+            plan.cols.resize( equ.unks.size() );
+            for( size_t j = 0; j < equ.unks.size(); j++ )
+            {
+               plan.cols[j] = equ.unks[j]->second.index;
+            }
+         }
+      }
+
+   }  // End of method 'EquSysForPoint::setUpIncrementalIndex()'
+
+
+      // Values of the matrices and vectors. When the structure didn't
+      // change, the same elements are written again and the zeros kept.
+   void EquSysForPoint::fillIncremental( CommonTime& epoch, bool changed )
+   {
+      const int numEqu( currentEquSet.size() );
+      const int numVar( unkMap.size() );
+
+      if( changed )
+      {
+         phiMatrix = MatrixXd::Zero(numVar, numVar);
+         qMatrix = MatrixXd::Zero(numVar, numVar);
+         hMatrix = MatrixXd::Zero(numEqu, numVar);
+         weightsVector.resize(numEqu);
+         measVector.resize(numEqu);
+      }
+
+      int i(0);
+      for( UnkMap::const_iterator itUnk = unkMap.begin();
+           itUnk != unkMap.end();
+           ++itUnk, ++i )
+      {
+         const Variable& var( itUnk->first );
+
+            // a copy, as the models get a non-const map
+         tvScratch = *(itUnk->second.origin->pData);
+
+         var.getModel()->Prepare( epoch,
+                                  var.getSource(),
+                                  var.getSatellite(),
+                                  tvScratch );
+
+         phiMatrix(i,i) = var.getModel()->getPhi();
+         qMatrix(i,i)   = var.getModel()->getQ();
+      }
+
+      for( int row = 0; row < numEqu; row++ )
+      {
+         const RowPlan& plan( rowPlans[row] );
+         const typeValueMap& tData( *(plan.pBlock->pData) );
+         const EquTemplate& tmpl( *plan.pTmpl );
+
+         measVector(row) = tData.find(tmpl.indepType)->second;
+
+         typeValueMap::const_iterator itWeight = tData.find(TypeID::weight);
+         if( itWeight != tData.end() )
+         {
+            weightsVector(row) = tmpl.descrip.header.constWeight * itWeight->second;
+         }
+         else
+         {
+            weightsVector(row) = tmpl.descrip.header.constWeight;
+         }
+
+         for( size_t j = 0; j < plan.cols.size(); j++ )
+         {
+            const Coefficient& coef( tmpl.coefs[j] );
+            hMatrix(row, plan.cols[j])
+               = coef.isConst ? coef.constCoeff
+                              : tData.find(coef.coeffType)->second;
+         }
+      }
+
+   }  // End of method 'EquSysForPoint::fillIncremental()'
+
+
+
+      // Compare the incremental results with the default mode. The
+      // phiMatrix and qMatrix are not compared: the stochastic models keep
+      // their state, so they can't be prepared twice for the same epoch.
+   void EquSysForPoint::checkIncremental( SourceID& source,
+                                          satTypeValueMap& satData )
+   {
+      EquSysForPoint full;
+      full.equDescripSet = equDescripSet;
+      full.currentUnkSet = full.prepareEquations(source, satData);
+      full.preparePrefitGeometryWeights();
+
+      bool same( full.currentEquSet.size() == currentEquSet.size() &&
+                 full.currentUnkSet.size() == unkMap.size() );
+
+      if( same )
+      {
+         VariableSet::const_iterator itVar = full.currentUnkSet.begin();
+         for( UnkMap::const_iterator itUnk = unkMap.begin();
+              itUnk != unkMap.end();
+              ++itUnk, ++itVar )
+         {
+            if( (*itVar) != itUnk->first )
+            {
+               same = false;
+               break;
+            }
+         }
+      }
+
+      if( same )
+      {
+         same = ( full.hMatrix == hMatrix &&
+                  full.weightsVector == weightsVector &&
+                  full.measVector == measVector );
+      }
+
+      if( !same )
+      {
+         cerr << "EquSysForPoint: incremental mode differs from default mode"
+              << endl;
+         cerr << "equations " << currentEquSet.size()
+              << " vs " << full.currentEquSet.size()
+              << ", unknowns " << unkMap.size()
+              << " vs " << full.currentUnkSet.size() << endl;
+
+         InvalidEquSysForPoint e("incremental mode differs from default mode");
+         THROW(e);
+      }
+
+   }  // End of method 'EquSysForPoint::checkIncremental()'
+
+
       // Compute PhiMatrix
    void EquSysForPoint::preparePhiQ(CommonTime& epoch)
    {
@@ -323,10 +896,10 @@ namespace gnssSpace
          THROW(InvalidEquSysForPoint("currentUnkSet is empty, you must set it first!"));
       }
 
-      // Resize hMatrix and rMatrix
+      // Resize hMatrix and weightsVector
       // MUST INITIALIZE WITH ZERO METHOD !!!!
       hMatrix = MatrixXd::Zero( numEqu, numVar);
-      rMatrix = MatrixXd::Zero(numEqu, numEqu);
+      weightsVector = VectorXd::Zero(numEqu);
 
       // We need an equation index
       int row(0);
@@ -352,12 +925,12 @@ namespace gnssSpace
          if( tData.find(TypeID::weight) != tData.end() )
          {
             // Weights matrix = Equation weight * observation weight
-            rMatrix(row,row) = equ.header.constWeight * tData(TypeID::weight);
+            weightsVector(row) = equ.header.constWeight * tData(TypeID::weight);
          }
          else
          {
             // Weights matrix = Equation weight
-            rMatrix(row,row) = equ.header.constWeight;
+            weightsVector(row) = equ.header.constWeight;
          }
 
          // Second, fill geometry matrix: Look for equation coefficients
@@ -473,7 +1046,7 @@ namespace gnssSpace
        * \warning You must call method Prepare() first, otherwise this
        * method will throw an InvalidEquSysForPoint exception.
        */
-   VectorXd EquSysForPoint::getPrefitsVector() const
+   const VectorXd& EquSysForPoint::getPrefitsVector() const
       noexcept(false)
    {
          // If the object as not ready, throw an exception
@@ -493,7 +1066,7 @@ namespace gnssSpace
        * \warning You must call method Prepare() first, otherwise this
        * method will throw an InvalidEquSysForPoint exception.
        */
-   MatrixXd EquSysForPoint::getGeometryMatrix() const
+   const MatrixXd& EquSysForPoint::getGeometryMatrix() const
       noexcept(false)
    {
          // If the object as not ready, throw an exception
@@ -506,13 +1079,14 @@ namespace gnssSpace
 
 
 
-      /* Get weights matrix, given the current equation system definition
-       *  and the GDS' involved.
+      /* Get the weights of the equations (diagonal of the weights
+       * matrix), given the current equation system definition and the
+       * GDS' involved.
        *
        * \warning You must call method Prepare() first, otherwise this
        * method will throw an InvalidEquSysForPoint exception.
        */
-   MatrixXd EquSysForPoint::getWeightsMatrix() const
+   const VectorXd& EquSysForPoint::getWeightsVector() const
       noexcept(false)
    {
          // If the object as not ready, throw an exception
@@ -520,7 +1094,22 @@ namespace gnssSpace
       {
          THROW(InvalidEquSysForPoint("EquSysForPoint is not prepared"));
       }
-      return rMatrix;
+      return weightsVector;
+
+   }  // End of method 'EquSysForPoint::getWeightsVector()'
+
+
+      /* Get weights matrix, given the current equation system definition
+       * and the GDS' involved.
+       *
+       * \warning You must call method Prepare() first, otherwise this
+       * method will throw an InvalidEquSysForPoint exception.
+       */
+   MatrixXd EquSysForPoint::getWeightsMatrix() const
+      noexcept(false)
+   {
+      MatrixXd wMatrix( getWeightsVector().asDiagonal() );
+      return wMatrix;
 
    }  // End of method 'EquSysForPoint::getWeightsMatrix()'
 
@@ -531,7 +1120,7 @@ namespace gnssSpace
        * \warning You must call method Prepare() first, otherwise this
        * method will throw an InvalidEquSysForPoint exception.
        */
-   MatrixXd EquSysForPoint::getPhiMatrix() const
+   const MatrixXd& EquSysForPoint::getPhiMatrix() const
       noexcept(false)
    {
          // If the object as not ready, throw an exception
@@ -550,7 +1139,7 @@ namespace gnssSpace
        * \warning You must call method Prepare() first, otherwise this
        * method will throw an InvalidEquSysForPoint exception.
        */
-   MatrixXd EquSysForPoint::getQMatrix() const
+   const MatrixXd& EquSysForPoint::getQMatrix() const
       noexcept(false)
    {
          // If the object as not ready, throw an exception
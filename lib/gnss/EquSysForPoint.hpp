@@ -21,6 +21,8 @@
 
 
 #include <algorithm>
+#include <vector>
+#include <map>
 
 #include "DataStructures.hpp"
 #include "StochasticModel.hpp"
@@ -151,10 +153,31 @@ namespace gnssSpace
 
          /// Default constructor
       EquSysForPoint()
-         : isPrepared(false)
+         : incremental(false), isCompiled(false), indexSettled(false),
+           isPrepared(false)
       {};
 
 
+         /** Incremental mode. The equation descriptions are compiled once,
+          *  and the equations and unknowns are kept from one epoch to the
+          *  next: only the satellites that rise, set, or whose equations
+          *  change (new observation types, cycle slips of the arc-indexed
+          *  variables) are removed and added again, and the values are
+          *  filled into the matrices of the previous epoch. The results
+          *  are the same as in the default mode, but the unknowns and the
+          *  equations don't carry their typeValueData.
+          *
+          *  The descriptions are compared with the compiled ones when they
+          *  are set again, so a solver may still define its equations at
+          *  each epoch.
+          */
+      EquSysForPoint& setIncremental(bool incr)
+      { incremental = incr; isCompiled = false; return (*this); };
+
+      bool getIncremental() const
+      { return incremental; };
+
+
          /** Add a new equation to be managed.
           *
           * @param equation   Equation object to be added.
@@ -204,7 +227,7 @@ namespace gnssSpace
           * \warning You must call method Prepare() first, otherwise this
           * method will throw an InvalidEquSysForPoint exception.
           */
-      virtual VectorXd getPrefitsVector() const
+      virtual const VectorXd& getPrefitsVector() const
          noexcept(false);
 
 
@@ -214,12 +237,25 @@ namespace gnssSpace
           * \warning You must call method Prepare() first, otherwise this
           * method will throw an InvalidEquSysForPoint exception.
           */
-      virtual MatrixXd getGeometryMatrix() const
+      virtual const MatrixXd& getGeometryMatrix() const
+         noexcept(false);
+
+
+         /** Get the weights of the equations, given the current equation
+          *  system definition and the GDS' involved. The observations are
+          *  uncorrelated, so this is the diagonal of the weights matrix;
+          *  use w.asDiagonal() in the products.
+          *
+          * \warning You must call method Prepare() first, otherwise this
+          * method will throw an InvalidEquSysForPoint exception.
+          */
+      virtual const VectorXd& getWeightsVector() const
          noexcept(false);
 
 
          /** Get weights matrix, given the current equation system definition
-          *  and the GDS' involved.
+          *  and the GDS' involved. It is built from getWeightsVector() at
+          *  each call.
           *
           * \warning You must call method Prepare() first, otherwise this
           * method will throw an InvalidEquSysForPoint exception.
@@ -234,7 +270,7 @@ namespace gnssSpace
           * \warning You must call method Prepare() first, otherwise this
           * method will throw an InvalidEquSysForPoint exception.
           */
-      virtual MatrixXd getPhiMatrix() const
+      virtual const MatrixXd& getPhiMatrix() const
          noexcept(false);
 
 
@@ -244,7 +280,7 @@ namespace gnssSpace
           * \warning You must call method Prepare() first, otherwise this
           * method will throw an InvalidEquSysForPoint exception.
           */
-      virtual MatrixXd getQMatrix() const
+      virtual const MatrixXd& getQMatrix() const
          noexcept(false);
 
 
@@ -257,11 +293,11 @@ namespace gnssSpace
       { return currentEquSet.size(); };
 
          /// Get the set of current equations.
-      virtual std::set<Equation> getDescripEqus() const
+      virtual const std::set<Equation>& getDescripEqus() const
       { return equDescripSet; };
 
          /// Get the set of current equations.
-      virtual std::set<Equation> getCurrentEquationsSet() const
+      virtual const std::set<Equation>& getCurrentEquationsSet() const
       { return currentEquSet; };
 
       void dumpDescripEquations(std::ostream& os) 
@@ -297,8 +333,126 @@ namespace gnssSpace
 
    private:
 
+         /// Equation description compiled for the incremental mode
+      struct EquTemplate
+      {
+            /// Description, with the header of the equations
+         Equation descrip;
+
+         TypeID indepType;
+
+            /// Variables, coefficients, and the type of the arc number of
+            /// the arc-indexed variables, in the order of the body
+         std::vector<Variable> vars;
+         std::vector<Coefficient> coefs;
+         std::vector<TypeID> arcTypes;
+      };
+
+      struct SatBlock;
+
+         /// Unknown of the incremental mode
+      struct UnkInfo
+      {
+         UnkInfo() : refs(0), index(-1), preIndex(-1), origin(NULL) {};
+
+            /// Number of equations of the satellites using it
+         int refs;
+
+         int index;
+         int preIndex;
+
+            /// Satellite whose data prepare the stochastic model: the
+            /// first one using it, as in the default mode
+         const SatBlock* origin;
+      };
+
+      typedef std::map<Variable, UnkInfo> UnkMap;
+
+         /// Equations of one satellite in the incremental mode
+      struct SatBlock
+      {
+            /// Equation of one template
+         struct Equ
+         {
+            int tmpl;
+            bool hasRow;
+            std::set<Equation>::iterator row;
+            std::vector<UnkMap::iterator> unks;
+         };
+
+            /// Data of the satellite at this epoch
+         const typeValueMap* pData;
+
+            /// Structure: for each template, 0 if the independent term is
+            /// missing, 1 if a coefficient is missing (the unknowns are
+            /// kept, as in the default mode), 2 for an equation; and the
+            /// arc numbers
+         std::vector<char> state;
+         std::vector<double> arcs;
+
+         std::vector<Equ> equs;
+      };
+
+         /// Row of the geometry matrix, filled at each epoch
+      struct RowPlan
+      {
+         const SatBlock* pBlock;
+         const EquTemplate* pTmpl;
+         std::vector<int> cols;
+      };
+
+         /// Incremental version of Prepare()
+      void prepareIncremental( CommonTime& epoch,
+                               SourceID& source,
+                               satTypeValueMap& satData );
+
+         /// Compile equDescripSet into equTemplates
+         /// @return true if they are different from the compiled ones
+      bool compileEquations();
+
+         /// Structure of the equations of a satellite into sigState/sigArcs
+      void makeSignature( const SatID& sat, const typeValueMap& tvData );
+
+         /// Add/remove the equations and unknowns of a satellite
+      void addBlock( const SatID& sat, SatBlock& block );
+      void removeBlock( SatBlock& block );
+
+         /// Remove all the satellites, keeping the indexes of the unknowns
+         /// for the preIndex of the next epoch
+      void resetBlocks();
+
+         /// Indexes of the unknowns, row plans and origins
+      void setUpIncrementalIndex( bool changed );
+
+         /// Values of the matrices and vectors
+      void fillIncremental( CommonTime& epoch, bool changed );
+
+         /// Compare the incremental results with the default mode, enabled
+         /// by debugIncremental in EquSysForPoint.cpp
+      void checkIncremental( SourceID& source, satTypeValueMap& satData );
+
       SourceID source;
 
+         /// Incremental mode, see setIncremental()
+      bool incremental;
+      bool isCompiled;
+
+         /// preIndex == nowIndex for all the unknowns
+      bool indexSettled;
+
+      std::vector<EquTemplate> equTemplates;
+      UnkMap unkMap;
+      std::map<SatID, SatBlock> satBlocks;
+      std::vector<RowPlan> rowPlans;
+
+         /// Indexes of the unknowns before resetBlocks()
+      std::map<Variable, int> resetIndex;
+
+         /// Work data
+      std::vector<char> sigState;
+      std::vector<double> sigArcs;
+      typeValueMap tvScratch;
+
       /// Set containing the DESCRIPTIONS of Equation objects.
       std::set<Equation> equDescripSet;
 
@@ -323,8 +477,8 @@ namespace gnssSpace
          /// Geometry matrix
       MatrixXd hMatrix;
 
-         /// Weights matrix
-      MatrixXd rMatrix;
+         /// Weights of the equations, diagonal of the weights matrix
+      VectorXd weightsVector;
 
          /// Measurements vector (Prefit-residuals)
       VectorXd measVector;
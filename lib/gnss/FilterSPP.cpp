@@ -255,13 +255,11 @@ namespace gnssSpace
          // Get the set with unknowns being processed
          currentUnkSet =  equSystem.getVarUnknowns() ;
 
-         std::set<Equation> currentEquSet;
-         currentEquSet = equSystem.getCurrentEquationsSet();
+         const std::set<Equation>& currentEquSet
+            = equSystem.getCurrentEquationsSet();
 
          if(debug)
          {
-             std::set<Equation> currentEquSet;
-             currentEquSet = equSystem.getCurrentEquationsSet();
              for(std::set<Equation>::iterator it=currentEquSet.begin();
                      it!=currentEquSet.end();
                      ++it)
@@ -283,7 +281,7 @@ namespace gnssSpace
          // Measurements vector (Prefit-residuals)
          measVector = equSystem.getPrefitsVector();
          hMatrix = equSystem.getGeometryMatrix();
-         rMatrix = equSystem.getWeightsMatrix();
+         rVector = equSystem.getWeightsVector();
 
          int numMeas = measVector.size();
 
@@ -402,8 +400,8 @@ namespace gnssSpace
             cout << "hMatrix" << endl;
             cout <<  hMatrix<< endl;
 
-            cout << "rMatrix" << endl;
-            cout <<  rMatrix  << endl;
+            cout << "rVector" << endl;
+            cout <<  rVector  << endl;
 
             cout << "phiMatrix" << endl;
             cout <<  phiMatrix  << endl;
@@ -430,19 +428,21 @@ namespace gnssSpace
          /////////////////////////////
 
          // After checking sizes, let's do the real correction work
-         MatrixXd invPMinus;
-
-         try
-         {
-            invPMinus = Pminus.inverse();
-         }
-         catch(...)
+         Eigen::LLT<MatrixXd> pMinusLLT(Pminus);
+         if( pMinusLLT.info() != Eigen::Success )
          {
             InvalidSolver e("MeasUpdate(): Unable to compute invPMinus matrix.");
             cerr << e << endl;
             exit(-1);
          }
 
+         // Pminus = L*L', the inverse in the normal matrix is inv(L)'*inv(L),
+         // and the products with a vector are solved with L
+         MatrixXd invL( pMinusLLT.matrixL().solve(
+                     MatrixXd::Identity(Pminus.rows(), Pminus.cols()) ) );
+         MatrixXd invPMinus( invL.transpose() * invL );
+         VectorXd invPMinusX( pMinusLLT.solve(xhatminus) );
+
          MatrixXd hMatrixT( hMatrix.transpose() );
 
          // detect outliers 
@@ -455,20 +455,21 @@ namespace gnssSpace
              }
 
              // Compute the a posteriori error covariance matrix
-             try
-             {
-                MatrixXd invTemp( hMatrixT * rMatrix * hMatrix + invPMinus );
+             MatrixXd invTemp( hMatrixT * rVector.asDiagonal() * hMatrix + invPMinus );
 
-                P = invTemp.inverse() ;
-                xhat = P * ( (hMatrixT * rMatrix * measVector) + (invPMinus * xhatminus) );
-             }
-             catch(Exception e)
+             Eigen::LLT<MatrixXd> invTempLLT(invTemp);
+             if( invTempLLT.info() != Eigen::Success )
              {
                 InvalidSolver eis("MeasUpdate(): Unable to compute xhat.");
                 cerr << eis << endl;
                 exit(-1);
              }
 
+             xhat = invTempLLT.solve( (hMatrixT * rVector.cwiseProduct(measVector))
+                                      + invPMinusX );
+             P = invTempLLT.solve(
+                     MatrixXd::Identity(invTemp.rows(), invTemp.cols()) );
+
              solution = xhat;
              covMatrix = P;
 
@@ -482,20 +483,10 @@ namespace gnssSpace
              double totalVTPV, VTPV(0.0),VxPVx(0.0);
              for( int i = 0; i < numMeas; ++i)
              {
-                 VTPV += postfitVec(i)*postfitVec(i)*rMatrix(i,i);
+                 VTPV += postfitVec(i)*postfitVec(i)*rVector(i);
              }
 
-             for( int i = 0; i<xhat.size(); ++i)
-             {
-                 double VxP(0.0);
-
-                 for( int j = 0; j<xhat.size(); ++j)
-                 {
-                     VxP += VXVec(j)*invPMinus(j,i);
-                 }
-
-                 VxPVx += VxP*VXVec(i);
-             }
+             VxPVx = pMinusLLT.matrixL().solve(VXVec).squaredNorm();
 
              totalVTPV = VTPV + VxPVx;
              
@@ -535,16 +526,16 @@ namespace gnssSpace
                  break;
              }
 
-             MatrixXd RMatrix = rMatrix.inverse();
-
              // else , local hypothesis test
-             MatrixXd QVV = RMatrix - hMatrix*covMatrix* hMatrix.transpose();
+             // only the diagonal of QVV = R^-1 - H*P*H' is needed
+             VectorXd QVV = rVector.cwiseInverse()
+                 - (hMatrix*covMatrix).cwiseProduct(hMatrix).rowwise().sum();
 
              // Suppose sigma0 is known
              std::vector<double> standardResidual(numMeas,0.0);
              for(int i = 0; i < numMeas; ++i)
              {
-                 standardResidual[i] = std::abs( postfitVec(i) ) /std::sqrt( QVV(i,i) );
+                 standardResidual[i] = std::abs( postfitVec(i) ) /std::sqrt( QVV(i) );
              }
 
              if(debug)
@@ -594,7 +585,7 @@ namespace gnssSpace
              if( standMax > thres2 )
              {
                  // a lower weight 
-                 rMatrix(indexMax, indexMax) = rMatrix(indexMax, indexMax)/100.0;
+                 rVector(indexMax) = rVector(indexMax)/100.0;
 
                  // 删除卫星 
                  Equation equ = findEquation(currentEquSet, indexMax);
@@ -734,7 +725,7 @@ namespace gnssSpace
        return delta;
    }
 
-   Equation FilterSPP::findEquation( std::set<Equation>& equSet,
+   Equation FilterSPP::findEquation( const std::set<Equation>& equSet,
                                         int index)
    {
        Equation tempEqu;
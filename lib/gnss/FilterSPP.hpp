@@ -52,6 +52,7 @@ namespace gnssSpace
           : firstTime(true)
       {
           Init();
+          equSystem.setIncremental(true);
           setUpEquations();
       }
 
@@ -92,7 +93,7 @@ namespace gnssSpace
                                   const VectorXd& stateVec ) const
          noexcept(false);
 
-      Equation findEquation( std::set<Equation>& equSet,
+      Equation findEquation( const std::set<Equation>& equSet,
                              int index);
 
       /// Returns an index identifying this object.
@@ -126,8 +127,8 @@ namespace gnssSpace
          /// Geometry matrix
       MatrixXd hMatrix;
 
-         /// Weights matrix
-      MatrixXd rMatrix;
+         /// Weights of the measurements, diagonal of the weights matrix
+      VectorXd rVector;
 
          /// Measurements vector (Prefit-residuals)
       VectorXd measVector;
@@ -84,92 +84,88 @@ namespace gnssSpace
         return drift;
     }
 
-    // Compute satellite relativity correction (sec) at the given time
-    // throw Invalid Request if the required data has not been stored.
-    double GPSEphemeris::svRelativity(const CommonTime& t) const
+    // Compute the orbit constants of this ephemeris into oc
+    void GPSEphemeris::computeOrbitConstants(KeplerOrbitConst& oc) const
     {
         GPSEllipsoid ell;
+
         ///Semi-major axis
-        double A = sqrt_A*sqrt_A;
+        oc.A = sqrt_A*sqrt_A;
+
+        ///Corrected mean motion (rad/sec)
+        double n0 = std::sqrt(ell.gm()/(oc.A*oc.A*oc.A));
+        oc.n = n0 + Delta_n;
+
+        oc.q = std::sqrt(1.0 - ecc*ecc);
+        oc.dlkFactor = sqrt_A * oc.q * std::sqrt(ell.gm());
+
+        ///Longitude of ascending node at the start of the week
+        oc.OMEGA_t0 = OMEGA_0 - ell.angVelocity() * Toe;
+        oc.OMEGA_rate = OMEGA_DOT - ell.angVelocity();
+
+        oc.relFactor = REL_CONST * ecc * SQRT(oc.A);
+
+        oc.valid = true;
+    }
+
+    void GPSEphemeris::setOrbitConstants()
+    {
+        computeOrbitConstants(orbConst);
+    }
 
-        ///Computed mean motion (rad/sec)
-        double n0 = std::sqrt(ell.gm()/(A*A*A));
+    const KeplerOrbitConst& GPSEphemeris::orbitConstants(KeplerOrbitConst& tmp) const
+    {
+        if(orbConst.valid) return orbConst;
+
+        computeOrbitConstants(tmp);
+        return tmp;
+    }
+
+    // Compute satellite relativity correction (sec) at the given time
+    // throw Invalid Request if the required data has not been stored.
+    double GPSEphemeris::svRelativity(const CommonTime& t) const
+    {
+        KeplerOrbitConst tmpConst;
+        const KeplerOrbitConst& oc = orbitConstants(tmpConst);
 
         ///Time from ephemeris reference epoch
         double tk = t - ctToe;
         if(tk > 302400)  tk = tk-604800;
         if(tk < -302400) tk = tk+604800;
 
-        ///Corrected mean motion
-        double n = n0 + Delta_n;
-
-        ///Mean anomaly
-        double Mk = M0 + n*tk;
-
-        ///Kepler's Equation for Eccentric Anomaly
-        ///solved by iteration
-        double twoPI = 2.0e0 * PI;
-        Mk = fmod(Mk, twoPI);
-        double Ek = Mk + ecc* ::sin(Mk);
-        int loop_cnt = 1;
-        double F,G,delea;
-        do  {
-            F = Mk - (Ek - ecc * ::sin(Ek));
-            G = 1.0 - ecc * ::cos(Ek);
-            delea = F/G;
-            Ek = Ek + delea;
-            loop_cnt++;
-        } while ((fabs(delea) > 1.0e-11) && (loop_cnt <= 20));
-
-        return (REL_CONST * ecc * SQRT(A) * ::sin(Ek));
-    }
+        ///Eccentric Anomaly
+        double Ek = solveKepler(M0 + oc.n*tk, ecc);
 
+        return (oc.relFactor * ::sin(Ek));
+    }
 
     Xvt GPSEphemeris::svXvt(const CommonTime& t) const
     {
         Xvt sv;
         GPSEllipsoid ell;
 
-        ///Semi-major axis
-        double A = sqrt_A*sqrt_A;
-
-        ///Computed mean motion (rad/sec)
-        double n0 = std::sqrt(ell.gm()/(A*A*A));
+        KeplerOrbitConst tmpConst;
+        const KeplerOrbitConst& oc = orbitConstants(tmpConst);
+        double A = oc.A;
+        double n = oc.n;
 
         ///Time from ephemeris reference epoch
         double tk = t - ctToe;
         if(tk > 302400)  tk = tk-604800;
         if(tk < -302400) tk = tk+604800;
 
-        ///Corrected mean motion
-        double n = n0 + Delta_n;
-
-        ///Mean anomaly
-        double Mk = M0 + n*tk;
-
-        ///Kepler's Equation for Eccentric Anomaly
-        ///solved by iteration
-        double twoPI = 2.0e0 * PI;
-        Mk = fmod(Mk, twoPI);
-        double Ek = Mk + ecc* ::sin(Mk);
-        int loop_cnt = 1;
-        double F,G,delea;
-        do  {
-            F = Mk - (Ek - ecc * ::sin(Ek));
-            G = 1.0 - ecc * ::cos(Ek);
-            delea = F/G;
-            Ek = Ek + delea;
-            loop_cnt++;
-        } while ((fabs(delea) > 1.0e-11) && (loop_cnt <= 20));
+        ///Kepler's Equation for Eccentric Anomaly, solved only once
+        ///for the position and the relativity correction
+        double Ek = solveKepler(M0 + n*tk, ecc);
 
         ///compute clock corrections
-        sv.relcorr = svRelativity(t);
+        sv.relcorr = oc.relFactor * ::sin(Ek);
         sv.clkbias = svClockBias(t);
         sv.clkdrift = svClockDrift(t);
         sv.frame = ReferenceFrame::WGS84;
 
         ///True Anomaly
-        double q = std::sqrt(1.0 - ecc*ecc);
+        double q = oc.q;
         double sinEk = ::sin(Ek);
         double cosEk = ::cos(Ek);
 
@@ -198,8 +194,7 @@ namespace gnssSpace
         double yip = rk * ::sin(uk);
 
         ///Corrected longitude of ascending node.
-        double OMEGA_k = OMEGA_0 + (OMEGA_DOT - ell.angVelocity())*tk
-                        - ell.angVelocity() * Toe;
+        double OMEGA_k = oc.OMEGA_t0 + oc.OMEGA_rate*tk;
 
         ///Earth-fixed coordinates.
         double sinOMG_k = ::sin(OMEGA_k);
@@ -217,9 +212,9 @@ namespace gnssSpace
         /// Compute velocity of rotation coordinates
         double dek,dlk,div,domk,duv,drv,dxp,dyp;
         dek = n * A / rk;
-        dlk = sqrt_A * q * std::sqrt(ell.gm()) / (rk*rk);
+        dlk = oc.dlkFactor / (rk*rk);
         div = IDOT - 2.0e0 * dlk * (Cic*sin2phi_k - Cis*cos2phi_k);
-        domk = OMEGA_DOT - ell.angVelocity();
+        domk = oc.OMEGA_rate;
         duv = dlk*(1.e0+ 2.e0 * (Cus*cos2phi_k - Cuc*sin2phi_k));
         drv = A * ecc * dek * sinEk - 2.e0 * dlk * (Crc * sin2phi_k - Crs * cos2phi_k);
         dxp = drv * ::cos(uk) - rk * ::sin(uk)*duv;
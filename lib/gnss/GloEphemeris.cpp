@@ -70,20 +70,116 @@ namespace gnssSpace
             return sv;
         }
 
-        double px_tmp( px );   // X coordinate (km)
-        double vx_tmp( vx );   // X velocity   (km/s)
-        double ax_tmp( ax );   // X acceleration (km/s^2)
-        double py_tmp( py );   // Y coordinate
-        double vy_tmp( vy );   // Y velocity
-        double ay_tmp( ay );   // Y acceleration
-        double pz_tmp( pz );   // Z coordinate
-        double vz_tmp( vz );   // Z velocity
-        double az_tmp( az );   // Z acceleration
-
         /// We will need some PZ-90 ellipsoid parameters
         PZ90Ellipsoid pz90;
         double we( pz90.angVelocity() );
 
+        double dt( epoch - ctToe );
+
+        double state[6];
+        double numSeconds, s0;
+        CommonTime workEpoch( ctToe );
+
+        {
+            std::lock_guard<std::mutex> lock(nodes.mtx);
+
+            if( !nodes.ready || nodes.step != step )
+            {
+                initNodes();
+            }
+
+            s0 = nodes.s0;
+
+            // nodes on the side of epoch, the last node between toe
+            // and epoch is the starting point
+            std::vector<double>& side = (dt < 0.0) ? nodes.bwd : nodes.fwd;
+            double rkStep( (dt < 0.0) ? -step : step );
+            double nodeSpan( nodes.nodeSteps * step );
+
+            long k( static_cast<long>( std::floor( std::fabs(dt)/nodeSpan ) ) );
+            long kmax( static_cast<long>( maxNodeSpan/nodeSpan ) );
+            if( k > kmax ) k = kmax;
+
+            // integrate the missing nodes, with the same steps as from toe
+            long n( side.size()/7 - 1 );
+            while( n < k )
+            {
+                double* last = &side[7*n];
+                for( int j = 0; j < 6; ++j ) state[j] = last[j];
+                numSeconds = last[6];
+
+                CommonTime nodeEpoch( ctToe );
+                nodeEpoch += n*nodeSpan*( (dt < 0.0) ? -1.0 : 1.0 );
+                CommonTime nextEpoch( nodeEpoch );
+                nextEpoch += nodes.nodeSteps*rkStep;
+
+                double cs, ss;
+                integrate( state, numSeconds, nodeEpoch, nextEpoch, s0, cs, ss );
+
+                for( int j = 0; j < 6; ++j ) side.push_back( state[j] );
+                side.push_back( numSeconds );
+                n++;
+            }
+
+            const double* node = &side[7*k];
+            for( int j = 0; j < 6; ++j ) state[j] = node[j];
+            numSeconds = node[6];
+
+            workEpoch += k*nodeSpan*( (dt < 0.0) ? -1.0 : 1.0 );
+        }
+
+        double s( s0 + we*numSeconds );
+        double cs( std::cos(s) );
+        double ss( std::sin(s) );
+
+        // Integrate satellite state from the node to desired epoch
+        integrate( state, numSeconds, workEpoch, epoch, s0, cs, ss );
+
+        double px_tmp = state[0];
+        double py_tmp = state[2];
+        double pz_tmp = state[4];
+        double vx_tmp = state[1];
+        double vy_tmp = state[3];
+        double vz_tmp = state[5];
+
+        sv.x[0] = 1000.0*( px_tmp*cs + py_tmp*ss );         // X coordinate
+        sv.x[1] = 1000.0*(-px_tmp*ss + py_tmp*cs);          // Y coordinate
+        sv.x[2] = 1000.0*pz_tmp;                        // Z coordinate
+        sv.v[0] = 1000.0*( vx_tmp*cs + vy_tmp*ss + we*(sv.x[1]/1000.0) ); // X velocity
+        sv.v[1] = 1000.0*(-vx_tmp*ss + vy_tmp*cs - we*(sv.x[0]/1000.0) ); // Y velocity
+        sv.v[2] = 1000.0*vz_tmp;                        // Z velocity
+
+        // In the GLONASS system, 'clkbias' already includes the relativistic
+        // correction, therefore we must substract the late from the former.
+        sv.relcorr = sv.computeRelativityCorrection();
+        sv.clkbias = TauN + GammaN * (epoch - ctToe) - sv.relcorr;
+        sv.clkdrift = GammaN;
+        sv.frame = ReferenceFrame::PZ90;
+
+        // We are done, let's return
+        return sv;
+    }
+
+
+    void GloEphemeris::clearNodes() const
+    {
+        std::lock_guard<std::mutex> lock(nodes.mtx);
+        nodes.clear();
+    }
+
+
+    // Fill the node at toe. Called with nodes.mtx locked.
+    void GloEphemeris::initNodes() const
+    {
+        nodes.clear();
+
+        nodes.step = step;
+        nodes.nodeSteps = static_cast<int>( nodeInterval/step + 0.5 );
+        if( nodes.nodeSteps < 1 ) nodes.nodeSteps = 1;
+
+        PZ90Ellipsoid pz90;
+        double we( pz90.angVelocity() );
+
         /// Get sidereal time at Greenwich at 0 hours UT
         double gst( getSidTime( ctToe ) );
         double s0( gst*PI/12.0 );
@@ -93,34 +189,54 @@ namespace gnssSpace
         double cs( std::cos(s) );
         double ss( std::sin(s) );
 
-        /// Initial state matrix
-        VectorXd initialState(6), accel(3), dxt1(6), dxt2(6), dxt3(6),
-                dxt4(6), tempRes(6);
+        double initialState[7];
 
         // Get the reference state out of GloEphemeris object data. Values
         // must be rotated from PZ-90 to an absolute coordinate system
         // Initial x coordinate (m)
-        initialState(0)  = (px_tmp*cs - py_tmp*ss);
+        initialState[0]  = (px*cs - py*ss);
         // Initial y coordinate
-        initialState(2)  = (px_tmp*ss + py_tmp*cs);
+        initialState[2]  = (px*ss + py*cs);
         // Initial z coordinate
-        initialState(4)  = pz_tmp;
+        initialState[4]  = pz;
 
         // Initial x velocity   (m/s)
-        initialState(1)  = (vx_tmp*cs - vy_tmp*ss - we*initialState(2) );
+        initialState[1]  = (vx*cs - vy*ss - we*initialState[2] );
         // Initial y velocity
-        initialState(3)  = (vx_tmp*ss + vy_tmp*cs + we*initialState(0) );
+        initialState[3]  = (vx*ss + vy*cs + we*initialState[0] );
         // Initial z velocity
-        initialState(5)  = vz_tmp;
+        initialState[5]  = vz;
 
+        initialState[6]  = numSeconds;
 
-        // Integrate satellite state to desired epoch using the given step
-        double rkStep( step );
+        nodes.s0 = s0;
+        nodes.fwd.assign( initialState, initialState + 7 );
+        nodes.bwd.assign( initialState, initialState + 7 );
+
+        nodes.ready = true;
+    }
 
-        if ( (epoch - ctToe) < 0.0 ) rkStep = step*(-1.0);
-        CommonTime workEpoch( ctToe );
+
+    // Integrate state from workEpoch to epoch using the given step
+    void GloEphemeris::integrate( double state[6],
+                                  double& numSeconds,
+                                  CommonTime& workEpoch,
+                                  const CommonTime& epoch,
+                                  double s0,
+                                  double& cs,
+                                  double& ss ) const
+    {
+        PZ90Ellipsoid pz90;
+        double we( pz90.angVelocity() );
 
         double tolerance( 1e-9 );
+        if ( std::fabs(epoch - workEpoch ) < tolerance ) return;
+
+        double rkStep( step );
+        if ( (epoch - workEpoch) < 0.0 ) rkStep = step*(-1.0);
+
+        double accel[3], dxt1[6], dxt2[6], dxt3[6], dxt4[6], tempRes[6];
+
         bool done( false );
         while (!done)
         {
@@ -139,31 +255,31 @@ namespace gnssSpace
             }
 
             numSeconds += rkStep;
-            s = s0 + we*( numSeconds );
+            double s( s0 + we*( numSeconds ) );
             cs = std::cos(s);
             ss = std::sin(s);
 
             // Accelerations are computed once per iteration
-            accel(0) = ax_tmp*cs - ay_tmp*ss;
-            accel(1) = ax_tmp*ss + ay_tmp*cs;
-            accel(2) = az_tmp;
+            accel[0] = ax*cs - ay*ss;
+            accel[1] = ax*ss + ay*cs;
+            accel[2] = az;
 
-            dxt1 = derivative( initialState, accel );
+            derivative( state, accel, dxt1 );
             for( int j = 0; j < 6; ++j )
-                tempRes(j) = initialState(j) + rkStep*dxt1(j)/2.0;
+                tempRes[j] = state[j] + rkStep*dxt1[j]/2.0;
 
-            dxt2 = derivative( tempRes, accel );
+            derivative( tempRes, accel, dxt2 );
             for( int j = 0; j < 6; ++j )
-                tempRes(j) = initialState(j) + rkStep*dxt2(j)/2.0;
+                tempRes[j] = state[j] + rkStep*dxt2[j]/2.0;
 
-            dxt3 = derivative( tempRes, accel );
+            derivative( tempRes, accel, dxt3 );
             for( int j = 0; j < 6; ++j )
-                tempRes(j) = initialState(j) + rkStep*dxt3(j);
+                tempRes[j] = state[j] + rkStep*dxt3[j];
 
-            dxt4 = derivative( tempRes, accel );
+            derivative( tempRes, accel, dxt4 );
             for( int j = 0; j < 6; ++j )
-                initialState(j) = initialState(j) + rkStep * ( dxt1(j)
-                                                               + 2.0 * ( dxt2(j) + dxt3(j) ) + dxt4(j) ) / 6.0;
+                state[j] = state[j] + rkStep * ( dxt1[j]
+                                                 + 2.0 * ( dxt2[j] + dxt3[j] ) + dxt4[j] ) / 6.0;
 
 
             // If we are within tolerance of the target time, we are done.
@@ -173,31 +289,8 @@ namespace gnssSpace
 
         }  // End of 'while (!done)...'
 
+    }  // End of method 'GloEphemeris::integrate()'
 
-        px_tmp = initialState(0);
-        py_tmp = initialState(2);
-        pz_tmp = initialState(4);
-        vx_tmp = initialState(1);
-        vy_tmp = initialState(3);
-        vz_tmp = initialState(5);
-
-        sv.x[0] = 1000.0*( px_tmp*cs + py_tmp*ss );         // X coordinate
-        sv.x[1] = 1000.0*(-px_tmp*ss + py_tmp*cs);          // Y coordinate
-        sv.x[2] = 1000.0*pz_tmp;                        // Z coordinate
-        sv.v[0] = 1000.0*( vx_tmp*cs + vy_tmp*ss + we*(sv.x[1]/1000.0) ); // X velocity
-        sv.v[1] = 1000.0*(-vx_tmp*ss + vy_tmp*cs - we*(sv.x[0]/1000.0) ); // Y velocity
-        sv.v[2] = 1000.0*vz_tmp;                        // Z velocity
-
-        // In the GLONASS system, 'clkbias' already includes the relativistic
-        // correction, therefore we must substract the late from the former.
-        sv.relcorr = sv.computeRelativityCorrection();
-        sv.clkbias = TauN + GammaN * (epoch - ctToe) - sv.relcorr;
-        sv.clkdrift = GammaN;
-        sv.frame = ReferenceFrame::PZ90;
-
-        // We are done, let's return
-        return sv;
-    }
 
     double GloEphemeris::getSidTime( const CommonTime& time ) const
     {
@@ -234,6 +327,25 @@ namespace gnssSpace
     VectorXd GloEphemeris::derivative( const VectorXd& inState,
                                              const VectorXd& accel )
     const
+    {
+        double in[6], acc[3], out[6];
+        for( int j = 0; j < 6; ++j ) in[j] = inState(j);
+        for( int j = 0; j < 3; ++j ) acc[j] = accel(j);
+
+        derivative( in, acc, out );
+
+        VectorXd dxt(6);
+        for( int j = 0; j < 6; ++j ) dxt(j) = out[j];
+
+        return dxt;
+
+    }  // End of method 'GloEphemeris::derivative()'
+
+
+    void GloEphemeris::derivative( const double inState[6],
+                                   const double accel[3],
+                                   double dxt[6] )
+    const
     {
 
         // We will need some important PZ90 ellipsoid values
@@ -243,12 +355,9 @@ namespace gnssSpace
         const double ae( pz90.a_km() );
 
         // Let's start getting the current satellite position and velocity
-        double  x( inState(0) );          // X coordinate
-        //double vx( inState(1) );          // X velocity
-        double  y( inState(2) );          // Y coordinate
-        //double vy( inState(3) );          // Y velocity
-        double  z( inState(4) );          // Z coordinate
-        //double vz( inState(5) );          // Z velocity
+        double  x( inState[0] );          // X coordinate
+        double  y( inState[2] );          // Y coordinate
+        double  z( inState[4] );          // Z coordinate
 
         double r2( x*x + y*y + z*z );
         double r( std::sqrt(r2) );
@@ -263,25 +372,17 @@ namespace gnssSpace
         double cmz( k1*(3.0-5.0*zr2) );
         double k2(cm-xmu);
 
-        double gloAx( k2*xr + accel(0) );
-        double gloAy( k2*yr + accel(1) );
-        double gloAz( (cmz-xmu)*zr + accel(2) );
-
-        VectorXd dxt = VectorXd::Zero(6);
-
         // Let's insert data related to X coordinates
-        dxt(0) = inState(1);       // Set X'  = Vx
-        dxt(1) = gloAx;            // Set Vx' = gloAx
+        dxt[0] = inState[1];                   // Set X'  = Vx
+        dxt[1] = k2*xr + accel[0];             // Set Vx' = gloAx
 
         // Let's insert data related to Y coordinates
-        dxt(2) = inState(3);       // Set Y'  = Vy
-        dxt(3) = gloAy;            // Set Vy' = gloAy
+        dxt[2] = inState[3];                   // Set Y'  = Vy
+        dxt[3] = k2*yr + accel[1];             // Set Vy' = gloAy
 
         // Let's insert data related to Z coordinates
-        dxt(4) = inState(5);       // Set Z'  = Vz
-        dxt(5) = gloAz;            // Set Vz' = gloAz
-
-        return dxt;
+        dxt[4] = inState[5];                   // Set Z'  = Vz
+        dxt[5] = (cmz-xmu)*zr + accel[2];      // Set Vz' = gloAz
 
     }  // End of method 'GloEphemeris::derivative()'
 
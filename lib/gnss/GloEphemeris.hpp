@@ -5,6 +5,8 @@
 #define GLOEPHEMERIS_HPP
 
 #include <iostream>
+#include <vector>
+#include <mutex>
 #include "Triple.hpp"
 #include "Xvt.hpp"
 #include "CommonTime.hpp"
@@ -24,7 +26,7 @@ namespace gnssSpace
    public:
        /// Default constructor
        GloEphemeris()
-               : step(1.0)
+               : step(1.0), nodeInterval(60.0), maxNodeSpan(3600.0)
        {};
 
        /// Destructor.
@@ -33,6 +35,18 @@ namespace gnssSpace
        /// Integration step for Runge-Kutta algorithm (1 second by default)
        double step;
 
+       /// Interval of the integrated states kept by svXvt() (seconds,
+       /// rounded to a multiple of step). A request integrates at most
+       /// this interval, from the nearest node between toe and epoch.
+       double nodeInterval;
+
+       /// Nodes are kept up to this distance from toe (seconds)
+       double maxNodeSpan;
+
+       /// Drop the integrated states, needed only if the elements are
+       /// changed after svXvt() was called.
+       void clearNodes() const;
+
        /// Dump the overhead information to the given output stream.
        /// throw Invalid Request if the required data has not been stored.
        void printData() const;
@@ -70,6 +84,68 @@ namespace gnssSpace
        double az;               ///< Z acceleration (km/sec2)
        double ageOfInfo;        ///< Age of oper. information (days)
 
+   private:
+
+       /// Integrated states of the satellite in the absolute frame.
+       /// Filled on demand by svXvt(), so it is mutable and protected
+       /// by a mutex; a copy of the ephemeris starts with no node.
+       struct NodeCache
+       {
+           NodeCache()
+              : ready(false)
+           {};
+
+           NodeCache(const NodeCache& /*right*/)
+              : ready(false)
+           {};
+
+           NodeCache& operator=(const NodeCache& /*right*/)
+           {
+               std::lock_guard<std::mutex> lock(mtx);
+               clear();
+               return (*this);
+           };
+
+           void clear()
+           {
+               ready = false;
+               fwd.clear();
+               bwd.clear();
+           };
+
+           std::mutex mtx;
+           bool ready;
+
+           double step;          ///< step the nodes were integrated with
+           int nodeSteps;        ///< steps between two nodes
+           double s0;            ///< sidereal angle at 0h UT (rad)
+
+           /// nodes after and before toe: x,vx,y,vy,z,vz and the seconds
+           /// of day (7 values), the first node is toe in both
+           std::vector<double> fwd;
+           std::vector<double> bwd;
+       };
+
+       mutable NodeCache nodes;
+
+       /// Fill the node at toe
+       void initNodes() const;
+
+       /// Integrate state from workEpoch to epoch with RK4, as done
+       /// from toe before.
+       void integrate( double state[6],
+                       double& numSeconds,
+                       CommonTime& workEpoch,
+                       const CommonTime& epoch,
+                       double s0,
+                       double& cs,
+                       double& ss ) const;
+
+       /// derivative() on plain arrays
+       void derivative( const double inState[6],
+                        const double accel[3],
+                        double dxt[6] ) const;
+
    };  // End of class 'GloEphemeris'
 
       //@}
@@ -0,0 +1,143 @@
+#pragma ident "$Id$"
+
+/**
+ * @file KeplerOrbit.cpp
+ * Orbit evaluation of many Keplerian ephemerides at once.
+ */
+
+#include <algorithm>
+
+#include "KeplerOrbit.hpp"
+
+#define debug 0
+
+using namespace std;
+
+namespace gnssSpace
+{
+
+   void KeplerBatch::clear()
+   {
+      tk.clear();
+
+      M0.clear(); ecc.clear(); omega.clear(); i0.clear(); IDOT.clear();
+      Cuc.clear(); Cus.clear(); Crc.clear(); Crs.clear(); Cic.clear(); Cis.clear();
+
+      A.clear(); n.clear(); q.clear(); dlkFactor.clear();
+      OMEGA_t0.clear(); OMEGA_rate.clear(); relFactor.clear();
+   }
+
+
+   void KeplerBatch::compute()
+   {
+      const size_t num = tk.size();
+
+      x.resize(num); y.resize(num); z.resize(num);
+      vx.resize(num); vy.resize(num); vz.resize(num);
+      relcorr.resize(num);
+      Mk.resize(num);
+      Ek.resize(num);
+
+      if(num == 0) return;
+
+      // plain pointers, so the loops below have no aliasing through the
+      // vectors and no bound checks
+      const double* ptk = &tk[0];
+      const double* pM0 = &M0[0];
+      const double* pe  = &ecc[0];
+      const double* pn  = &n[0];
+      double* pE = &Ek[0];
+
+      ///Mean anomaly, and the first guess of the eccentric anomaly
+      double twoPI = 2.0e0 * PI;
+      double* pM = &Mk[0];
+      for(size_t i=0; i<num; i++)
+      {
+         pM[i] = std::fmod(pM0[i] + pn[i]*ptk[i], twoPI);
+         pE[i] = pM[i] + pe[i]*std::sin(pM[i]);
+      }
+
+      ///Kepler's Equation, the Newton iteration runs over all the
+      ///satellites until the largest correction is small enough
+      for(int loop_cnt=1; loop_cnt<=20; loop_cnt++)
+      {
+         double maxDelea(0.0);
+         for(size_t i=0; i<num; i++)
+         {
+            double F = pM[i] - (pE[i] - pe[i]*std::sin(pE[i]));
+            double G = 1.0 - pe[i]*std::cos(pE[i]);
+            double delea = F/G;
+            pE[i] = pE[i] + delea;
+            maxDelea = std::max(maxDelea, std::fabs(delea));
+         }
+
+         if(maxDelea <= 1.0e-11) break;
+      }
+
+      ///Position and velocity
+      for(size_t i=0; i<num; i++)
+      {
+         double sinEk = std::sin(pE[i]);
+         double cosEk = std::cos(pE[i]);
+         double e = pe[i];
+
+         relcorr[i] = relFactor[i] * sinEk;
+
+         ///True Anomaly
+         double vk = std::atan2(q[i]*sinEk, cosEk - e);
+
+         ///Argument of Latitude
+         double phi_k = vk + omega[i];
+         double cos2phi_k = std::cos(2.0*phi_k);
+         double sin2phi_k = std::sin(2.0*phi_k);
+
+         double duk = cos2phi_k*Cuc[i] + sin2phi_k*Cus[i];
+         double drk = cos2phi_k*Crc[i] + sin2phi_k*Crs[i];
+         double dik = cos2phi_k*Cic[i] + sin2phi_k*Cis[i];
+
+         double uk = phi_k + duk;
+         double rk = A[i]*(1.0 - e*cosEk) + drk;
+         double ik = i0[i] + dik + IDOT[i]*ptk[i];
+
+         double cosuk = std::cos(uk);
+         double sinuk = std::sin(uk);
+
+         ///Positions in orbital plane.
+         double xip = rk * cosuk;
+         double yip = rk * sinuk;
+
+         ///Corrected longitude of ascending node.
+         double OMEGA_k = OMEGA_t0[i] + OMEGA_rate[i]*ptk[i];
+
+         ///Earth-fixed coordinates.
+         double sinOMG_k = std::sin(OMEGA_k);
+         double cosOMG_k = std::cos(OMEGA_k);
+         double cosik = std::cos(ik);
+         double sinik = std::sin(ik);
+
+         x[i] = xip*cosOMG_k  -  yip*cosik*sinOMG_k;
+         y[i] = xip*sinOMG_k  +  yip*cosik*cosOMG_k;
+         z[i] =                  yip*sinik;
+
+         /// Compute velocity of rotation coordinates
+         double dek = pn[i] * A[i] / rk;
+         double dlk = dlkFactor[i] / (rk*rk);
+         double div = IDOT[i] - 2.0e0 * dlk * (Cic[i]*sin2phi_k - Cis[i]*cos2phi_k);
+         double domk = OMEGA_rate[i];
+         double duv = dlk*(1.e0+ 2.e0 * (Cus[i]*cos2phi_k - Cuc[i]*sin2phi_k));
+         double drv = A[i] * e * dek * sinEk
+                      - 2.e0 * dlk * (Crc[i] * sin2phi_k - Crs[i] * cos2phi_k);
+         double dxp = drv * cosuk - rk * sinuk*duv;
+         double dyp = drv * sinuk + rk * cosuk*duv;
+
+         /// Calculate velocities
+         vx[i] = dxp*cosOMG_k - xip * sinOMG_k * domk - dyp * cosik * sinOMG_k
+                 + yip * (sinik * sinOMG_k*div - cosik * cosOMG_k*domk);
+         vy[i] = dxp*sinOMG_k + xip * cosOMG_k * domk + dyp * cosik * cosOMG_k
+                 - yip * (sinik * cosOMG_k*div + cosik * sinOMG_k*domk);
+         vz[i] = dyp * sinik + yip * cosik * div;
+      }
+
+   }  // End of method 'KeplerBatch::compute()'
+
+}  // End of namespace gnssSpace
@@ -0,0 +1,180 @@
+#pragma ident "$Id$"
+
+/**
+ * @file KeplerOrbit.hpp
+ * Constants of a broadcast Keplerian orbit, and the solution of the
+ * Kepler equation, shared by GPSEphemeris, GalEphemeris and BDSEphemeris.
+ *
+ * The semi-major axis, the mean motion, sqrt(1-e^2), etc. depend only on
+ * the broadcast elements, so they are derived once when the ephemeris is
+ * stored (setOrbitConstants()) instead of in every svXvt() call.
+ *
+ * KeplerBatch evaluates the orbits of many satellites at once: the
+ * elements are copied into one array per parameter (structure of
+ * arrays), and each step of the evaluation is a loop over all the
+ * satellites without branches, which the compiler can vectorize.
+ */
+
+#ifndef KeplerOrbit_HPP
+#define KeplerOrbit_HPP
+
+#include <cmath>
+#include <vector>
+
+#include "constants.hpp"
+
+namespace gnssSpace
+{
+
+      /// Constants derived from the broadcast elements of one ephemeris
+   struct KeplerOrbitConst
+   {
+      KeplerOrbitConst()
+         : valid(false),
+           A(0.0), n(0.0), q(0.0), dlkFactor(0.0),
+           OMEGA_t0(0.0), OMEGA_rate(0.0), relFactor(0.0)
+      {};
+
+         /// false until the constants are computed
+      bool valid;
+
+         /// semi-major axis (m)
+      double A;
+
+         /// corrected mean motion, n0 + Delta_n (rad/s)
+      double n;
+
+         /// sqrt(1-e^2)
+      double q;
+
+         /// sqrt(A)*sqrt(1-e^2)*sqrt(GM), for the rate of the true anomaly
+      double dlkFactor;
+
+         /// OMEGA_0 - OMEGA_e*Toe
+      double OMEGA_t0;
+
+         /// OMEGA_DOT - OMEGA_e, rate of the ascending node in ECEF
+      double OMEGA_rate;
+
+         /// relativity constant * e * sqrt(A), times sin(Ek) gives relcorr
+      double relFactor;
+
+   }; // End of struct 'KeplerOrbitConst'
+
+
+      /** Solve the Kepler equation M = E - e*sin(E) by Newton iteration.
+       *
+       * @param Mk   mean anomaly (rad), reduced to [0, 2PI) inside
+       * @param ecc  eccentricity
+       * @return the eccentric anomaly (rad)
+       */
+   inline double solveKepler(double Mk, double ecc)
+   {
+      double twoPI = 2.0e0 * PI;
+      Mk = std::fmod(Mk, twoPI);
+      double Ek = Mk + ecc * std::sin(Mk);
+      int loop_cnt = 1;
+      double F,G,delea;
+      do  {
+         F = Mk - (Ek - ecc * std::sin(Ek));
+         G = 1.0 - ecc * std::cos(Ek);
+         delea = F/G;
+         Ek = Ek + delea;
+         loop_cnt++;
+      } while ((std::fabs(delea) > 1.0e-11) && (loop_cnt <= 20));
+
+      return Ek;
+   }
+
+
+      /** Orbit evaluation of many Keplerian ephemerides at once.
+       *
+       * Valid for GPS, Galileo and the BDS MEO/IGSO satellites, whose
+       * orbits are computed with the same formulas; BDS GEO satellites
+       * need their own rotation and are not handled here.
+       *
+       * @code
+       *   KeplerBatch batch;
+       *   batch.add(gpsEph, gpsEph.orbitConstants(tmp), tk);
+       *   ...
+       *   batch.compute();
+       *   double x = batch.x[0];
+       * @endcode
+       */
+   class KeplerBatch
+   {
+   public:
+
+         /// Remove all the satellites, the memory is kept
+      void clear();
+
+         /// Number of satellites
+      size_t size() const
+      { return tk.size(); };
+
+         /** Add a satellite.
+          *
+          * @param eph  ephemeris with the broadcast elements
+          * @param oc   constants of the ephemeris
+          * @param t    time from the reference epoch (s)
+          * @return index of the satellite in the batch
+          */
+      template <class EphType>
+      size_t add(const EphType& eph, const KeplerOrbitConst& oc, double t)
+      {
+         tk.push_back(t);
+
+         M0.push_back(eph.M0);
+         ecc.push_back(eph.ecc);
+         omega.push_back(eph.omega);
+         i0.push_back(eph.i0);
+         IDOT.push_back(eph.IDOT);
+         Cuc.push_back(eph.Cuc);
+         Cus.push_back(eph.Cus);
+         Crc.push_back(eph.Crc);
+         Crs.push_back(eph.Crs);
+         Cic.push_back(eph.Cic);
+         Cis.push_back(eph.Cis);
+
+         A.push_back(oc.A);
+         n.push_back(oc.n);
+         q.push_back(oc.q);
+         dlkFactor.push_back(oc.dlkFactor);
+         OMEGA_t0.push_back(oc.OMEGA_t0);
+         OMEGA_rate.push_back(oc.OMEGA_rate);
+         relFactor.push_back(oc.relFactor);
+
+         return tk.size()-1;
+      };
+
+         /// Compute the positions, velocities and relativity corrections
+         /// of all the satellites
+      void compute();
+
+         /// results: ECEF position (m), velocity (m/s) and relativity
+         /// correction (s) of each satellite
+      std::vector<double> x, y, z;
+      std::vector<double> vx, vy, vz;
+      std::vector<double> relcorr;
+
+   private:
+
+         /// time from the reference epoch
+      std::vector<double> tk;
+
+         /// broadcast elements
+      std::vector<double> M0, ecc, omega, i0, IDOT;
+      std::vector<double> Cuc, Cus, Crc, Crs, Cic, Cis;
+
+         /// constants of the ephemerides
+      std::vector<double> A, n, q, dlkFactor;
+      std::vector<double> OMEGA_t0, OMEGA_rate, relFactor;
+
+         /// mean and eccentric anomaly
+      std::vector<double> Mk, Ek;
+
+   }; // End of class 'KeplerBatch'
+
+}  // End of namespace gnssSpace
+
+#endif   // KeplerOrbit_HPP
@@ -76,8 +76,8 @@ namespace gnssSpace{
 
     void LsqRTK::defineEquations() {
 
-        // warning:
-        // must clear equation system for each epoch
+        // called once from the constructor; in the incremental mode the
+        // equation system keeps the equations from one epoch to the next
         equSys.clearEquations();
 
 
@@ -176,7 +176,6 @@ namespace gnssSpace{
     }
 
     Rx3ObsData &LsqRTK::Process(Rx3ObsData &rxDataRover) noexcept(false) {
-        defineEquations();
         equSys.Prepare(rxDataRover.currEpoch, source, rxDataRover.stvData);
 
         currentUnkSet = equSys.getVarUnknowns();
@@ -196,9 +195,9 @@ namespace gnssSpace{
             }
         }
 
-        std::set<Equation> desSet = equSys.getDescripEqus();
         if(debug)
         {
+            const std::set<Equation>& desSet = equSys.getDescripEqus();
             cout << "desSet" << endl;
             for(auto it = desSet.begin(); it!= desSet.end(); it++)
             {
@@ -206,9 +205,9 @@ namespace gnssSpace{
             }
         }
 
-        std::set<Equation> equSet = equSys.getCurrentEquationsSet();
         if(debug)
         {
+            const std::set<Equation>& equSet = equSys.getCurrentEquationsSet();
             cout << "equSet" << endl;
             for(auto it = equSet.begin(); it!= equSet.end(); it++)
             {
@@ -216,9 +215,12 @@ namespace gnssSpace{
             }
         }
 
-        VectorXd prefit = equSys.getPrefitsVector();
-        MatrixXd hMatrix = equSys.getGeometryMatrix();
-        MatrixXd hT = hMatrix.transpose();
+        const VectorXd& prefit = equSys.getPrefitsVector();
+        const MatrixXd& hMatrix = equSys.getGeometryMatrix();
+
+        // the weights are diagonal: scale the rows of H instead of
+        // multiplying by a dense W
+        MatrixXd wH = equSys.getWeightsVector().asDiagonal() * hMatrix;
 
 //        if(debug)
 //        {
@@ -230,18 +232,17 @@ namespace gnssSpace{
 //
 //        }
 
-        try
-        {
-            covMatrix = hT * equSys.getWeightsMatrix() * hMatrix;
-            covMatrix = covMatrix.inverse();
-        }
-        catch(...)
+        // the normal matrix is factorized once by Cholesky, which also
+        // tells when it is singular; fixAmbiguity() takes the columns of
+        // the covariance it needs from the factorization
+        normalLLT.compute(hMatrix.transpose() * wH);
+        if( normalLLT.info() != Eigen::Success )
         {
-            InvalidSolver e("Unable to invert matrix covMatrix");
+            InvalidSolver e("Unable to factorize the normal matrix");
             THROW(e);
         }
 
-        solution = covMatrix * hT * equSys.getWeightsMatrix() * prefit;
+        solution = normalLLT.solve(wH.transpose() * prefit);
 
 //        cout<<"solution:"<<endl;
 //        cout<<solution<<endl;
@@ -314,110 +315,115 @@ namespace gnssSpace{
             }
         }
 
-        /// 构成H矩阵
-        MatrixXd h = MatrixXd::Zero(  2*rxDataRover.stvData.numSats(sys.system)-2,currentUnkSet.size());
-        VectorXd floatAmb = VectorXd::Zero( 2*rxDataRover.stvData.numSats(sys.system)-2);
-
-        MatrixXd h_other = MatrixXd::Zero(  currentUnkSet.size()-2*rxDataRover.stvData.numSats(sys.system),currentUnkSet.size());
-        MatrixXd h_now = MatrixXd::Zero(  2*rxDataRover.stvData.numSats(sys.system),currentUnkSet.size());
-
-        MatrixXd t_all = MatrixXd::Zero(  currentUnkSet.size(),currentUnkSet.size()-2*rxDataRover.stvData.numSats(sys.system));
-        MatrixXd t_diff = MatrixXd::Zero(  2*rxDataRover.stvData.numSats(sys.system),2*rxDataRover.stvData.numSats(sys.system)-2);
-
-        int iter = 0;
-        int iter2 = 0;
-        int iter3 = 0;
-        auto varIt = currentUnkSet.begin();
-        while( varIt != currentUnkSet.end() )
+        for(auto varIt = currentUnkSet.begin(); varIt != currentUnkSet.end(); varIt++)
         {
-            if(varIt->getSatSys() == sys.system){
-
-                if(varIt->getSatellite() == mainSat&&varIt->getType() == TypeID::N1){
-                   MaxIndexN1 = varIt->getNowIndex();
-
+            if(varIt->getSatSys() == sys.system && varIt->getSatellite() == mainSat){
+                if(varIt->getType() == TypeID::N1){
+                    MaxIndexN1 = varIt->getNowIndex();
                 }
-
-                if(varIt->getSatellite() == mainSat&&varIt->getType() == TypeID::N2){
+                if(varIt->getType() == TypeID::N2){
                     MaxIndexN2 = varIt->getNowIndex();
                 }
+            }
+        }
 
+        /// 单差模糊度: 每一行为 N(mainSat) - N(sat), 只记录参数的索引
+        std::vector<int> refIndex;
+        std::vector<int> ambIndex;
 
+        // 本系统的参数, 固定后不改正
+        std::vector<char> isSys(currentUnkSet.size(), 0);
 
+        for(auto varIt = currentUnkSet.begin(); varIt != currentUnkSet.end(); varIt++)
+        {
+            if(varIt->getSatSys() != sys.system){
+                continue;
             }
-            varIt++;
 
-        }
-//        rxDataRover.stvData.find(mainSat)->second[type] = solution(MaxIndex);
+            isSys[varIt->getNowIndex()] = 1;
 
-        varIt = currentUnkSet.begin();
-        while( varIt != currentUnkSet.end() )
-        {
-            if(varIt->getSatSys() == sys.system){
+            if(varIt->getSatellite() == mainSat){
+                continue;
+            }
 
+            if(varIt->getType() == TypeID::N1 && MaxIndexN1 >= 0){
+                refIndex.push_back(MaxIndexN1);
+                ambIndex.push_back(varIt->getNowIndex());
+            }
+            if(varIt->getType() == TypeID::N2 && MaxIndexN2 >= 0){
+                refIndex.push_back(MaxIndexN2);
+                ambIndex.push_back(varIt->getNowIndex());
+            }
+        }
 
-                if(varIt->getSatellite() != mainSat&&varIt->getType() == TypeID::N1){
-                    h(iter,varIt->getNowIndex()) = -1.0;
-                    h(iter,MaxIndexN1) = 1.0;
-                    floatAmb(iter) = solution(MaxIndexN1)-solution(varIt->getNowIndex());
-                    t_diff(iter3,iter) = 1.0;
-                    iter++;
-                }
-                if(varIt->getSatellite() != mainSat&&varIt->getType() == TypeID::N2){
-                    h(iter,varIt->getNowIndex()) = -1.0;
-                    h(iter,MaxIndexN2) = 1.0;
-                    floatAmb(iter) = solution(MaxIndexN2)-solution(varIt->getNowIndex());
-                    t_diff(iter3,iter) = 1.0;
-                    iter++;
-                }
+        int numUnk = currentUnkSet.size();
+        int numAmb = ambIndex.size();
 
-                h_now(iter3,varIt->getNowIndex()) = 1.0;
-                iter3++;
+        VectorXd ds = VectorXd::Zero(numUnk);
 
+        // less than two satellites of this system
+        if(numAmb == 0){
+            return ds;
+        }
 
-            }else{
-                t_all(varIt->getNowIndex(),iter2) = 1.0;
-                h_other(iter2,varIt->getNowIndex()) = 1.0;
-                iter2++;
+        // Columns of the covariance for the ambiguities of this system,
+        // by solving with the factorized normal matrix
+        std::vector<int> colOf(numUnk, -1);
+        std::vector<int> cols;
+        for(int i = 0; i < numAmb; i++){
+            int idx[2] = { refIndex[i], ambIndex[i] };
+            for(int k = 0; k < 2; k++){
+                if(colOf[idx[k]] < 0){
+                    colOf[idx[k]] = cols.size();
+                    cols.push_back(idx[k]);
+                }
             }
-
-            varIt++;
         }
 
+        MatrixXd unitCols = MatrixXd::Zero(numUnk, cols.size());
+        for(size_t j = 0; j < cols.size(); j++){
+            unitCols(cols[j], j) = 1.0;
+        }
+        MatrixXd covCols = normalLLT.solve(unitCols);
+
+        // Cov(x, floatAmb) = Q * h', and the covariance of the single
+        // difference ambiguities h * Q * h'
+        MatrixXd dxFloatAmbCov(numUnk, numAmb);
+        VectorXd floatAmb(numAmb);
+        for(int i = 0; i < numAmb; i++){
+            dxFloatAmbCov.col(i) = covCols.col(colOf[refIndex[i]])
+                                 - covCols.col(colOf[ambIndex[i]]);
+            floatAmb(i) = solution(refIndex[i]) - solution(ambIndex[i]);
+        }
 
-        MatrixXd floatAmbCov = h * covMatrix * h.transpose();
-//        cout<<h<<endl;
-//        cout<<floatAmbCov<<endl;
-//        cout<<floatAmb<<endl;
+        MatrixXd floatAmbCov(numAmb, numAmb);
+        for(int i = 0; i < numAmb; i++){
+            floatAmbCov.row(i) = dxFloatAmbCov.row(refIndex[i])
+                               - dxFloatAmbCov.row(ambIndex[i]);
+        }
 
         ARLambda AR;
         VectorXd intAmb(floatAmb.size()); intAmb.setZero();
         intAmb = AR.resolve(floatAmb, floatAmbCov);
         isFixed = AR.isFixed();
 
-        MatrixXd dxFloatAmbCov = covMatrix * h.transpose();
-
-//        VectorXd ds= t_all *(h_other*covMatrix * h_now.transpose())*(h_now*covMatrix*h_now.transpose()).inverse()* t_diff * (floatAmb - intAmb);
-        VectorXd ds =t_all*h_other * covMatrix * h.transpose() * floatAmbCov.inverse() *(floatAmb - intAmb);
+        Eigen::LLT<MatrixXd> ambLLT(floatAmbCov);
+        if( ambLLT.info() != Eigen::Success )
+        {
+            InvalidSolver e("Unable to factorize the ambiguity covariance");
+            THROW(e);
+        }
 
+        // Schur complement: correction of the other parameters by the
+        // fixed ambiguities, Q_xa * Q_aa^-1 * (floatAmb - intAmb)
+        VectorXd dxAll = dxFloatAmbCov * ambLLT.solve(floatAmb - intAmb);
+        for(int i = 0; i < numUnk; i++){
+            if(!isSys[i]){
+                ds(i) = dxAll(i);
+            }
+        }
 
         return ds;
 
-
-
-
-
-//        iter = 0;
-//        varIt = currentUnkSet.begin();
-//        while( varIt != currentUnkSet.end() )
-//        {
-//            if(varIt->getType() == id.type&&varIt->getSatSys() == sys.system){
-//                if(varIt->getSatellite() != mainSat){
-//                    rxDataRover.stvData.find(mainSat)->second[type] = solution(MaxIndex)-intAmb(iter);
-//                    iter++;
-//                }
-//            }
-//            varIt++;
-//        }
-
     }
-}
\ No newline at end of file
+}
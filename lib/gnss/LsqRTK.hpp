@@ -27,6 +27,9 @@ namespace gnssSpace {
 
         LsqRTK()
                 : firstTime(true), systemStr("G"), pOutStream(NULL) {
+            // the equations only change for the satellites that rise,
+            // set or slip
+            equSys.setIncremental(true);
             defineEquations();
             // outType vector list
             typeVec.clear();
@@ -99,7 +102,9 @@ namespace gnssSpace {
         vector<string> typeVec;
 
         VectorXd solution;
-        MatrixXd covMatrix;
+
+        /// Cholesky factorization of the normal matrix
+        Eigen::LLT<MatrixXd> normalLLT;
 
         Triple delta;
         Triple deltaFixed;
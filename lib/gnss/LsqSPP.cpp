@@ -23,8 +23,8 @@ namespace gnssSpace
     void LsqSPP::defineEquations()
     {
 
-        // warning:
-        // must clear equation system for each epoch
+        // called once from the constructor; in the incremental mode the
+        // equation system keeps the equations from one epoch to the next
         equSys.clearEquations();
 
         //////////////////////////////////////////////////
@@ -155,9 +155,9 @@ namespace gnssSpace
             }
         }
 
-        std::set<Equation> desSet = equSys.getDescripEqus();
         if(debug)
         {
+            const std::set<Equation>& desSet = equSys.getDescripEqus();
             cout << "desSet" << endl;
             for(auto it = desSet.begin(); it!= desSet.end(); it++)
             {
@@ -165,9 +165,9 @@ namespace gnssSpace
             }
         }
 
-        std::set<Equation> equSet = equSys.getCurrentEquationsSet();
         if(debug)
         {
+            const std::set<Equation>& equSet = equSys.getCurrentEquationsSet();
             cout << "equSet" << endl;
             for(auto it = equSet.begin(); it!= equSet.end(); it++)
             {
@@ -175,8 +175,8 @@ namespace gnssSpace
             }
         }
 
-        VectorXd prefit = equSys.getPrefitsVector();
-        MatrixXd hMatrix = equSys.getGeometryMatrix();
+        const VectorXd& prefit = equSys.getPrefitsVector();
+        const MatrixXd& hMatrix = equSys.getGeometryMatrix();
         MatrixXd hT = hMatrix.transpose();
 
         if(debug)
@@ -189,18 +189,16 @@ namespace gnssSpace
 
         }
 
-        try
+        // normal matrix, factorized by Cholesky; only the solution is
+        // needed, so the covariance is not formed
+        Eigen::LLT<MatrixXd> normalLLT(hT * hMatrix);
+        if( normalLLT.info() != Eigen::Success )
         {
-            covMatrix = hT * hMatrix;
-            covMatrix = covMatrix.inverse(); 
-        }
-        catch(...)
-        {
-            InvalidSolver e("Unable to invert matrix covMatrix");
+            InvalidSolver e("Unable to factorize the normal matrix");
             THROW(e);
         }
 
-        solution = covMatrix * hT * prefit;
+        solution = normalLLT.solve(hT * prefit);
 
         VectorXd postfit;
         postfit = prefit - hMatrix* solution;
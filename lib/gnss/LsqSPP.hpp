@@ -42,6 +42,9 @@ namespace gnssSpace
         LsqSPP()
             : firstTime(true), systemStr("G"), pOutStream(NULL)
         {
+            // the equations only change for the satellites that rise
+            // or set
+            equSys.setIncremental(true);
             defineEquations();
             // outType vector list
             typeVec.clear();
@@ -111,7 +114,6 @@ namespace gnssSpace
         vector<string> typeVec;
 
         VectorXd solution;
-        MatrixXd covMatrix;
 
         Triple delta;
 
@@ -7,6 +7,7 @@
 #include "MiscMath.hpp"
 #include <vector>
 #include "YDSTime.hpp"
+#include "SnapshotRecords.hpp"
 
 using namespace std;
 
@@ -19,6 +20,32 @@ namespace gnssSpace
    /** @addtogroup ephemstore */
    //@{
 
+   namespace
+   {
+         // Sum of c[m]*v[m*stride], m=0,n-1, the interpolation of the
+         // values v of the records of a uniform grid
+      inline double gridSum(const double* c, const double* v, int n, int stride)
+      {
+         double sum(0.0);
+         for(int m=0; m<n; m++)
+            sum += c[m]*v[m*stride];
+         return sum;
+      }
+
+         // Same as gridSum(), for the 3 components of a vector at v
+      inline void gridSum3(const double* c, const double* v, int n, int stride,
+                           double* sum)
+      {
+         double x(0.0), y(0.0), z(0.0);
+         for(int m=0; m<n; m++, v += stride) {
+            x += c[m]*v[0];
+            y += c[m]*v[1];
+            z += c[m]*v[2];
+         }
+         sum[0] = x; sum[1] = y; sum[2] = z;
+      }
+   }
+
    // Output stream operator is used by dump() in TabularSatStore
    ostream& operator<<(ostream& os, const PositionRecord& rec) throw()
    {
@@ -68,6 +95,72 @@ namespace gnssSpace
          PositionRecord rec;
          DataTableIterator it1, it2, kt;        // cf. TabularSatStore.hpp
 
+         // uniform grid: the records are interpolated in place
+         const UniformGrid* pGrid(findGrid(sat));
+         if(pGrid) {
+            const int S(gridSize), n(2*Nhalf);
+            int first, match;
+
+            isExact = getGridInterval(*pGrid, sat, ttag, Nhalf, haveVelocity,
+                                      first, match);
+            const double *r(&pGrid->data[first*S]);
+            if(isExact && haveVelocity) {
+               for(i=0; i<3; i++) {
+                  rec.Pos[i] = r[gridPos+i];
+                  rec.sigPos[i] = r[gridSigPos+i];
+                  rec.Vel[i] = r[gridVel+i];
+                  rec.sigVel[i] = r[gridSigVel+i];
+                  rec.Acc[i] = r[gridAcc+i];
+                  rec.sigAcc[i] = r[gridSigAcc+i];
+               }
+               return rec;
+            }
+
+            double L[2*maxGridHalf], dL[2*maxGridHalf];
+            getGridBasis(*pGrid, ttag, Nhalf, first, (isExact ? match : -1), L, dL);
+
+            // sigmas of the matching record, or of the two around ttag
+            const double *rLow(r + (Nhalf-1)*S), *rHi(r + Nhalf*S);
+            const double *rMatch(isExact ? &pGrid->data[match*S] : 0);
+
+            rec.sigAcc = rec.Acc = Triple(0,0,0);
+            for(i=0; i<3; i++) {
+               rec.Pos[i] = gridSum(L, r+gridPos+i, n, S);
+               if(haveVelocity) {
+                  rec.Vel[i] = gridSum(L, r+gridVel+i, n, S);
+                  if(haveAcceleration)
+                     rec.Acc[i] = gridSum(L, r+gridAcc+i, n, S);
+                  else     // dm/s/s -> m/s/s
+                     rec.Acc[i] = 0.1 * gridSum(dL, r+gridVel+i, n, S);
+
+                  if(isExact) {
+                     rec.sigPos[i] = rMatch[gridSigPos+i];
+                     rec.sigVel[i] = rMatch[gridSigVel+i];
+                     if(haveAcceleration)
+                        rec.sigAcc[i] = rMatch[gridSigAcc+i];
+                  }
+                  else {
+                     rec.sigPos[i] = RSS(rHi[gridSigPos+i],
+                                         rLow[gridSigPos+i]);
+                     rec.sigVel[i] = RSS(rHi[gridSigVel+i],
+                                         rLow[gridSigVel+i]);
+                     if(haveAcceleration)
+                        rec.sigAcc[i] = RSS(rHi[gridSigAcc+i],
+                                            rLow[gridSigAcc+i]);
+                  }
+               }
+               else {      // km/sec -> dm/sec
+                  rec.Vel[i] = 10000. * gridSum(dL, r+gridPos+i, n, S);
+                  rec.sigPos[i] = (isExact ? rMatch[gridSigPos+i]
+                                           : RSS(rHi[gridSigPos+i],
+                                                 rLow[gridSigPos+i]));
+                  rec.sigVel[i] = 0.0;
+               }
+            }
+
+            return rec;
+         }
+
          isExact = getTableInterval(sat, ttag, Nhalf, it1, it2, haveVelocity);
          if(isExact && haveVelocity) {
             rec = it1->second;
@@ -173,6 +266,27 @@ namespace gnssSpace
          int i;
          DataTableIterator it1, it2, kt;
 
+         const UniformGrid* pGrid(findGrid(sat));
+         if(pGrid) {
+            const int S(gridSize);
+            int first, match;
+            Triple pos;
+
+            bool isExact(getGridInterval(*pGrid, sat, ttag, Nhalf, true, first, match));
+            const double *r(&pGrid->data[first*S + gridPos]);
+            if(isExact) {
+               for(i=0; i<3; i++) pos[i] = r[i];
+               return pos;
+            }
+
+            double L[2*maxGridHalf];
+            getGridBasis(*pGrid, ttag, Nhalf, first, -1, L, 0);
+            for(i=0; i<3; i++)
+               pos[i] = gridSum(L, r+i, 2*Nhalf, S);
+
+            return pos;
+         }
+
          if(getTableInterval(sat, ttag, Nhalf, it1, it2, true))
          {
 //              // exact match
@@ -223,6 +337,32 @@ namespace gnssSpace
          int i;
          DataTableIterator it1, it2, kt;
 
+         const UniformGrid* pGrid(findGrid(sat));
+         if(pGrid) {
+            const int S(gridSize);
+            int first, match;
+            Triple Vel;
+
+            bool isExact(getGridInterval(*pGrid, sat, ttag, Nhalf, haveVelocity,
+                                         first, match));
+            const double *r(&pGrid->data[first*S]);
+            if(isExact && haveVelocity) {
+               for(i=0; i<3; i++) Vel[i] = r[gridVel+i];
+               return Vel;
+            }
+
+            double L[2*maxGridHalf], dL[2*maxGridHalf];
+            getGridBasis(*pGrid, ttag, Nhalf, first, (isExact ? match : -1), L, dL);
+            for(i=0; i<3; i++) {
+               if(haveVelocity)
+                  Vel[i] = gridSum(L, r+gridVel+i, 2*Nhalf, S);
+               else        // km/s -> dm/s
+                  Vel[i] = 10000. * gridSum(dL, r+gridPos+i, 2*Nhalf, S);
+            }
+
+            return Vel;
+         }
+
          bool isExact(getTableInterval(sat, ttag, Nhalf, it1, it2, haveVelocity));
          if(isExact && haveVelocity) {
                // @author shjzhang
@@ -283,6 +423,32 @@ namespace gnssSpace
          int i;
          DataTableIterator it1, it2, kt;
 
+         const UniformGrid* pGrid(findGrid(sat));
+         if(pGrid) {
+            const int S(gridSize);
+            int first, match;
+            Triple Acc;
+
+            bool isExact(getGridInterval(*pGrid, sat, ttag, Nhalf, haveAcceleration,
+                                         first, match));
+            const double *r(&pGrid->data[first*S]);
+            if(isExact && haveAcceleration) {
+               for(i=0; i<3; i++) Acc[i] = r[gridAcc+i];
+               return Acc;
+            }
+
+            double L[2*maxGridHalf], dL[2*maxGridHalf];
+            getGridBasis(*pGrid, ttag, Nhalf, first, (isExact ? match : -1), L, dL);
+            for(i=0; i<3; i++) {
+               if(haveAcceleration)
+                  Acc[i] = gridSum(L, r+gridAcc+i, 2*Nhalf, S);
+               else        // dm/s/s -> m/s/s
+                  Acc[i] = 0.1 * gridSum(dL, r+gridVel+i, 2*Nhalf, S);
+            }
+
+            return Acc;
+         }
+
          bool isExact(getTableInterval(sat,ttag,Nhalf,it1,it2,haveAcceleration));
          if(isExact && haveAcceleration) {
                 // exact match, and have acceleration data
@@ -322,6 +488,85 @@ namespace gnssSpace
       catch(InvalidRequest& e) { RETHROW(e); }
    }
 
+   // Position and velocity of several satellites at ttag. The interval and
+   // the weights are computed for the first satellite of each grid, and
+   // kept for the next ones with the same epochs.
+   int PositionSatStore::getPositionBatch(const std::vector<SatID>& sats,
+                                          const CommonTime& ttag,
+                                          std::vector<double>& pos,
+                                          std::vector<double>& vel,
+                                          std::vector<char>& valid) const
+   {
+      pos.resize(3*sats.size());
+      vel.resize(3*sats.size());
+      valid.assign(sats.size(), 0);
+
+      const UniformGrid* pLast(0);
+      bool ok(false), isExact(false);
+      int first(0), match(0);
+      double L[2*maxGridHalf], dL[2*maxGridHalf];
+      const int S(gridSize), n(2*Nhalf);
+
+      int num(0);
+      for(size_t i=0; i<sats.size(); i++) {
+         double *p(&pos[3*i]), *v(&vel[3*i]);
+
+         const UniformGrid* pGrid(findGrid(sats[i]));
+         if(!pGrid) {
+            try {
+               PositionRecord rec(getValue(sats[i], ttag));
+               for(int j=0; j<3; j++) {
+                  p[j] = rec.Pos[j];
+                  v[j] = rec.Vel[j];
+               }
+               valid[i] = 1;
+               num++;
+            }
+            catch(InvalidRequest& e) { }
+            continue;
+         }
+
+         if(!pLast || pGrid->step != pLast->step ||
+            pGrid->times.size() != pLast->times.size() ||
+            pGrid->times[0] != pLast->times[0])
+         {
+            pLast = pGrid;
+            try {
+               isExact = getGridInterval(*pGrid, sats[i], ttag, Nhalf,
+                                         haveVelocity, first, match);
+               if(!(isExact && haveVelocity))
+                  getGridBasis(*pGrid, ttag, Nhalf, first,
+                               (isExact ? match : -1), L, dL);
+               ok = true;
+            }
+            catch(InvalidRequest& e) { ok = false; }
+         }
+         if(!ok) continue;
+
+         const double *r(&pGrid->data[first*S]);
+         if(isExact && haveVelocity) {
+            for(int j=0; j<3; j++) {
+               p[j] = r[gridPos+j];
+               v[j] = r[gridVel+j];
+            }
+         }
+         else {
+            gridSum3(L, r+gridPos, n, S, p);
+            if(haveVelocity)
+               gridSum3(L, r+gridVel, n, S, v);
+            else {      // km/sec -> dm/sec
+               gridSum3(dL, r+gridPos, n, S, v);
+               for(int j=0; j<3; j++) v[j] *= 10000.;
+            }
+         }
+
+         valid[i] = 1;
+         num++;
+      }
+
+      return num;
+   }
+
    // Add a PositionRecord to the store.
    void PositionSatStore::addPositionRecord(const SatID& sat, const CommonTime& ttag,
                                             const PositionRecord& rec)
@@ -329,6 +574,7 @@ namespace gnssSpace
    {
       try {
          checkTimeSystem(ttag.getTimeSystem());
+         gridChanged(sat);
 
          int i;
          if(!haveVelocity)
@@ -361,6 +607,7 @@ namespace gnssSpace
    {
       try {
          checkTimeSystem(ttag.getTimeSystem());
+         gridChanged(sat);
 
          if(tables.find(sat) != tables.end() &&
             tables[sat].find(ttag) != tables[sat].end()) {
@@ -388,6 +635,7 @@ namespace gnssSpace
    {
       try {
          checkTimeSystem(ttag.getTimeSystem());
+         gridChanged(sat);
 
          haveVelocity = true;
 
@@ -417,6 +665,7 @@ namespace gnssSpace
    {
       try {
          checkTimeSystem(ttag.getTimeSystem());
+         gridChanged(sat);
 
          haveAcceleration = true;
 
@@ -439,6 +688,75 @@ namespace gnssSpace
       catch(InvalidRequest& ir) { RETHROW(ir); }
    }
 
+   // Write the tables to a binary snapshot, for each satellite the
+   // number of records, then the times and records
+   void PositionSatStore::writeSnapshot(BinarySnapshotWriter& w) const
+   {
+      w.beginSection("POSITION", tables.size());
+      w.putBool(haveVelocity);
+      w.putBool(haveAcceleration);
+
+      for(SatTable::const_iterator itSat = tables.begin();
+          itSat != tables.end(); ++itSat)
+      {
+         putSat(w, itSat->first);
+         w.putInt(itSat->second.size());
+
+         for(DataTableIterator it = itSat->second.begin();
+             it != itSat->second.end(); ++it)
+         {
+            putTime(w, it->first);
+            putTriple(w, it->second.Pos);
+            putTriple(w, it->second.sigPos);
+            putTriple(w, it->second.Vel);
+            putTriple(w, it->second.sigVel);
+            putTriple(w, it->second.Acc);
+            putTriple(w, it->second.sigAcc);
+         }
+      }
+   }
+
+   // Add the tables of a binary snapshot
+   void PositionSatStore::readSnapshot(BinarySnapshotReader& r)
+      noexcept(false)
+   {
+      try {
+         uint64_t numSats = r.beginSection("POSITION");
+         if(r.getBool()) haveVelocity = true;
+         if(r.getBool()) haveAcceleration = true;
+
+         PositionRecord rec;
+
+         for(uint64_t i=0; i<numSats; i++) {
+            SatID sat = getSat(r);
+            int64_t num = r.getInt();
+
+            DataTable& table(tables[sat]);
+            gridChanged(sat);
+
+            for(int64_t k=0; k<num; k++) {
+               CommonTime ttag = getTime(r);
+               rec.Pos = getTriple(r);
+               rec.sigPos = getTriple(r);
+               rec.Vel = getTriple(r);
+               rec.sigVel = getTriple(r);
+               rec.Acc = getTriple(r);
+               rec.sigAcc = getTriple(r);
+
+               checkTimeSystem(ttag.getTimeSystem());
+
+                  // the records were written in the order of the table, so
+                  // they are appended unless the store already had data
+               if(table.empty() || table.rbegin()->first < ttag)
+                  table.insert(table.end(), make_pair(ttag, rec));
+               else
+                  addPositionRecord(sat, ttag, rec);
+            }
+         }
+      }
+      catch(InvalidRequest& ir) { RETHROW(ir); }
+   }
+
    //@}
 
 using namespace utilSpace;
@@ -7,6 +7,7 @@
 #define POSITION_SAT_STORE_INCLUDE
 
 #include <map>
+#include <vector>
 #include <iostream>
 
 #include "TabularSatStore.hpp"
@@ -14,6 +15,7 @@
 #include "SatID.hpp"
 #include "CommonTime.hpp"
 #include "Triple.hpp"
+#include "BinarySnapshot.hpp"
 
 using namespace utilSpace;
 using namespace coordSpace;
@@ -53,6 +55,9 @@ namespace gnssSpace
    /// and units(sigX) == units(X). This assumption is critical only when
    /// interpolation is used to estimate X/sec from X data.
    /// No other assumptions are made about units.
+   /// The table of a satellite on a uniform time grid (SP3) is interpolated
+   /// from a dense copy, with the barycentric form of the Lagrange polynomial;
+   /// the other tables with LagrangeInterpolation() (MiscMath.hpp).
    /// Note that SP3 data (in the file and in SP3Data) are NOT coordinated; users
    /// and derived classes must deal with units consistently.
    class PositionSatStore : public TabularSatStore<PositionRecord>
@@ -76,6 +81,32 @@ namespace gnssSpace
       /// Store half the interpolation order, for convenience
       unsigned int Nhalf;
 
+   private:
+
+      /// Values of a record in the uniform grids (TabularSatStore)
+      enum GridValues { gridPos = 0, gridSigPos = 3, gridVel = 6, gridSigVel = 9,
+                        gridAcc = 12, gridSigAcc = 15, gridSize = 18 };
+
+      virtual int gridRecordSize() const
+         { return gridSize; }
+
+      virtual void putGridRecord(const PositionRecord& rec, double* values) const
+      {
+         for(int i=0; i<3; i++) {
+            values[gridPos+i] = rec.Pos[i];
+            values[gridSigPos+i] = rec.sigPos[i];
+            values[gridVel+i] = rec.Vel[i];
+            values[gridSigVel+i] = rec.sigVel[i];
+            values[gridAcc+i] = rec.Acc[i];
+            values[gridSigAcc+i] = rec.sigAcc[i];
+         }
+      }
+
+      /// Uniform grid of sat, or NULL; the Lagrange interpolation needs at
+      /// least 4 points
+      const UniformGrid* findGrid(const SatID& sat) const
+         { return (Nhalf < 2 ? 0 : TabularSatStore<PositionRecord>::findGrid(sat, Nhalf)); }
+
    // member functions
    public:
 
@@ -142,6 +173,22 @@ namespace gnssSpace
       Triple getAcceleration(const SatID& sat, const CommonTime& ttag)
          const noexcept(false);
 
+      /// Position and velocity of several satellites at the same time, as
+      /// getValue() computes them. The satellites whose tables are on the
+      /// same uniform grid share the interpolation interval and weights, the
+      /// others are computed one by one.
+      /// @param[in] sats the satellites of interest
+      /// @param[in] ttag the time of interest
+      /// @param[out] pos the position of each satellite, 3 values per
+      ///    satellite, in the units of the store
+      /// @param[out] vel the velocity of each satellite, 3 values
+      /// @param[out] valid 1 if the satellite is computed, 0 if getValue()
+      ///    would have thrown InvalidRequest
+      /// @return the number of satellites computed
+      int getPositionBatch(const std::vector<SatID>& sats, const CommonTime& ttag,
+                           std::vector<double>& pos, std::vector<double>& vel,
+                           std::vector<char>& valid) const;
+
       /// Dump information about the object to an ostream.
       /// @param[in] os ostream to receive the output; defaults to std::cout
       /// @param[in] detail integer level of detail to provide; allowed values are
@@ -191,13 +238,26 @@ namespace gnssSpace
 
       /// Set the interpolation order; this routine forces the order to be even.
       void setInterpolationOrder(unsigned int order) throw()
-         { Nhalf = (order+1)/2; interpOrder = 2*Nhalf; }
+      {
+         Nhalf = (order+1)/2; interpOrder = 2*Nhalf;
+         gridCache.valid = false;         // new weights
+      }
+
 
       /// Set the flag; if true then bad position values are rejected when
       /// adding data to the store.
       void rejectBadPositions(const bool flag)
          { rejectBadPosFlag=flag; }
 
+      /// Write the tables to a binary snapshot (BinarySnapshot.hpp)
+      void writeSnapshot(BinarySnapshotWriter& w) const;
+
+      /// Add the tables written by writeSnapshot(), as addPositionRecord()
+      /// does for each record.
+      /// @throw InvalidRequest if the time system differs from the store's
+      void readSnapshot(BinarySnapshotReader& r)
+         noexcept(false);
+
    }; // end class PositionSatStore
 
       //@}
@@ -0,0 +1,144 @@
+#pragma ident "$Id$"
+
+/**
+ * @file Rtcm3Framer.cpp
+ * Split a RTCM 3 byte stream into frames.
+ */
+
+#include <cstring>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "Rtcm3Framer.hpp"
+
+#define debug 0
+
+using namespace utilSpace;
+
+namespace gnssSpace
+{
+
+      /// table of the CRC-24Q polynomial 0x1864CFB
+   static std::vector<uint32_t> crc24qTable()
+   {
+      std::vector<uint32_t> table(256);
+      for(uint32_t i=0; i<256; i++)
+      {
+         uint32_t crc = i << 16;
+         for(int j=0; j<8; j++)
+         {
+            crc <<= 1;
+            if(crc & 0x1000000) crc ^= 0x1864CFB;
+         }
+         table[i] = crc & 0xFFFFFF;
+      }
+      return table;
+   }
+
+
+   uint32_t crc24q(const unsigned char* buf, size_t len)
+   {
+      static const std::vector<uint32_t> table = crc24qTable();
+
+      uint32_t crc(0);
+      for(size_t i=0; i<len; i++)
+      {
+         crc = ((crc << 8) & 0xFFFFFF) ^ table[(crc >> 16) ^ buf[i]];
+      }
+      return crc;
+   }
+
+
+   void Rtcm3Framer::push(const unsigned char* data, size_t n)
+   {
+      // the scanned bytes are dropped, at most one frame is left
+      if(pos > 0)
+      {
+         buff.erase(buff.begin(), buff.begin()+pos);
+         pos = 0;
+      }
+
+      buff.insert(buff.end(), data, data+n);
+   }
+
+
+   bool Rtcm3Framer::next()
+   {
+      while(true)
+      {
+         // look for the preamble
+         while(pos < buff.size() && buff[pos] != 0xD3) pos++;
+
+         if(buff.size() - pos < 3) return false;
+
+         const unsigned char* frame = &buff[pos];
+
+         // the 6 bits after the preamble are reserved (0), otherwise
+         // the 0xD3 was a data byte
+         if(getbitu(frame, 8, 6) != 0)
+         {
+            pos++;
+            continue;
+         }
+
+         size_t frameLen = getbitu(frame, 14, 10) + 6;
+         if(buff.size() - pos < frameLen) return false;
+
+         if(crc24q(frame, frameLen-3) != getbitu(frame, (frameLen-3)*8, 24))
+         {
+            // the real preamble may be inside this frame
+            numCrcErrors++;
+            pos++;
+            continue;
+         }
+
+         numFrames++;
+
+         msgPos = pos + 3;
+         msgLen = frameLen - 6;
+
+         pos += frameLen;
+
+         return true;
+      }
+
+   }  // End of method 'Rtcm3Framer::next()'
+
+
+   int Rtcm3Framer::connectTcp(const std::string& host, int port)
+      noexcept(false)
+   {
+      struct addrinfo hints;
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_INET;
+      hints.ai_socktype = SOCK_STREAM;
+
+      struct addrinfo* res(NULL);
+      std::string service = std::to_string(port);
+      if(getaddrinfo(host.c_str(), service.c_str(), &hints, &res) != 0)
+      {
+         InvalidRequest e("Rtcm3Framer: unknown host " + host);
+         THROW(e);
+      }
+
+      int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+      if(sock < 0 || connect(sock, res->ai_addr, res->ai_addrlen) != 0)
+      {
+         if(sock >= 0) close(sock);
+         freeaddrinfo(res);
+
+         InvalidRequest e("Rtcm3Framer: can't connect to " + host
+                          + ":" + service);
+         THROW(e);
+      }
+
+      freeaddrinfo(res);
+
+      return sock;
+
+   }  // End of method 'Rtcm3Framer::connectTcp()'
+
+}  // End of namespace gnssSpace
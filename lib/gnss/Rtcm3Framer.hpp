@@ -0,0 +1,143 @@
+#pragma ident "$Id$"
+
+/**
+ * @file Rtcm3Framer.hpp
+ * Split a RTCM 3 byte stream into frames, shared by the decoders of
+ * the ephemeris (Rtcm3NavStore) and observation (Rtcm3ObsDecoder)
+ * messages.
+ *
+ * A frame is the preamble 0xD3, 6 reserved bits (0), the 10-bit length
+ * of the message, the message and its CRC-24Q. The bytes are pushed as
+ * they are read, in chunks of any size; next() returns the frames with
+ * a valid CRC one by one. After a wrong CRC the search starts again at
+ * the byte after the false preamble, so a 0xD3 inside the data or some
+ * garbage between the frames doesn't lose the next frame.
+ */
+
+#ifndef Rtcm3Framer_HPP
+#define Rtcm3Framer_HPP
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+#include "Exception.hpp"
+
+namespace gnssSpace
+{
+
+      /// CRC-24Q of buf[0..len-1]
+   uint32_t crc24q(const unsigned char* buf, size_t len);
+
+      /// Unsigned field of len bits starting at bit pos
+   inline uint32_t getbitu(const unsigned char* buff, int pos, int len)
+   {
+      uint32_t bits(0);
+      for(int i=pos; i<pos+len; i++)
+      {
+         bits = (bits << 1) + ((buff[i/8] >> (7-i%8)) & 1u);
+      }
+      return bits;
+   }
+
+      /// Two's complement field of len bits starting at bit pos
+   inline int32_t getbits(const unsigned char* buff, int pos, int len)
+   {
+      uint32_t bits = getbitu(buff, pos, len);
+      if(len <= 0 || 32 <= len || !(bits & (1u << (len-1))))
+      {
+         return (int32_t)bits;
+      }
+      return (int32_t)(bits | (~0u << len));   // extend the sign
+   }
+
+      /// Sign-magnitude field of len bits (GLONASS) starting at bit pos
+   inline double getbitg(const unsigned char* buff, int pos, int len)
+   {
+      double value = getbitu(buff, pos+1, len-1);
+      return getbitu(buff, pos, 1) ? -value : value;
+   }
+
+
+      /** Frames of a RTCM 3 stream.
+       *
+       * @code
+       *   Rtcm3Framer framer;
+       *   framer.push(data, n);
+       *   while(framer.next())
+       *   {
+       *      int type = framer.messageType();
+       *      decode(framer.message(), framer.length());
+       *   }
+       * @endcode
+       */
+   class Rtcm3Framer
+   {
+   public:
+
+      Rtcm3Framer()
+         : pos(0), msgPos(0), msgLen(0),
+           numFrames(0), numCrcErrors(0)
+      {};
+
+         /// Append the bytes of the stream
+      void push(const unsigned char* data, size_t n);
+
+         /// Find the next frame with a valid CRC in the pushed bytes.
+         /// The message is valid until the next call of push() or next().
+         /// @return false if no complete frame is left
+      bool next();
+
+         /// Message of the frame found by next(), without the preamble,
+         /// the length and the CRC
+      const unsigned char* message() const
+      { return &buff[msgPos]; };
+
+         /// Length of the message in bytes
+      int length() const
+      { return msgLen; };
+
+         /// Message number of the frame
+      int messageType() const
+      { return (msgLen >= 2) ? (int)getbitu(message(), 0, 12) : 0; };
+
+         /// Drop the bytes not decoded, e.g. for a new connection
+      void clear()
+      {
+         buff.clear();
+         pos = 0;
+      };
+
+         /// Connect to a TCP server sending RTCM 3, e.g. a local caster
+         /// @return socket of the connection
+      static int connectTcp(const std::string& host, int port)
+         noexcept(false);
+
+         /// frames with a valid CRC, and frames with a wrong CRC
+      unsigned long getNumFrames() const
+      { return numFrames; };
+
+      unsigned long getNumCrcErrors() const
+      { return numCrcErrors; };
+
+   private:
+
+         /// bytes pushed and not consumed yet
+      std::vector<unsigned char> buff;
+
+         /// first byte of buff not scanned yet
+      size_t pos;
+
+         /// message of the last frame found
+      size_t msgPos;
+      int msgLen;
+
+      unsigned long numFrames;
+      unsigned long numCrcErrors;
+
+   }; // End of class 'Rtcm3Framer'
+
+}  // End of namespace gnssSpace
+
+#endif   // Rtcm3Framer_HPP
@@ -1,5 +1,541 @@
 //
 // Created by liu on 3/30/22.
 //
+// Decode the RTCM 3 ephemeris messages 1019/1020/1042/1045/1046, the
+// field layout follows RTCM 10403.3.
+//
+
+#include <cmath>
+#include <fstream>
+
+#include <unistd.h>
 
 #include "Rtcm3NavStore.hpp"
+#include "CivilTime.hpp"
+#include "SystemTime.hpp"
+#include "GPSWeekSecond.hpp"
+#include "BDSWeekSecond.hpp"
+#include "ConvertTime.hpp"
+#include "TimeConstants.hpp"
+
+#define debug 0
+
+namespace gnssSpace
+{
+
+    /// scale factors 2^-n
+    static const double P2_5  = 0.03125;
+    static const double P2_6  = 0.015625;
+    static const double P2_11 = 4.882812500000000E-04;
+    static const double P2_19 = 1.907348632812500E-06;
+    static const double P2_20 = 9.536743164062500E-07;
+    static const double P2_29 = 1.862645149230957E-09;
+    static const double P2_30 = 9.313225746154785E-10;
+    static const double P2_31 = 4.656612873077393E-10;
+    static const double P2_32 = 2.328306436538696E-10;
+    static const double P2_33 = 1.164153218269348E-10;
+    static const double P2_34 = 5.820766091346740E-11;
+    static const double P2_40 = 9.094947017729280E-13;
+    static const double P2_43 = 1.136868377216160E-13;
+    static const double P2_46 = 1.421085471520200E-14;
+    static const double P2_50 = 8.881784197001252E-16;
+    static const double P2_55 = 2.775557561562891E-17;
+    static const double P2_59 = 1.734723475976807E-18;
+    static const double P2_66 = 1.355252715606881E-20;
+
+    /// semi-circle to radian
+    static const double SC2RAD = 3.1415926535898;
+
+    /// URA index to meters (GPS and BDS)
+    static double uraValue(int index)
+    {
+        static const double ura[] = { 2.4, 3.4, 4.85, 6.85, 9.65, 13.65,
+                                      24.0, 48.0, 96.0, 192.0, 384.0, 768.0,
+                                      1536.0, 3072.0, 6144.0 };
+        return (index >= 0 && index < 15) ? ura[index] : 6144.0;
+    }
+
+    /// Galileo SISA index to meters, -1 if no accuracy is predicted
+    static double sisaValue(int index)
+    {
+        if(index <= 49)  return index*0.01;
+        if(index <= 74)  return 0.5 + (index-50)*0.02;
+        if(index <= 99)  return 1.0 + (index-75)*0.04;
+        if(index <= 125) return 2.0 + (index-100)*0.16;
+        return -1.0;
+    }
+
+
+    int Rtcm3NavStore::input(const unsigned char* data, size_t n)
+    {
+        int num(0);
+
+        framer.push(data, n);
+        while(framer.next())
+        {
+            num += decodeFrame(framer.message(), framer.length());
+        }
+
+        if(pConcurrentStore != NULL && !updatedSats.empty())
+        {
+            pConcurrentStore->update(*this, updatedSats);
+        }
+        updatedSats.clear();
+
+        numEphs += num;
+
+        return num;
+
+    }  // End of method 'Rtcm3NavStore::input()'
+
+
+    int Rtcm3NavStore::decodeFrame(const unsigned char* msg, int len)
+    {
+        if(len < 2) return 0;
+
+        int type = getbitu(msg, 0, 12);
+
+        if(debug)
+            cout << "Rtcm3NavStore: message " << type << endl;
+
+        switch(type)
+        {
+            case 1019: return decodeGPSEph(msg, len);
+            case 1020: return decodeGloEph(msg, len);
+            case 1042: return decodeBDSEph(msg, len);
+            case 1045:
+            case 1046: return decodeGalEph(msg, len, type);
+            default:   return 0;
+        }
+    }
+
+
+    int Rtcm3NavStore::decodeGPSEph(const unsigned char* msg, int len)
+    {
+        int i = 12;
+        if(i+476 > len*8) return 0;
+
+        GPSEphemeris gpsEph;
+
+        int prn      = getbitu(msg, i, 6);                    i += 6;
+        int week     = getbitu(msg, i,10);                    i += 10;
+        int sva      = getbitu(msg, i, 4);                    i += 4;
+        gpsEph.L2Codes = getbitu(msg, i, 2);                  i += 2;
+        gpsEph.IDOT  = getbits(msg, i,14)*P2_43*SC2RAD;       i += 14;
+        gpsEph.IODE  = getbitu(msg, i, 8);                    i += 8;
+        double toc   = getbitu(msg, i,16)*16.0;               i += 16;
+        gpsEph.af2   = getbits(msg, i, 8)*P2_55;              i += 8;
+        gpsEph.af1   = getbits(msg, i,16)*P2_43;              i += 16;
+        gpsEph.af0   = getbits(msg, i,22)*P2_31;              i += 22;
+        gpsEph.IODC  = getbitu(msg, i,10);                    i += 10;
+        gpsEph.Crs   = getbits(msg, i,16)*P2_5;               i += 16;
+        gpsEph.Delta_n = getbits(msg, i,16)*P2_43*SC2RAD;     i += 16;
+        gpsEph.M0    = getbits(msg, i,32)*P2_31*SC2RAD;       i += 32;
+        gpsEph.Cuc   = getbits(msg, i,16)*P2_29;              i += 16;
+        gpsEph.ecc   = getbitu(msg, i,32)*P2_33;              i += 32;
+        gpsEph.Cus   = getbits(msg, i,16)*P2_29;              i += 16;
+        gpsEph.sqrt_A = getbitu(msg, i,32)*P2_19;             i += 32;
+        gpsEph.Toe   = getbitu(msg, i,16)*16.0;               i += 16;
+        gpsEph.Cic   = getbits(msg, i,16)*P2_29;              i += 16;
+        gpsEph.OMEGA_0 = getbits(msg, i,32)*P2_31*SC2RAD;     i += 32;
+        gpsEph.Cis   = getbits(msg, i,16)*P2_29;              i += 16;
+        gpsEph.i0    = getbits(msg, i,32)*P2_31*SC2RAD;       i += 32;
+        gpsEph.Crc   = getbits(msg, i,16)*P2_5;               i += 16;
+        gpsEph.omega = getbits(msg, i,32)*P2_31*SC2RAD;       i += 32;
+        gpsEph.OMEGA_DOT = getbits(msg, i,24)*P2_43*SC2RAD;   i += 24;
+        gpsEph.TGD   = getbits(msg, i, 8)*P2_31;              i += 8;
+        gpsEph.SV_health = getbitu(msg, i, 6);                i += 6;
+        gpsEph.L2Pflag = getbitu(msg, i, 1);                  i += 1;
+        gpsEph.fitInterval = getbitu(msg, i, 1) ? 0.0 : 4.0;
+
+        if(prn < 1 || prn > 32) return 0;
+
+        SatID sat(SatelliteSystem::GPS, prn);
+        addSat(sat);
+        gpsEph.satID = sat;
+
+        // the week is given modulo 1024
+        GPSWeekSecond ref(getRefTime());
+        week += 1024*(int)std::floor((ref.week - week)/1024.0 + 0.5);
+
+        gpsEph.GPSWeek = week;
+        gpsEph.URA = uraValue(sva);
+        gpsEph.HOWtime = (long)gpsEph.Toe;
+
+        gpsEph.ctToe = GPSWeekSecond(week, gpsEph.Toe, TimeSystem::GPS).convertToCommonTime();
+        gpsEph.ctToe.setTimeSystem(TimeSystem::GPS);
+
+        int tocWeek = week;
+        if(toc - gpsEph.Toe < -HALFWEEK) tocWeek++;
+        else if(toc - gpsEph.Toe > HALFWEEK) tocWeek--;
+
+        gpsEph.Toc = toc;
+        gpsEph.ctToc = GPSWeekSecond(tocWeek, toc, TimeSystem::GPS).convertToCommonTime();
+        gpsEph.ctToc.setTimeSystem(TimeSystem::GPS);
+        gpsEph.CivilToc = CivilTime(gpsEph.ctToc);
+
+        gpsEph.setOrbitConstants();
+
+        gpsEphData[sat][gpsEph.ctToe] = gpsEph;
+
+        updateRefTime(gpsEph.ctToe);
+
+        return 1;
+
+    }  // End of method 'Rtcm3NavStore::decodeGPSEph()'
+
+
+    int Rtcm3NavStore::decodeGloEph(const unsigned char* msg, int len)
+    {
+        int i = 12;
+        if(i+348 > len*8) return 0;
+
+        GloEphemeris gloEph;
+
+        int prn     = getbitu(msg, i, 6);                 i += 6;
+        int frq     = getbitu(msg, i, 5);                 i += 5+2+2;
+        int tk_h    = getbitu(msg, i, 5);                 i += 5;
+        int tk_m    = getbitu(msg, i, 6);                 i += 6;
+        double tk_s = getbitu(msg, i, 1)*30.0;            i += 1;
+        int bn      = getbitu(msg, i, 1);                 i += 1+1;
+        int tb      = getbitu(msg, i, 7);                 i += 7;
+        gloEph.vx   = getbitg(msg, i,24)*P2_20;           i += 24;
+        gloEph.px   = getbitg(msg, i,27)*P2_11;           i += 27;
+        gloEph.ax   = getbitg(msg, i, 5)*P2_30;           i += 5;
+        gloEph.vy   = getbitg(msg, i,24)*P2_20;           i += 24;
+        gloEph.py   = getbitg(msg, i,27)*P2_11;           i += 27;
+        gloEph.ay   = getbitg(msg, i, 5)*P2_30;           i += 5;
+        gloEph.vz   = getbitg(msg, i,24)*P2_20;           i += 24;
+        gloEph.pz   = getbitg(msg, i,27)*P2_11;           i += 27;
+        gloEph.az   = getbitg(msg, i, 5)*P2_30;           i += 5+1;
+        gloEph.GammaN = getbitg(msg, i,11)*P2_40;         i += 11+3;
+        double taun = getbitg(msg, i,22)*P2_30;           i += 22+5;
+        gloEph.ageOfInfo = getbitu(msg, i, 5);
+
+        if(prn < 1 || prn > 24) return 0;
+
+        SatID sat(SatelliteSystem::GLONASS, prn);
+        addSat(sat);
+        gloEph.satID = sat;
+
+        // the RINEX files store -TauN
+        gloEph.TauN = -taun;
+        gloEph.freqNum = frq - 7;
+        gloEph.health = bn;
+
+        // tb and tk are Moscow times of day (UTC+3h), the day is taken
+        // from the reference time
+        CommonTime refUTC = convertTimeSystem(getRefTime(), TimeSystem::UTC);
+        CivilTime refCivil(refUTC);
+        double tod = refCivil.hour*3600.0 + refCivil.minute*60.0 + refCivil.second;
+        CommonTime dayStart = refUTC;
+        dayStart -= tod;
+
+        double toe = tb*900.0 - 10800.0;
+        if(toe < tod-43200.0) toe += 86400.0;
+        else if(toe > tod+43200.0) toe -= 86400.0;
+
+        double tof = tk_h*3600.0 + tk_m*60.0 + tk_s - 10800.0;
+        if(tof < tod-43200.0) tof += 86400.0;
+        else if(tof > tod+43200.0) tof -= 86400.0;
+
+        // the GLONASS epochs are in UTC, as in the RINEX files
+        gloEph.ctToe = dayStart;
+        gloEph.ctToe += toe;
+        gloEph.ctToe.setTimeSystem(TimeSystem::GLO);
+        gloEph.CivilToc = CivilTime(gloEph.ctToe);
+
+        GPSWeekSecond gws(gloEph.ctToe);      // sow is system-independent
+        gloEph.Toc = gws.sow;
+
+        CommonTime ctTof = dayStart;
+        ctTof += tof;
+        gloEph.MFtime = GPSWeekSecond(ctTof).sow;
+
+        gloEphData[sat][gloEph.ctToe] = gloEph;
+
+        return 1;
+
+    }  // End of method 'Rtcm3NavStore::decodeGloEph()'
+
+
+    int Rtcm3NavStore::decodeBDSEph(const unsigned char* msg, int len)
+    {
+        int i = 12;
+        if(i+499 > len*8) return 0;
+
+        BDSEphemeris bdsEph;
+
+        int prn      = getbitu(msg, i, 6);                    i += 6;
+        int week     = getbitu(msg, i,13);                    i += 13;
+        int urai     = getbitu(msg, i, 4);                    i += 4;
+        bdsEph.IDOT  = getbits(msg, i,14)*P2_43*SC2RAD;       i += 14;
+        bdsEph.IODE  = getbitu(msg, i, 5);                    i += 5;
+        double toc   = getbitu(msg, i,17)*8.0;                i += 17;
+        bdsEph.af2   = getbits(msg, i,11)*P2_66;              i += 11;
+        bdsEph.af1   = getbits(msg, i,22)*P2_50;              i += 22;
+        bdsEph.af0   = getbits(msg, i,24)*P2_33;              i += 24;
+        bdsEph.IODC  = getbitu(msg, i, 5);                    i += 5;
+        bdsEph.Crs   = getbits(msg, i,18)*P2_6;               i += 18;
+        bdsEph.Delta_n = getbits(msg, i,16)*P2_43*SC2RAD;     i += 16;
+        bdsEph.M0    = getbits(msg, i,32)*P2_31*SC2RAD;       i += 32;
+        bdsEph.Cuc   = getbits(msg, i,18)*P2_31;              i += 18;
+        bdsEph.ecc   = getbitu(msg, i,32)*P2_33;              i += 32;
+        bdsEph.Cus   = getbits(msg, i,18)*P2_31;              i += 18;
+        bdsEph.sqrt_A = getbitu(msg, i,32)*P2_19;             i += 32;
+        bdsEph.Toe   = getbitu(msg, i,17)*8.0;                i += 17;
+        bdsEph.Cic   = getbits(msg, i,18)*P2_31;              i += 18;
+        bdsEph.OMEGA_0 = getbits(msg, i,32)*P2_31*SC2RAD;     i += 32;
+        bdsEph.Cis   = getbits(msg, i,18)*P2_31;              i += 18;
+        bdsEph.i0    = getbits(msg, i,32)*P2_31*SC2RAD;       i += 32;
+        bdsEph.Crc   = getbits(msg, i,18)*P2_6;               i += 18;
+        bdsEph.omega = getbits(msg, i,32)*P2_31*SC2RAD;       i += 32;
+        bdsEph.OMEGA_DOT = getbits(msg, i,24)*P2_43*SC2RAD;   i += 24;
+        bdsEph.TGD1  = getbits(msg, i,10)*1.0e-10;            i += 10;
+        bdsEph.TGD2  = getbits(msg, i,10)*1.0e-10;            i += 10;
+        bdsEph.SV_health = getbitu(msg, i, 1);
+
+        if(prn < 1 || prn > 63) return 0;
+
+        SatID sat(SatelliteSystem::BDS, prn);
+        addSat(sat);
+
+        // the week is the full BDT week
+        bdsEph.BDSWeek = week;
+        bdsEph.URA = uraValue(urai);
+        bdsEph.HOWtime = (long)bdsEph.Toe;
+
+        bdsEph.ctToe = BDSWeekSecond(week, bdsEph.Toe, TimeSystem::BDT).convertToCommonTime();
+        bdsEph.ctToe.setTimeSystem(TimeSystem::BDT);
+
+        int tocWeek = week;
+        if(toc - bdsEph.Toe < -HALFWEEK) tocWeek++;
+        else if(toc - bdsEph.Toe > HALFWEEK) tocWeek--;
+
+        bdsEph.Toc = toc;
+        bdsEph.ctToc = BDSWeekSecond(tocWeek, toc, TimeSystem::BDT).convertToCommonTime();
+        bdsEph.ctToc.setTimeSystem(TimeSystem::BDT);
+        bdsEph.CivilToc = CivilTime(bdsEph.ctToc);
+
+        bdsEph.setOrbitConstants();
+
+        bdsEphData[sat][bdsEph.ctToe] = bdsEph;
+
+        updateRefTime(bdsEph.ctToe);
+
+        return 1;
+
+    }  // End of method 'Rtcm3NavStore::decodeBDSEph()'
+
+
+    int Rtcm3NavStore::decodeGalEph(const unsigned char* msg, int len, int type)
+    {
+        int i = 12;
+        if(i + (type == 1045 ? 484 : 492) > len*8) return 0;
+
+        GalEphemeris galEph;
+
+        int prn      = getbitu(msg, i, 6);                    i += 6;
+        int week     = getbitu(msg, i,12);                    i += 12;
+        galEph.IODE  = getbitu(msg, i,10);                    i += 10;
+        int sisa     = getbitu(msg, i, 8);                    i += 8;
+        galEph.IDOT  = getbits(msg, i,14)*P2_43*SC2RAD;       i += 14;
+        double toc   = getbitu(msg, i,14)*60.0;               i += 14;
+        galEph.af2   = getbits(msg, i, 6)*P2_59;              i += 6;
+        galEph.af1   = getbits(msg, i,21)*P2_46;              i += 21;
+        galEph.af0   = getbits(msg, i,31)*P2_34;              i += 31;
+        galEph.Crs   = getbits(msg, i,16)*P2_5;               i += 16;
+        galEph.Delta_n = getbits(msg, i,16)*P2_43*SC2RAD;     i += 16;
+        galEph.M0    = getbits(msg, i,32)*P2_31*SC2RAD;       i += 32;
+        galEph.Cuc   = getbits(msg, i,16)*P2_29;              i += 16;
+        galEph.ecc   = getbitu(msg, i,32)*P2_33;              i += 32;
+        galEph.Cus   = getbits(msg, i,16)*P2_29;              i += 16;
+        galEph.sqrt_A = getbitu(msg, i,32)*P2_19;             i += 32;
+        galEph.Toe   = getbitu(msg, i,14)*60.0;               i += 14;
+        galEph.Cic   = getbits(msg, i,16)*P2_29;              i += 16;
+        galEph.OMEGA_0 = getbits(msg, i,32)*P2_31*SC2RAD;     i += 32;
+        galEph.Cis   = getbits(msg, i,16)*P2_29;              i += 16;
+        galEph.i0    = getbits(msg, i,32)*P2_31*SC2RAD;       i += 32;
+        galEph.Crc   = getbits(msg, i,16)*P2_5;               i += 16;
+        galEph.omega = getbits(msg, i,32)*P2_31*SC2RAD;       i += 32;
+        galEph.OMEGA_DOT = getbits(msg, i,24)*P2_43*SC2RAD;   i += 24;
+        galEph.TGD1  = getbits(msg, i,10)*P2_32;              i += 10;
+
+        // health and data validity bits, as in the RINEX files
+        int health(0);
+        if(type == 1045)
+        {
+            int e5a_hs  = getbitu(msg, i, 2);                 i += 2;
+            int e5a_dvs = getbitu(msg, i, 1);
+            health = (e5a_hs << 4) + (e5a_dvs << 3);
+
+            galEph.TGD2 = 0.0;
+            galEph.dataSource = 258;       // F/NAV E5a-I, E5a/E1 clock
+        }
+        else
+        {
+            galEph.TGD2 = getbits(msg, i,10)*P2_32;           i += 10;
+            int e5b_hs  = getbitu(msg, i, 2);                 i += 2;
+            int e5b_dvs = getbitu(msg, i, 1);                 i += 1;
+            int e1_hs   = getbitu(msg, i, 2);                 i += 2;
+            int e1_dvs  = getbitu(msg, i, 1);
+            health = (e5b_hs << 7) + (e5b_dvs << 6) + (e1_hs << 1) + e1_dvs;
+
+            galEph.dataSource = 517;       // I/NAV E1-B and E5b-I, E5b/E1 clock
+        }
+
+        if(prn < 1 || prn > 36) return 0;
+
+        SatID sat(SatelliteSystem::Galileo, prn);
+        addSat(sat);
+        galEph.satID = sat;
+
+        // GST week, the RINEX files use the GPS week
+        week += 1024;
+
+        galEph.GALWeek = week;
+        galEph.URA = sisaValue(sisa);
+        galEph.SV_health = health;
+        galEph.HOWtime = (long)galEph.Toe;
+
+        galEph.ctToe = GPSWeekSecond(week, galEph.Toe, TimeSystem::GPS).convertToCommonTime();
+        galEph.ctToe.setTimeSystem(TimeSystem::GAL);
+
+        int tocWeek = week;
+        if(toc - galEph.Toe < -HALFWEEK) tocWeek++;
+        else if(toc - galEph.Toe > HALFWEEK) tocWeek--;
+
+        galEph.Toc = toc;
+        galEph.ctToc = GPSWeekSecond(tocWeek, toc, TimeSystem::GPS).convertToCommonTime();
+        galEph.ctToc.setTimeSystem(TimeSystem::GAL);
+        galEph.CivilToc = CivilTime(galEph.ctToc);
+
+        galEph.setOrbitConstants();
+
+        galEphData[sat][galEph.ctToe] = galEph;
+
+        updateRefTime(galEph.ctToe);
+
+        return 1;
+
+    }  // End of method 'Rtcm3NavStore::decodeGalEph()'
+
+
+    CommonTime Rtcm3NavStore::getRefTime() const
+    {
+        if(hasRefTime)
+        {
+            return convertTimeSystem(refTime, TimeSystem::GPS);
+        }
+
+        if(hasEphTime)
+        {
+            return lastEphTime;
+        }
+
+        SystemTime now;
+        return convertTimeSystem(now.convertToCommonTime(), TimeSystem::GPS);
+    }
+
+
+    void Rtcm3NavStore::updateRefTime(const CommonTime& time)
+    {
+        CommonTime gpsTime = convertTimeSystem(time, TimeSystem::GPS);
+        if(!hasEphTime || gpsTime > lastEphTime)
+        {
+            lastEphTime = gpsTime;
+            hasEphTime = true;
+        }
+    }
+
+
+    void Rtcm3NavStore::addSat(const SatID& sat)
+    {
+        vector<SatID>::iterator result = find(satTable.begin(),satTable.end(),sat);
+        if(result==satTable.end())
+        {
+            satTable.push_back(sat);
+        }
+
+        if(find(updatedSats.begin(), updatedSats.end(), sat) == updatedSats.end())
+        {
+            updatedSats.push_back(sat);
+        }
+    }
+
+
+    int Rtcm3NavStore::loadRtcmFile(string& file)
+        noexcept(false)
+    {
+        ifstream rtcmFile(file.c_str(), ios::in | ios::binary);
+        if(!rtcmFile)
+        {
+            FileMissingException e("Rtcm3NavStore: can't open " + file);
+            THROW(e);
+        }
+
+        int num(0);
+        std::vector<char> buff(65536);
+        while(rtcmFile)
+        {
+            rtcmFile.read(&buff[0], buff.size());
+            std::streamsize n = rtcmFile.gcount();
+            if(n <= 0) break;
+
+            num += input(reinterpret_cast<const unsigned char*>(&buff[0]), n);
+        }
+
+        return num;
+
+    }  // End of method 'Rtcm3NavStore::loadRtcmFile()'
+
+
+    void Rtcm3NavStore::openTcp(const string& host, int port)
+        noexcept(false)
+    {
+        closeTcp();
+
+        int sock(-1);
+        try
+        {
+            sock = Rtcm3Framer::connectTcp(host, port);
+        }
+        catch(InvalidRequest& e)
+        {
+            RETHROW(e);
+        }
+
+        sockfd = sock;
+
+        // a new stream starts with a new frame
+        framer.clear();
+
+    }  // End of method 'Rtcm3NavStore::openTcp()'
+
+
+    int Rtcm3NavStore::readTcp()
+    {
+        if(sockfd < 0) return -1;
+
+        unsigned char buff[4096];
+        ssize_t n = read(sockfd, buff, sizeof(buff));
+        if(n <= 0)
+        {
+            closeTcp();
+            return -1;
+        }
+
+        return input(buff, n);
+    }
+
+
+    void Rtcm3NavStore::closeTcp()
+    {
+        if(sockfd >= 0)
+        {
+            close(sockfd);
+            sockfd = -1;
+        }
+    }
+
+}  // End of namespace gnssSpace
@@ -1,32 +1,47 @@
 //
 // Created by liu on 3/30/22.
 //
+// Store the broadcast ephemerides decoded from a RTCM 3 stream.
+//
+// The bytes of a file or a TCP connection are given to input() as they
+// arrive; the framer (Rtcm3Framer) looks for the preamble 0xD3, takes the
+// 10-bit length and checks the CRC-24Q of each frame, and the ephemeris
+// messages are decoded into the maps of Rx3NavStore:
+//
+//  \li 1019  GPS
+//  \li 1020  GLONASS
+//  \li 1042  BDS
+//  \li 1045  Galileo F/NAV
+//  \li 1046  Galileo I/NAV
+//
+// A new ephemeris is inserted with its reference time as the key, and a
+// repeated one replaces the stored copy, so the store is updated while
+// running, and getXvt()/getXvtBatch() of Rx3NavStore see the new data at
+// once. The other messages are skipped.
+//
+// The store itself is for the decoding thread; to share the ephemerides
+// with reader threads, give a ConcurrentNavStore to setConcurrentStore(),
+// and the satellites updated by each input() are published to it.
+//
+// The GPS week of 1019 is given modulo 1024, and the GLONASS message only
+// carries the time of day, so they are resolved with a reference time:
+// the one given by setRefTime(), else the latest reference time of the
+// decoded ephemerides, else the system time.
+//
 
 #ifndef GNSSBOX_RTCM3NAVSTORE_HPP
 #define GNSSBOX_RTCM3NAVSTORE_HPP
 
 #include <iostream>
 #include <string>
-#include <list>
-#include <map>
-#include <algorithm>
-#include <fstream>
+#include <vector>
+#include <stdint.h>
 
 #include "Exception.hpp"
-#include "StringUtils.hpp"
-#include "Xvt.hpp"
-#include "XvtStore.hpp"
-#include "SatID.hpp"
+#include "Rx3NavStore.hpp"
 #include "CommonTime.hpp"
-#include "GPSEphemeris.hpp"
-#include "BDSEphemeris.hpp"
-#include "GalEphemeris.hpp"
-#include "GloEphemeris.hpp"
-#include "GPSWeekSecond.hpp"
-#include "BDSWeekSecond.hpp"
-
-#include "ConvertTime.hpp"
-
+#include "Rtcm3Framer.hpp"
+#include "ConcurrentNavStore.hpp"
 
 using namespace std;
 using namespace utilSpace;
@@ -34,124 +49,109 @@ using namespace gnssSpace;
 
 namespace gnssSpace {
 
-    class Rtcm3NavStore : public XvtStore<SatID>{
+    class Rtcm3NavStore : public Rx3NavStore
+    {
     public:
 
         Rtcm3NavStore()
+            : hasRefTime(false), hasEphTime(false),
+              pConcurrentStore(NULL), sockfd(-1), numEphs(0)
         {};
 
-        Rtcm3NavStore(const std::string& navFile )
-        {
-            rx3NavFile = navFile;
-        };
+        /// Decode the RTCM 3 bytes of data, which may hold any part of
+        /// the frames; the incomplete frame at the end is kept for the
+        /// next call.
+        /// @return number of ephemerides inserted or updated
+        int input(const unsigned char* data, size_t n);
 
+        /// Decode a binary RTCM 3 file. Named apart from loadFile(), which
+        /// still reads the RINEX navigation files.
+        /// @return number of ephemerides inserted or updated
+        int loadRtcmFile(string& file)
+            noexcept(false);
 
-        void loadGPSEph(GPSEphemeris& gpsEph, string& line, fstream& navFile);
-        void loadBDSEph(BDSEphemeris& bdsEph, string& line, fstream& navFile);
-        void loadGalEph(GalEphemeris& galEph, string& line, fstream& navFile);
-        void loadGloEph(GloEphemeris& gloEph, string& line, fstream& navFile);
+        /// Connect to a TCP server sending RTCM 3, e.g. a local caster
+        void openTcp(const string& host, int port)
+            noexcept(false);
 
-        void loadFile(string& file);
+        /// Wait for the next bytes of the TCP connection and decode them
+        /// @return number of ephemerides inserted or updated, -1 if the
+        ///         connection is closed
+        int readTcp();
 
-        void showEphNum();
+        /// Close the TCP connection
+        void closeTcp();
 
-        Xvt getXvt(const SatID& sat, const CommonTime& epoch) ;
+        /// Reference time to resolve the GPS week and the GLONASS day
+        void setRefTime(const CommonTime& time)
+        {
+            refTime = time;
+            hasRefTime = true;
+        };
 
-        GPSEphemeris findGPSEphemeris(const SatID& sat, const CommonTime& epoch);
-        BDSEphemeris findBDSEphemeris(const SatID& sat, const CommonTime& epoch);
-        GalEphemeris findGalEphemeris(const SatID& sat, const CommonTime& epoch);
-        GloEphemeris findGloEphemeris(const SatID& sat, const CommonTime& epoch);
+        /// Publish the decoded ephemerides to store as well, once per
+        /// input(), for the readers in other threads
+        void setConcurrentStore(ConcurrentNavStore* store)
+        {
+            pConcurrentStore = store;
+        };
 
+        /// frames with a valid CRC, frames with a wrong CRC, and
+        /// ephemerides decoded
+        unsigned long getNumFrames() const
+        { return framer.getNumFrames(); };
 
+        unsigned long getNumCrcErrors() const
+        { return framer.getNumCrcErrors(); };
 
-        struct TimeSysCorr
-        {
-            double A0;
-            double A1;
-            int refSOW ;
-            int refWeek ;
-            string geoProvider ;
-            int geoUTCid ;
-        };
+        unsigned long getNumEphs() const
+        { return numEphs; };
 
-        typedef map<string,vector<double>> ionoCorrMap;
-        typedef map<string,TimeSysCorr> timeSysCorrMap;
-
-        string  rx3NavFile;
-
-        double version;                ///< RINEX Version
-        std::string fileType;          ///< File type "N...."
-        std::string fileSys;           ///< File system string
-        std::string fileProgram;       ///< Program string
-        std::string fileAgency;        ///< Agency string
-        std::string date;              ///< Date string; includes "UTC" at the end
-        std::vector<std::string> commentList;  ///< Comment list
-
-        ionoCorrMap ionoCorrData;
-        timeSysCorrMap timeSysCorrData;
-
-        long leapSeconds;              ///< Leap seconds
-        long leapDelta;                ///< Change in Leap seconds at ref time
-        long leapWeek;                 ///< Week number of ref time
-        long leapDay;                  ///< Day of week of ref time
-
-        static const std::string stringVersion;      /// "RINEX VERSION / TYPE"
-        static const std::string stringRunBy;        /// "PGM / RUN BY / DATE"
-        static const std::string stringComment;      /// "COMMENT"
-        // R3.x
-        static const std::string stringIonoCorr;     /// "IONOSPHERIC CORR"
-        static const std::string stringTimeSysCorr;  /// "TIME SYSTEM CORR"
-        static const std::string stringLeapSeconds;  /// "LEAP SECONDS"
-        static const std::string stringDeltaUTC;     /// "DELTA-UTC: A0,A1,T,W" // R2.11 GPS
-        static const std::string stringCorrSysTime;  /// "CORR TO SYSTEM TIME"  // R2.10 GLO
-        static const std::string stringDUTC;         /// "D-UTC A0,A1,T,W,S,U"  // R2.11 GEO
-        static const std::string stringIonAlpha;     /// "ION ALPHA"            // R2.11
-        static const std::string stringIonBeta;      /// "ION BETA"             // R2.11
-        static const std::string stringEoH;          /// "END OF HEADER"
-
-        ///tables that record the sat of different sat system
-        ///in order to get the eph data num easily
-        vector<SatID> satTable;
-
-        map<SatID, std::map<CommonTime, GPSEphemeris>> gpsEphData;
-        map<SatID, std::map<CommonTime, BDSEphemeris>> bdsEphData;
-        map<SatID, std::map<CommonTime, GalEphemeris>> galEphData;
-        map<SatID, std::map<CommonTime, GloEphemeris>> gloEphData;
-
-        /// A debugging function that outputs in human readable form,
-        /// all data stored in this object.
-        /// @param[in] s the stream to receive the output; defaults to cout
-        /// @param[in] detail the level of detail to provide
-        void dump(std::ostream& s = std::cout, short detail = 0) const
+        /// destructor
+        virtual ~Rtcm3NavStore()
         {
-            cout << ""<< endl;
+            closeTcp();
         };
 
-        void edit(const CommonTime& tmin,
-                  const CommonTime& tmax = CommonTime::END_OF_TIME)
-        {};
+    private:
 
-        void clear(void)
-        {};
+        /// Decode the message of a frame, return 1 if an ephemeris is
+        /// stored
+        int decodeFrame(const unsigned char* msg, int len);
 
-        TimeSystem getTimeSystem(void) const
-        {};
+        int decodeGPSEph(const unsigned char* msg, int len);
+        int decodeGloEph(const unsigned char* msg, int len);
+        int decodeBDSEph(const unsigned char* msg, int len);
+        int decodeGalEph(const unsigned char* msg, int len, int type);
 
-        virtual CommonTime getInitialTime(void) const
-        {};
+        /// reference time in GPS time
+        CommonTime getRefTime() const;
 
-        virtual CommonTime getFinalTime(void) const
-        {};
+        /// keep the latest ephemeris time as the reference
+        void updateRefTime(const CommonTime& time);
 
-        virtual bool hasVelocity(void) const
-        {};
+        /// add the satellite into satTable and updatedSats
+        void addSat(const SatID& sat);
 
-        virtual bool isPresent(const SatID& id) const
-        {};
+        CommonTime refTime;
+        bool hasRefTime;
 
-        /// destructor
-        virtual ~Rx3NavStore()
-        {};
+        /// latest reference time of the decoded ephemerides
+        CommonTime lastEphTime;
+        bool hasEphTime;
+
+        /// frames of the stream
+        Rtcm3Framer framer;
+
+        /// store the ephemerides are published to, and the satellites
+        /// updated by the current input()
+        ConcurrentNavStore* pConcurrentStore;
+        std::vector<SatID> updatedSats;
+
+        /// socket of the TCP connection, -1 if closed
+        int sockfd;
+
+        unsigned long numEphs;
 
     };
 }
@@ -0,0 +1,691 @@
+#pragma ident "$Id$"
+
+/**
+ * @file Rtcm3ObsDecoder.cpp
+ * Decode the RTCM 3 MSM observation messages into Rx3ObsData epochs, the
+ * field layout follows RTCM 10403.3.
+ */
+
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "Rtcm3ObsDecoder.hpp"
+#include "CivilTime.hpp"
+#include "SystemTime.hpp"
+#include "GPSWeekSecond.hpp"
+#include "ConvertTime.hpp"
+#include "TimeConstants.hpp"
+#include "constants.hpp"
+
+#define debug 0
+
+namespace gnssSpace
+{
+
+      /// scale factors 2^-n
+   static const double P2_10 = 0.0009765625;
+   static const double P2_24 = 5.960464477539063E-08;
+   static const double P2_29 = 1.862645149230957E-09;
+   static const double P2_31 = 4.656612873077393E-10;
+
+      /// range of one millisecond (m)
+   static const double RANGE_MS = C_MPS*0.001;
+
+      /// RINEX codes of the MSM signal IDs 1-32 of each system
+   static const char* msmSigGPS[32] = {
+      "",   "1C", "1P", "1W", "",   "",   "",   "2C",
+      "2P", "2W", "",   "",   "",   "",   "2S", "2L",
+      "2X", "",   "",   "",   "",   "5I", "5Q", "5X",
+      "",   "",   "",   "",   "",   "1S", "1L", "1X" };
+
+   static const char* msmSigGLO[32] = {
+      "",   "1C", "1P", "",   "",   "",   "",   "2C",
+      "2P", "",   "",   "",   "",   "",   "",   "",
+      "",   "",   "",   "",   "",   "",   "",   "",
+      "",   "",   "",   "",   "",   "",   "",   "" };
+
+   static const char* msmSigGAL[32] = {
+      "",   "1C", "1A", "1B", "1X", "1Z", "",   "6C",
+      "6A", "6B", "6X", "6Z", "",   "7I", "7Q", "7X",
+      "",   "8I", "8Q", "8X", "",   "5I", "5Q", "5X",
+      "",   "",   "",   "",   "",   "",   "",   "" };
+
+   static const char* msmSigSBS[32] = {
+      "",   "1C", "",   "",   "",   "",   "",   "",
+      "",   "",   "",   "",   "",   "",   "",   "",
+      "",   "",   "",   "",   "",   "5I", "5Q", "5X",
+      "",   "",   "",   "",   "",   "",   "",   "" };
+
+   static const char* msmSigQZS[32] = {
+      "",   "1C", "",   "",   "",   "",   "",   "",
+      "6S", "6L", "6X", "",   "",   "",   "2S", "2L",
+      "2X", "",   "",   "",   "",   "5I", "5Q", "5X",
+      "",   "",   "",   "",   "",   "1S", "1L", "1X" };
+
+      // the B1I signal is 2I since RINEX 3.04
+   static const char* msmSigBDS[32] = {
+      "",   "2I", "2Q", "2X", "",   "",   "",   "6I",
+      "6Q", "6X", "",   "",   "",   "7I", "7Q", "7X",
+      "",   "",   "",   "",   "",   "5D", "5P", "5X",
+      "7D", "",   "",   "",   "",   "1D", "1P", "1X" };
+
+
+      /// minimum lock time (ms) of the MSM4 lock time indicator
+   static double msm4LockTime(int lock)
+   {
+      return (lock == 0) ? 0.0 : std::ldexp(1.0, lock+4);
+   }
+
+      /// minimum lock time (ms) of the MSM7 extended lock time indicator
+   static double msm7LockTime(int lock)
+   {
+      if(lock < 64)  return lock;
+      if(lock >= 704) return 67108864.0;
+
+      int s = (lock-64)/32;
+      return std::ldexp(1.0, s+6) + std::ldexp(1.0, s+1)*(lock-64-32*s);
+   }
+
+      /// signal strength index of RINEX from C/N0 (dB-Hz)
+   static double ssiValue(double cnr)
+   {
+      if(cnr <= 0.0) return 0.0;
+      return std::min(std::max(std::floor(cnr/6.0), 1.0), 9.0);
+   }
+
+      /// 38-bit two's complement field of 1005/1006
+   static double getbits38(const unsigned char* buff, int pos)
+   {
+      return (double)getbits(buff, pos, 32)*64.0 + getbitu(buff, pos+32, 6);
+   }
+
+
+   Rtcm3ObsDecoder::Rtcm3ObsDecoder()
+      : hasRefTime(false), hasCurrent(false), hasLastTime(false),
+        sockfd(-1), numMsm(0)
+   {
+      header.version = 3.04;
+   }
+
+
+   int Rtcm3ObsDecoder::input(const unsigned char* data, size_t n)
+   {
+      int num(0);
+
+      framer.push(data, n);
+      while(framer.next())
+      {
+         num += decodeFrame(framer.message(), framer.length());
+      }
+
+      return num;
+
+   }  // End of method 'Rtcm3ObsDecoder::input()'
+
+
+   int Rtcm3ObsDecoder::flush()
+   {
+      return hasCurrent ? completeEpoch() : 0;
+   }
+
+
+   bool Rtcm3ObsDecoder::getEpoch(Rx3ObsData& obsData)
+   {
+      if(epochs.empty()) return false;
+
+      Epoch& epoch = epochs.front();
+
+      obsData.pHeader = &header;
+      obsData.currEpoch = epoch.time;
+      obsData.epochFlag = 0;
+      obsData.numSVs = epoch.stvData.size();
+      obsData.clockOffset = 0.0;
+
+      obsData.satTypes.swap(epoch.satTypes);
+      obsData.stvData.swap(epoch.stvData);
+      obsData.stvDataLLI.swap(epoch.stvDataLLI);
+      obsData.stvDataSSI.swap(epoch.stvDataSSI);
+
+      epochs.pop_front();
+
+      return true;
+
+   }  // End of method 'Rtcm3ObsDecoder::getEpoch()'
+
+
+   int Rtcm3ObsDecoder::decodeFrame(const unsigned char* msg, int len)
+   {
+      if(len < 2) return 0;
+
+      int type = getbitu(msg, 0, 12);
+
+      if(debug)
+         cout << "Rtcm3ObsDecoder: message " << type << endl;
+
+      switch(type)
+      {
+         case 1005:
+         case 1006: decodeStation(msg, len); return 0;
+         case 1074: return decodeMsm(msg, len, SatelliteSystem::GPS,     false);
+         case 1077: return decodeMsm(msg, len, SatelliteSystem::GPS,     true);
+         case 1084: return decodeMsm(msg, len, SatelliteSystem::GLONASS, false);
+         case 1087: return decodeMsm(msg, len, SatelliteSystem::GLONASS, true);
+         case 1094: return decodeMsm(msg, len, SatelliteSystem::Galileo, false);
+         case 1097: return decodeMsm(msg, len, SatelliteSystem::Galileo, true);
+         case 1104: return decodeMsm(msg, len, SatelliteSystem::SBAS,    false);
+         case 1107: return decodeMsm(msg, len, SatelliteSystem::SBAS,    true);
+         case 1114: return decodeMsm(msg, len, SatelliteSystem::QZSS,    false);
+         case 1117: return decodeMsm(msg, len, SatelliteSystem::QZSS,    true);
+         case 1124: return decodeMsm(msg, len, SatelliteSystem::BDS,     false);
+         case 1127: return decodeMsm(msg, len, SatelliteSystem::BDS,     true);
+         default:   return 0;
+      }
+   }
+
+
+   int Rtcm3ObsDecoder::decodeMsm( const unsigned char* msg,
+                                   int len,
+                                   SatelliteSystem::Systems sys,
+                                   bool isMsm7 )
+   {
+      // header
+      int i = 12;
+      if(i+157 > len*8) return 0;
+
+      i += 12;                                           // station ID
+      uint32_t epochField = getbitu(msg, i, 30);         i += 30;
+      int multiple = getbitu(msg, i, 1);                 i += 1;
+
+      // IODS, reserved, clock steering, external clock, smoothing
+      // indicator and interval
+      i += 3+7+2+2+1+3;
+
+      std::vector<int> sats, sigs;
+      for(int j=0; j<64; j++)
+      {
+         if(getbitu(msg, i+j, 1)) sats.push_back(j+1);
+      }
+      i += 64;
+
+      for(int j=0; j<32; j++)
+      {
+         if(getbitu(msg, i+j, 1)) sigs.push_back(j+1);
+      }
+      i += 32;
+
+      int nsat = sats.size();
+      int nsig = sigs.size();
+      if(nsat*nsig > 64 || i+nsat*nsig > len*8) return 0;
+
+      std::vector<bool> cellMask(nsat*nsig);
+      int ncell(0);
+      for(int j=0; j<nsat*nsig; j++)
+      {
+         cellMask[j] = getbitu(msg, i+j, 1);
+         if(cellMask[j]) ncell++;
+      }
+      i += nsat*nsig;
+
+      int satBits  = isMsm7 ? 36 : 18;
+      int cellBits = isMsm7 ? 80 : 48;
+      if(i + nsat*satBits + ncell*cellBits > len*8) return 0;
+
+      // satellite data
+      std::vector<double> rough(nsat, 0.0), roughRate(nsat, 0.0);
+      std::vector<bool> roughOk(nsat, false), roughRateOk(nsat, false);
+      std::vector<int> extInfo(nsat, 15);
+
+      for(int j=0; j<nsat; j++)
+      {
+         int ms = getbitu(msg, i, 8);                    i += 8;
+         roughOk[j] = (ms != 255);
+         rough[j] = ms*RANGE_MS;
+      }
+
+      if(isMsm7)
+      {
+         for(int j=0; j<nsat; j++)
+         {
+            extInfo[j] = getbitu(msg, i, 4);             i += 4;
+         }
+      }
+
+      for(int j=0; j<nsat; j++)
+      {
+         rough[j] += getbitu(msg, i, 10)*P2_10*RANGE_MS; i += 10;
+      }
+
+      if(isMsm7)
+      {
+         for(int j=0; j<nsat; j++)
+         {
+            int rate = getbits(msg, i, 14);              i += 14;
+            roughRateOk[j] = (rate != -8192);
+            roughRate[j] = rate;
+         }
+      }
+
+      // signal data
+      std::vector<double> finePr(ncell), finePh(ncell), fineRate(ncell, 0.0);
+      std::vector<double> lockTime(ncell), cnr(ncell);
+      std::vector<bool> prOk(ncell), phOk(ncell), rateOk(ncell, false);
+      std::vector<int> half(ncell);
+
+      int prBits   = isMsm7 ? 20 : 15;
+      int phBits   = isMsm7 ? 24 : 22;
+      double prRes = isMsm7 ? P2_29 : P2_24;
+      double phRes = isMsm7 ? P2_31 : P2_29;
+
+      for(int c=0; c<ncell; c++)
+      {
+         int pr = getbits(msg, i, prBits);               i += prBits;
+         prOk[c] = (pr != -(1 << (prBits-1)));
+         finePr[c] = pr*prRes*RANGE_MS;
+      }
+
+      for(int c=0; c<ncell; c++)
+      {
+         int ph = getbits(msg, i, phBits);               i += phBits;
+         phOk[c] = (ph != -(1 << (phBits-1)));
+         finePh[c] = ph*phRes*RANGE_MS;
+      }
+
+      for(int c=0; c<ncell; c++)
+      {
+         if(isMsm7)
+         {
+            lockTime[c] = msm7LockTime(getbitu(msg, i, 10)); i += 10;
+         }
+         else
+         {
+            lockTime[c] = msm4LockTime(getbitu(msg, i, 4));  i += 4;
+         }
+      }
+
+      for(int c=0; c<ncell; c++)
+      {
+         half[c] = getbitu(msg, i, 1);                   i += 1;
+      }
+
+      for(int c=0; c<ncell; c++)
+      {
+         if(isMsm7)
+         {
+            cnr[c] = getbitu(msg, i, 10)*0.0625;         i += 10;
+         }
+         else
+         {
+            cnr[c] = getbitu(msg, i, 6);                 i += 6;
+         }
+      }
+
+      if(isMsm7)
+      {
+         for(int c=0; c<ncell; c++)
+         {
+            int rate = getbits(msg, i, 15);              i += 15;
+            rateOk[c] = (rate != -16384);
+            fineRate[c] = rate*0.0001;
+         }
+      }
+
+      numMsm++;
+
+      // the messages of a new epoch complete the previous one
+      int num(0);
+      CommonTime time = msmTime(sys, epochField);
+      if(hasCurrent && std::fabs(time - current.time) > 1.0e-4)
+      {
+         num += completeEpoch();
+      }
+
+      if(!hasCurrent)
+      {
+         current.time = time;
+         hasCurrent = true;
+      }
+
+      const char** sigTable;
+      switch(sys)
+      {
+         case SatelliteSystem::GLONASS: sigTable = msmSigGLO; break;
+         case SatelliteSystem::Galileo: sigTable = msmSigGAL; break;
+         case SatelliteSystem::SBAS:    sigTable = msmSigSBS; break;
+         case SatelliteSystem::QZSS:    sigTable = msmSigQZS; break;
+         case SatelliteSystem::BDS:     sigTable = msmSigBDS; break;
+         default:                       sigTable = msmSigGPS; break;
+      }
+
+      int c(0);
+      for(int j=0; j<nsat; j++)
+      {
+         // the SBAS satellites start from PRN 120, i.e. S20
+         SatID sat(sys, (sys == SatelliteSystem::SBAS) ? sats[j]+19 : sats[j]);
+         string sysChar(1, sat.systemChar());
+
+         // frequency number of the GLONASS satellite in MSM7
+         if(sys == SatelliteSystem::GLONASS && extInfo[j] <= 13)
+         {
+            header.glonassFreqNo[sat] = extInfo[j] - 7;
+         }
+
+         for(int k=0; k<nsig; k++)
+         {
+            if(!cellMask[j*nsig+k]) continue;
+
+            int cell = c++;
+
+            string code = sigTable[sigs[k]-1];
+            if(code.empty() || !roughOk[j]) continue;
+
+            // carrier band
+            int n = code[0] - '0';
+
+            double wavelength(0.0);
+            if(sys == SatelliteSystem::GLONASS && (n == 1 || n == 2))
+            {
+               Rx3ObsHeader::GLOFreqNumMap::iterator it
+                  = header.glonassFreqNo.find(sat);
+               if(it != header.glonassFreqNo.end())
+               {
+                  wavelength = getWavelength(sat, n, it->second);
+
+                  TypeID wlType = (n == 1) ? TypeID::wavelengthL1R
+                                           : TypeID::wavelengthL2R;
+                  current.stvData[sat][wlType] = wavelength;
+               }
+            }
+            else
+            {
+               wavelength = getWavelength(sat, n);
+            }
+
+            typeValueMap& typeObs = current.stvData[sat];
+            typeValueMap& typeLLI = current.stvDataLLI[sat];
+            typeValueMap& typeSSI = current.stvDataSSI[sat];
+
+            double ssi = ssiValue(cnr[cell]);
+
+            TypeID type;
+
+            // pseudorange
+            if(prOk[cell] && TypeID::tryParse("C"+code+sysChar, type))
+            {
+               typeObs[type] = rough[j] + finePr[cell];
+               typeLLI[type] = 0.0;
+               typeSSI[type] = ssi;
+               addType(sat, type);
+            }
+
+            // carrier phase in meters
+            if( phOk[cell] && wavelength != 0.0 &&
+                TypeID::tryParse("L"+code+sysChar, type) )
+            {
+               // lock time decreases or stays zero: loss of lock
+               typeValueMap& locks = lockTimes[sat];
+               typeValueMap::iterator it = locks.find(type);
+               double prevLock = (it != locks.end()) ? it->second : 0.0;
+               int slip = (lockTime[cell] < prevLock ||
+                           (lockTime[cell] == 0.0 && prevLock == 0.0)) ? 1 : 0;
+               locks[type] = lockTime[cell];
+
+               typeObs[type] = rough[j] + finePh[cell];
+               typeLLI[type] = slip + 2*half[cell];
+               typeSSI[type] = ssi;
+               addType(sat, type);
+            }
+
+            // doppler (Hz), only in MSM7
+            if( rateOk[cell] && roughRateOk[j] && wavelength != 0.0 &&
+                TypeID::tryParse("D"+code+sysChar, type) )
+            {
+               typeObs[type] = -(roughRate[j] + fineRate[cell])/wavelength;
+               typeLLI[type] = 0.0;
+               typeSSI[type] = ssi;
+               addType(sat, type);
+            }
+
+            // C/N0 (dB-Hz)
+            if(cnr[cell] > 0.0 && TypeID::tryParse("S"+code+sysChar, type))
+            {
+               typeObs[type] = cnr[cell];
+               typeLLI[type] = 0.0;
+               typeSSI[type] = ssi;
+               addType(sat, type);
+            }
+         }
+
+         // all the cells of the satellite are invalid
+         satTypeValueMap::iterator it = current.stvData.find(sat);
+         if(it != current.stvData.end() && current.satTypes[sat].empty())
+         {
+            current.stvData.erase(it);
+            current.stvDataLLI.erase(sat);
+            current.stvDataSSI.erase(sat);
+            current.satTypes.erase(sat);
+         }
+      }
+
+      // the last message of the epoch
+      if(!multiple)
+      {
+         num += completeEpoch();
+      }
+
+      return num;
+
+   }  // End of method 'Rtcm3ObsDecoder::decodeMsm()'
+
+
+   void Rtcm3ObsDecoder::decodeStation(const unsigned char* msg, int len)
+   {
+      int i = 12;
+      if(i+140 > len*8) return;
+
+      // station ID, ITRF year, GPS/GLONASS/Galileo/reference station
+      // indicators
+      i += 12+6+4;
+
+      double x = getbits38(msg, i)*0.0001;      i += 38+2;
+      double y = getbits38(msg, i)*0.0001;      i += 38+2;
+      double z = getbits38(msg, i)*0.0001;      i += 38;
+
+      header.antennaPosition = Triple(x, y, z);
+
+      // antenna height of 1006
+      if(getbitu(msg, 0, 12) == 1006 && i+16 <= len*8)
+      {
+         header.antennaDeltaHEN = Triple(getbitu(msg, i, 16)*0.0001, 0.0, 0.0);
+      }
+
+   }  // End of method 'Rtcm3ObsDecoder::decodeStation()'
+
+
+   CommonTime Rtcm3ObsDecoder::msmTime( SatelliteSystem::Systems sys,
+                                        uint32_t epochField ) const
+   {
+      CommonTime ref = getRefTime();
+
+      if(sys == SatelliteSystem::GLONASS)
+      {
+         // day of week (3 bits) and Moscow time of day (27 bits, UTC+3h),
+         // the day is taken from the reference time
+         double tod = (epochField & 0x7FFFFFF)*0.001 - 10800.0;
+
+         CommonTime refUTC = convertTimeSystem(ref, TimeSystem::UTC);
+         CivilTime refCivil(refUTC);
+         double refTod = refCivil.hour*3600.0 + refCivil.minute*60.0
+                       + refCivil.second;
+
+         if(tod < refTod-43200.0) tod += 86400.0;
+         else if(tod > refTod+43200.0) tod -= 86400.0;
+
+         CommonTime utc = refUTC;
+         utc += tod - refTod;
+
+         return convertTimeSystem(utc, TimeSystem::GPS);
+      }
+
+      // time of week, in BDT for BDS
+      double tow = epochField*0.001;
+      if(sys == SatelliteSystem::BDS)
+      {
+         tow += 14.0;
+         if(tow >= FULLWEEK) tow -= FULLWEEK;
+      }
+
+      GPSWeekSecond refWS(ref);
+      int week = refWS.week;
+      if(tow < refWS.sow - HALFWEEK) week++;
+      else if(tow > refWS.sow + HALFWEEK) week--;
+
+      CommonTime time = GPSWeekSecond(week, tow, TimeSystem::GPS).convertToCommonTime();
+      time.setTimeSystem(TimeSystem::GPS);
+
+      return time;
+
+   }  // End of method 'Rtcm3ObsDecoder::msmTime()'
+
+
+      // the epochs are resolved from the previous one, setRefTime() is
+      // only used for the first epoch: a fixed reference would give the
+      // wrong GLONASS day after 12 h, and the wrong week after 3.5 days
+   CommonTime Rtcm3ObsDecoder::getRefTime() const
+   {
+      if(hasCurrent)
+      {
+         return current.time;
+      }
+
+      if(hasLastTime)
+      {
+         return lastTime;
+      }
+
+      if(hasRefTime)
+      {
+         return convertTimeSystem(refTime, TimeSystem::GPS);
+      }
+
+      SystemTime now;
+      return convertTimeSystem(now.convertToCommonTime(), TimeSystem::GPS);
+   }
+
+
+   void Rtcm3ObsDecoder::addType(const SatID& sat, const TypeID& type)
+   {
+      TypeIDVec& types = current.satTypes[sat];
+      if(find(types.begin(), types.end(), type) == types.end())
+      {
+         types.push_back(type);
+      }
+
+      TypeIDVec& headerTypes = header.mapObsTypes[string(1, sat.systemChar())];
+      if(find(headerTypes.begin(), headerTypes.end(), type) == headerTypes.end())
+      {
+         headerTypes.push_back(type);
+      }
+   }
+
+
+   int Rtcm3ObsDecoder::completeEpoch()
+   {
+      hasCurrent = false;
+
+      // a message without observation
+      if(current.stvData.empty()) return 0;
+
+      if(!hasLastTime)
+      {
+         header.firstObs = CivilTime(current.time);
+      }
+
+      lastTime = current.time;
+      hasLastTime = true;
+
+      epochs.push_back(Epoch());
+      std::swap(epochs.back(), current);
+
+      return 1;
+
+   }  // End of method 'Rtcm3ObsDecoder::completeEpoch()'
+
+
+   int Rtcm3ObsDecoder::loadFile(std::string& file)
+      noexcept(false)
+   {
+      ifstream rtcmFile(file.c_str(), ios::in | ios::binary);
+      if(!rtcmFile)
+      {
+         FileMissingException e("Rtcm3ObsDecoder: can't open " + file);
+         THROW(e);
+      }
+
+      int num(0);
+      std::vector<char> buff(65536);
+      while(rtcmFile)
+      {
+         rtcmFile.read(&buff[0], buff.size());
+         std::streamsize n = rtcmFile.gcount();
+         if(n <= 0) break;
+
+         num += input(reinterpret_cast<const unsigned char*>(&buff[0]), n);
+      }
+
+      // the last epoch may end without the message closing it
+      num += flush();
+
+      return num;
+
+   }  // End of method 'Rtcm3ObsDecoder::loadFile()'
+
+
+   void Rtcm3ObsDecoder::openTcp(const std::string& host, int port)
+      noexcept(false)
+   {
+      closeTcp();
+
+      try
+      {
+         sockfd = Rtcm3Framer::connectTcp(host, port);
+      }
+      catch(InvalidRequest& e)
+      {
+         RETHROW(e);
+      }
+
+      // a new stream starts with a new frame
+      framer.clear();
+
+   }  // End of method 'Rtcm3ObsDecoder::openTcp()'
+
+
+   int Rtcm3ObsDecoder::readTcp()
+   {
+      if(sockfd < 0) return -1;
+
+      unsigned char buff[4096];
+      ssize_t n = read(sockfd, buff, sizeof(buff));
+      if(n <= 0)
+      {
+         closeTcp();
+         return -1;
+      }
+
+      return input(buff, n);
+   }
+
+
+   void Rtcm3ObsDecoder::closeTcp()
+   {
+      if(sockfd >= 0)
+      {
+         close(sockfd);
+         sockfd = -1;
+      }
+   }
+
+}  // End of namespace gnssSpace
@@ -0,0 +1,211 @@
+#pragma ident "$Id$"
+
+/**
+ * @file Rtcm3ObsDecoder.hpp
+ * Decode the RTCM 3 MSM observation messages into Rx3ObsData epochs.
+ *
+ * The MSM4 and MSM7 messages of all the systems are decoded:
+ *
+ *  \li 1074/1077  GPS
+ *  \li 1084/1087  GLONASS
+ *  \li 1094/1097  Galileo
+ *  \li 1104/1107  SBAS
+ *  \li 1114/1117  QZSS
+ *  \li 1124/1127  BDS
+ *
+ * The messages of one epoch are sent one system after the other, with the
+ * multiple message bit set except in the last one, so an epoch is complete
+ * when a message without this bit is decoded, or when a message of a new
+ * epoch arrives.
+ *
+ * The observations are stored as the text reader (Rx3ObsData::readRecord)
+ * does: the TypeIDs are the RINEX 3 codes with the system character, e.g.
+ * C1CG, L2IC, D7QE, S1CR; the carrier phases are in meters, and the
+ * GLONASS phases and Dopplers are only given if the frequency number of
+ * the satellite is known, from the extended information of MSM7 or from
+ * header.glonassFreqNo set by the user. The loss of lock (bit 0) and the
+ * half-cycle ambiguity (bit 1) are in stvDataLLI, the signal strength
+ * index 1-9 from the C/N0 is in stvDataSSI, and satTypes lists the types
+ * of each satellite.
+ *
+ * header holds the observation types seen so far (mapObsTypes), the
+ * GLONASS frequency numbers, the time of the first epoch, and the
+ * antenna position of the station from 1005/1006.
+ *
+ * The epoch times are in GPS time. MSM only gives the time of week (the
+ * time of day for GLONASS), the week is resolved with the previous epoch,
+ * and for the first epoch with the time given by setRefTime(), else the
+ * system time, so setRefTime() must be called for the recorded files.
+ *
+ * @code
+ *   Rtcm3ObsDecoder decoder;
+ *   decoder.openTcp("127.0.0.1", 2101);
+ *   Rx3ObsData obsData;
+ *   while(decoder.readTcp() >= 0)
+ *   {
+ *      while(decoder.getEpoch(obsData))
+ *      {
+ *         // process obsData, obsData.pHeader points to decoder.header
+ *      }
+ *   }
+ * @endcode
+ */
+
+#ifndef Rtcm3ObsDecoder_HPP
+#define Rtcm3ObsDecoder_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include "Exception.hpp"
+#include "CommonTime.hpp"
+#include "DataStructures.hpp"
+#include "Rx3ObsHeader.hpp"
+#include "Rx3ObsData.hpp"
+#include "Rtcm3Framer.hpp"
+
+using namespace utilSpace;
+using namespace timeSpace;
+
+namespace gnssSpace
+{
+
+   class Rtcm3ObsDecoder
+   {
+   public:
+
+      Rtcm3ObsDecoder();
+
+         /// Decode the RTCM 3 bytes of data, which may hold any part of
+         /// the frames; the incomplete frame at the end is kept for the
+         /// next call.
+         /// @return number of epochs completed
+      int input(const unsigned char* data, size_t n);
+
+         /// Complete the epoch being assembled, at the end of the stream
+         /// @return number of epochs completed (0 or 1)
+      int flush();
+
+         /// Take the oldest completed epoch. The observations are swapped
+         /// into obsData, and obsData.pHeader is set to &header.
+         /// @return false if no epoch is completed
+      bool getEpoch(Rx3ObsData& obsData);
+
+         /// Number of completed epochs not taken yet
+      size_t numEpochs() const
+      { return epochs.size(); };
+
+         /// Decode a binary RTCM 3 file, the epochs are kept for getEpoch()
+         /// @return number of epochs completed
+      int loadFile(std::string& file)
+         noexcept(false);
+
+         /// Connect to a TCP server sending RTCM 3, e.g. a local caster
+      void openTcp(const std::string& host, int port)
+         noexcept(false);
+
+         /// Wait for the next bytes of the TCP connection and decode them
+         /// @return number of epochs completed, -1 if the connection is
+         ///         closed
+      int readTcp();
+
+         /// Close the TCP connection
+      void closeTcp();
+
+         /// Reference time to resolve the week and the GLONASS day of
+         /// the first epoch, within 3.5 days (12 h for GLONASS)
+      void setRefTime(const CommonTime& time)
+      {
+         refTime = time;
+         hasRefTime = true;
+      };
+
+         /// frames with a valid CRC, frames with a wrong CRC, and MSM
+         /// messages decoded
+      unsigned long getNumFrames() const
+      { return framer.getNumFrames(); };
+
+      unsigned long getNumCrcErrors() const
+      { return framer.getNumCrcErrors(); };
+
+      unsigned long getNumMsm() const
+      { return numMsm; };
+
+         /// destructor
+      virtual ~Rtcm3ObsDecoder()
+      {
+         closeTcp();
+      };
+
+         /// Observation types, GLONASS frequency numbers, first epoch and
+         /// antenna position of the stream
+      Rx3ObsHeader header;
+
+   private:
+
+         /// observations of one epoch
+      struct Epoch
+      {
+         CommonTime time;
+         std::map<SatID, TypeIDVec> satTypes;
+         satTypeValueMap stvData;
+         satTypeValueMap stvDataLLI;
+         satTypeValueMap stvDataSSI;
+      };
+
+         /// Decode the message of a frame
+         /// @return number of epochs completed
+      int decodeFrame(const unsigned char* msg, int len);
+
+         /// Decode MSM4 (isMsm7 false) or MSM7 of the system
+      int decodeMsm(const unsigned char* msg, int len,
+                    SatelliteSystem::Systems sys, bool isMsm7);
+
+         /// Decode the antenna position of 1005/1006
+      void decodeStation(const unsigned char* msg, int len);
+
+         /// GPS time of the epoch field of a MSM header
+      CommonTime msmTime(SatelliteSystem::Systems sys, uint32_t epochField) const;
+
+         /// reference time in GPS time
+      CommonTime getRefTime() const;
+
+         /// add the type into satTypes and into the header
+      void addType(const SatID& sat, const TypeID& type);
+
+         /// move the epoch being assembled into the queue
+      int completeEpoch();
+
+      CommonTime refTime;
+      bool hasRefTime;
+
+         /// epoch being assembled
+      Epoch current;
+      bool hasCurrent;
+
+         /// completed epochs, the oldest first
+      std::deque<Epoch> epochs;
+
+         /// latest completed epoch, the reference for the next ones
+      CommonTime lastTime;
+      bool hasLastTime;
+
+         /// lock time (ms) of each phase in the previous message, to find
+         /// the cycle slips
+      satTypeValueMap lockTimes;
+
+         /// frames of the stream
+      Rtcm3Framer framer;
+
+         /// socket of the TCP connection, -1 if closed
+      int sockfd;
+
+      unsigned long numMsm;
+
+   }; // End of class 'Rtcm3ObsDecoder'
+
+}  // End of namespace gnssSpace
+
+#endif   // Rtcm3ObsDecoder_HPP
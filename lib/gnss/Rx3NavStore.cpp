@@ -5,7 +5,12 @@
 //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <thread>
+#include <atomic>
+#include <exception>
+
 #include "Rx3NavStore.hpp"
+#include "SnapshotRecords.hpp"
 
 using namespace std;
 using namespace gnssSpace;
@@ -31,6 +36,11 @@ namespace gnssSpace
     //R2.11
     const string Rx3NavStore::stringIonBeta     = "ION BETA";
     const string Rx3NavStore::stringEoH         = "END OF HEADER";
+
+    const double Rx3NavStore::validGPSEph = 7200.0;
+    const double Rx3NavStore::validBDSEph = 7200.0;
+    const double Rx3NavStore::validGalEph = 7200.0;
+    const double Rx3NavStore::validGloEph = 1800.0;
     
     
     void Rx3NavStore::loadGPSEph(GPSEphemeris& gpsEph, string& line, fstream& navFileStream)
@@ -183,6 +193,8 @@ namespace gnssSpace
         gpsEph.ctToc = GPSWeekSecond(week, gpsEph.Toc, TimeSystem::GPS).convertToCommonTime();
         gpsEph.ctToc.setTimeSystem(TimeSystem::GPS);
 
+        gpsEph.setOrbitConstants();
+
         gpsEphData[sat][gpsEph.ctToe] = gpsEph;
     }
 
@@ -371,6 +383,8 @@ namespace gnssSpace
         bdsws.adjustToYear(bdsEph.CivilToc.year);
         bdsEph.ctToc = CommonTime(bdsws.convertToCommonTime());
 
+        bdsEph.setOrbitConstants();
+
         bdsEphData[sat][bdsEph.ctToe] = bdsEph;
     }
 
@@ -507,6 +521,8 @@ namespace gnssSpace
         galEph.ctToc = gpstoc;
         galEph.ctToc.setTimeSystem(TimeSystem::GAL);
 
+        galEph.setOrbitConstants();
+
         galEphData[sat][galEph.ctToe] = galEph;
     }
 
@@ -738,6 +754,504 @@ namespace gnssSpace
        }
    }
 
+   void Rx3NavStore::loadFiles(const std::vector<std::string>& files,
+                               int numThreads)
+      noexcept(false)
+   {
+       if(files.empty()) return;
+
+       if(numThreads <= 0)
+       {
+           numThreads = std::thread::hardware_concurrency();
+           if(numThreads <= 0) numThreads = 1;
+       }
+       if(numThreads > (int)files.size())
+       {
+           numThreads = files.size();
+       }
+
+       // one staging store per file, so that the merge follows the
+       // order of the files whatever the order the workers finish in
+       std::vector< std::unique_ptr<Rx3NavStore> > staging(files.size());
+       std::vector<std::exception_ptr> errors(files.size());
+
+       // the files differ in size, so the workers take the next file
+       // when done instead of a fixed share
+       std::atomic<size_t> nextFile(0);
+
+       auto worker = [&]()
+       {
+           size_t i;
+           while( (i = nextFile.fetch_add(1)) < files.size() )
+           {
+               try
+               {
+                   std::unique_ptr<Rx3NavStore> pStore(new Rx3NavStore);
+                   string file(files[i]);
+                   pStore->loadFile(file);
+                   staging[i] = std::move(pStore);
+               }
+               catch(...)
+               {
+                   // rethrown below, in the calling thread
+                   errors[i] = std::current_exception();
+               }
+           }
+       };
+
+       std::vector<std::thread> threads;
+       for(int k=1; k<numThreads; k++)
+       {
+           threads.push_back(std::thread(worker));
+       }
+       worker();
+
+       for(size_t k=0; k<threads.size(); k++)
+       {
+           threads[k].join();
+       }
+
+       for(size_t i=0; i<files.size(); i++)
+       {
+           if(errors[i])
+           {
+               std::rethrow_exception(errors[i]);
+           }
+       }
+
+       for(size_t i=0; i<files.size(); i++)
+       {
+           if(debug)
+               cout << "Rx3NavStore: merge " << files[i] << endl;
+
+           merge(*staging[i]);
+           staging[i].reset();
+       }
+   }
+
+   void Rx3NavStore::merge(const Rx3NavStore& store)
+   {
+       rx3NavFile  = store.rx3NavFile;
+       version     = store.version;
+       fileType    = store.fileType;
+       fileSys     = store.fileSys;
+       fileProgram = store.fileProgram;
+       fileAgency  = store.fileAgency;
+       date        = store.date;
+
+       commentList.insert(commentList.end(),
+                          store.commentList.begin(),
+                          store.commentList.end());
+
+       for(ionoCorrMap::const_iterator it = store.ionoCorrData.begin();
+           it != store.ionoCorrData.end(); ++it)
+       {
+           ionoCorrData[it->first] = it->second;
+       }
+
+       for(timeSysCorrMap::const_iterator it = store.timeSysCorrData.begin();
+           it != store.timeSysCorrData.end(); ++it)
+       {
+           timeSysCorrData[it->first] = it->second;
+       }
+
+       if(store.leapSeconds != 0)
+       {
+           leapSeconds = store.leapSeconds;
+           leapDelta   = store.leapDelta;
+           leapWeek    = store.leapWeek;
+           leapDay     = store.leapDay;
+       }
+
+       for(size_t i=0; i<store.satTable.size(); i++)
+       {
+           if( find(satTable.begin(), satTable.end(), store.satTable[i])
+               == satTable.end() )
+           {
+               satTable.push_back(store.satTable[i]);
+           }
+       }
+
+       mergeEphData(gpsEphData, store.gpsEphData);
+       mergeEphData(bdsEphData, store.bdsEphData);
+       mergeEphData(galEphData, store.galEphData);
+       mergeEphData(gloEphData, store.gloEphData);
+   }
+
+
+   namespace
+   {
+      /// fields of the Keplerian ephemerides shared by GPS, BDS and Galileo
+      template <class EphType>
+      void putKepler(BinarySnapshotWriter& w, const EphType& eph)
+      {
+         putCivilTime(w, eph.CivilToc);
+         w.putDouble(eph.Toc);
+         w.putDouble(eph.af0);
+         w.putDouble(eph.af1);
+         w.putDouble(eph.af2);
+         w.putDouble(eph.IODE);
+         w.putDouble(eph.Crs);
+         w.putDouble(eph.Delta_n);
+         w.putDouble(eph.M0);
+         w.putDouble(eph.Cuc);
+         w.putDouble(eph.ecc);
+         w.putDouble(eph.Cus);
+         w.putDouble(eph.sqrt_A);
+         w.putDouble(eph.Toe);
+         w.putDouble(eph.Cic);
+         w.putDouble(eph.OMEGA_0);
+         w.putDouble(eph.Cis);
+         w.putDouble(eph.i0);
+         w.putDouble(eph.Crc);
+         w.putDouble(eph.omega);
+         w.putDouble(eph.OMEGA_DOT);
+         w.putDouble(eph.IDOT);
+         w.putDouble(eph.URA);
+         w.putDouble(eph.SV_health);
+         w.putInt(eph.HOWtime);
+         putTime(w, eph.ctToc);
+         putTime(w, eph.ctToe);
+         putTime(w, eph.transmitTime);
+         putTime(w, eph.beginValid);
+         putTime(w, eph.endValid);
+      }
+
+      template <class EphType>
+      void getKepler(BinarySnapshotReader& r, EphType& eph)
+      {
+         eph.CivilToc = getCivilTime(r);
+         eph.Toc = r.getDouble();
+         eph.af0 = r.getDouble();
+         eph.af1 = r.getDouble();
+         eph.af2 = r.getDouble();
+         eph.IODE = r.getDouble();
+         eph.Crs = r.getDouble();
+         eph.Delta_n = r.getDouble();
+         eph.M0 = r.getDouble();
+         eph.Cuc = r.getDouble();
+         eph.ecc = r.getDouble();
+         eph.Cus = r.getDouble();
+         eph.sqrt_A = r.getDouble();
+         eph.Toe = r.getDouble();
+         eph.Cic = r.getDouble();
+         eph.OMEGA_0 = r.getDouble();
+         eph.Cis = r.getDouble();
+         eph.i0 = r.getDouble();
+         eph.Crc = r.getDouble();
+         eph.omega = r.getDouble();
+         eph.OMEGA_DOT = r.getDouble();
+         eph.IDOT = r.getDouble();
+         eph.URA = r.getDouble();
+         eph.SV_health = r.getDouble();
+         eph.HOWtime = r.getInt();
+         eph.ctToc = getTime(r);
+         eph.ctToe = getTime(r);
+         eph.transmitTime = getTime(r);
+         eph.beginValid = getTime(r);
+         eph.endValid = getTime(r);
+      }
+
+      void putEph(BinarySnapshotWriter& w, const GPSEphemeris& eph)
+      {
+         putSat(w, eph.satID);
+         putKepler(w, eph);
+         w.putDouble(eph.L2Codes);
+         w.putDouble(eph.GPSWeek);
+         w.putDouble(eph.L2Pflag);
+         w.putDouble(eph.TGD);
+         w.putDouble(eph.IODC);
+         w.putDouble(eph.fitInterval);
+      }
+
+      void getEph(BinarySnapshotReader& r, GPSEphemeris& eph)
+      {
+         eph.satID = getSat(r);
+         getKepler(r, eph);
+         eph.L2Codes = r.getDouble();
+         eph.GPSWeek = r.getDouble();
+         eph.L2Pflag = r.getDouble();
+         eph.TGD = r.getDouble();
+         eph.IODC = r.getDouble();
+         eph.fitInterval = r.getDouble();
+         eph.setOrbitConstants();
+      }
+
+      void putEph(BinarySnapshotWriter& w, const BDSEphemeris& eph)
+      {
+         putKepler(w, eph);
+         w.putDouble(eph.BDSWeek);
+         w.putDouble(eph.TGD1);
+         w.putDouble(eph.TGD2);
+         w.putDouble(eph.IODC);
+      }
+
+      void getEph(BinarySnapshotReader& r, BDSEphemeris& eph)
+      {
+         getKepler(r, eph);
+         eph.BDSWeek = r.getDouble();
+         eph.TGD1 = r.getDouble();
+         eph.TGD2 = r.getDouble();
+         eph.IODC = r.getDouble();
+         eph.setOrbitConstants();
+      }
+
+      void putEph(BinarySnapshotWriter& w, const GalEphemeris& eph)
+      {
+         putSat(w, eph.satID);
+         putKepler(w, eph);
+         w.putDouble(eph.dataSource);
+         w.putDouble(eph.GALWeek);
+         w.putDouble(eph.TGD1);
+         w.putDouble(eph.TGD2);
+      }
+
+      void getEph(BinarySnapshotReader& r, GalEphemeris& eph)
+      {
+         eph.satID = getSat(r);
+         getKepler(r, eph);
+         eph.dataSource = r.getDouble();
+         eph.GALWeek = r.getDouble();
+         eph.TGD1 = r.getDouble();
+         eph.TGD2 = r.getDouble();
+         eph.setOrbitConstants();
+      }
+
+      void putEph(BinarySnapshotWriter& w, const GloEphemeris& eph)
+      {
+         putSat(w, eph.satID);
+         putCivilTime(w, eph.CivilToc);
+         putTime(w, eph.ctToe);
+         w.putDouble(eph.Toc);
+         w.putDouble(eph.TauN);
+         w.putDouble(eph.GammaN);
+         w.putDouble(eph.MFtime);
+         w.putDouble(eph.px);
+         w.putDouble(eph.vx);
+         w.putDouble(eph.ax);
+         w.putDouble(eph.health);
+         w.putDouble(eph.py);
+         w.putDouble(eph.vy);
+         w.putDouble(eph.ay);
+         w.putDouble(eph.freqNum);
+         w.putDouble(eph.pz);
+         w.putDouble(eph.vz);
+         w.putDouble(eph.az);
+         w.putDouble(eph.ageOfInfo);
+         w.putDouble(eph.step);
+         w.putDouble(eph.nodeInterval);
+         w.putDouble(eph.maxNodeSpan);
+      }
+
+      void getEph(BinarySnapshotReader& r, GloEphemeris& eph)
+      {
+         eph.satID = getSat(r);
+         eph.CivilToc = getCivilTime(r);
+         eph.ctToe = getTime(r);
+         eph.Toc = r.getDouble();
+         eph.TauN = r.getDouble();
+         eph.GammaN = r.getDouble();
+         eph.MFtime = r.getDouble();
+         eph.px = r.getDouble();
+         eph.vx = r.getDouble();
+         eph.ax = r.getDouble();
+         eph.health = r.getDouble();
+         eph.py = r.getDouble();
+         eph.vy = r.getDouble();
+         eph.ay = r.getDouble();
+         eph.freqNum = r.getDouble();
+         eph.pz = r.getDouble();
+         eph.vz = r.getDouble();
+         eph.az = r.getDouble();
+         eph.ageOfInfo = r.getDouble();
+         eph.step = r.getDouble();
+         eph.nodeInterval = r.getDouble();
+         eph.maxNodeSpan = r.getDouble();
+      }
+
+      /// one section per system, with for each satellite the number of
+      /// ephemerides, then their reference times and ephemerides
+      template <class EphType>
+      void putEphData(BinarySnapshotWriter& w, const std::string& tag,
+                      const map<SatID, std::map<CommonTime, EphType>>& ephData)
+      {
+         w.beginSection(tag, ephData.size());
+
+         for(typename map<SatID, std::map<CommonTime, EphType>>::const_iterator
+                itSat = ephData.begin(); itSat != ephData.end(); ++itSat)
+         {
+            putSat(w, itSat->first);
+            w.putInt(itSat->second.size());
+
+            for(typename std::map<CommonTime, EphType>::const_iterator
+                   it = itSat->second.begin(); it != itSat->second.end(); ++it)
+            {
+               putTime(w, it->first);
+               putEph(w, it->second);
+            }
+         }
+      }
+
+      template <class EphType>
+      void getEphData(BinarySnapshotReader& r, const std::string& tag,
+                      map<SatID, std::map<CommonTime, EphType>>& ephData)
+      {
+         uint64_t numSats = r.beginSection(tag);
+
+         EphType eph;
+         for(uint64_t i=0; i<numSats; i++)
+         {
+            SatID sat = getSat(r);
+            int64_t num = r.getInt();
+
+            std::map<CommonTime, EphType>& ephMap = ephData[sat];
+            for(int64_t k=0; k<num; k++)
+            {
+               CommonTime t = getTime(r);
+               getEph(r, eph);
+
+               // an ephemeris already loaded is replaced, as loadFile() does
+               ephMap[t] = eph;
+            }
+         }
+      }
+
+   }  // End of anonymous namespace
+
+
+   void Rx3NavStore::saveSnapshot(const std::string& file) const
+      noexcept(false)
+   {
+      BinarySnapshotWriter w("Rx3NavStore");
+
+      w.beginSection("HEADER", 1);
+      w.putString(rx3NavFile);
+      w.putDouble(version);
+      w.putString(fileType);
+      w.putString(fileSys);
+      w.putString(fileProgram);
+      w.putString(fileAgency);
+      w.putString(date);
+      w.putInt(leapSeconds);
+      w.putInt(leapDelta);
+      w.putInt(leapWeek);
+      w.putInt(leapDay);
+
+      w.beginSection("COMMENT", commentList.size());
+      for(size_t i=0; i<commentList.size(); i++)
+      {
+         w.putString(commentList[i]);
+      }
+
+      w.beginSection("IONOCORR", ionoCorrData.size());
+      for(ionoCorrMap::const_iterator it = ionoCorrData.begin();
+          it != ionoCorrData.end(); ++it)
+      {
+         w.putString(it->first);
+         w.putInt(it->second.size());
+         for(size_t k=0; k<it->second.size(); k++)
+         {
+            w.putDouble(it->second[k]);
+         }
+      }
+
+      w.beginSection("TIMECORR", timeSysCorrData.size());
+      for(timeSysCorrMap::const_iterator it = timeSysCorrData.begin();
+          it != timeSysCorrData.end(); ++it)
+      {
+         w.putString(it->first);
+         w.putDouble(it->second.A0);
+         w.putDouble(it->second.A1);
+         w.putInt(it->second.refSOW);
+         w.putInt(it->second.refWeek);
+         w.putString(it->second.geoProvider);
+         w.putInt(it->second.geoUTCid);
+      }
+
+      w.beginSection("SATTABLE", satTable.size());
+      for(size_t i=0; i<satTable.size(); i++)
+      {
+         putSat(w, satTable[i]);
+      }
+
+      putEphData(w, "GPSEPH", gpsEphData);
+      putEphData(w, "BDSEPH", bdsEphData);
+      putEphData(w, "GALEPH", galEphData);
+      putEphData(w, "GLOEPH", gloEphData);
+
+      w.save(file);
+
+   }  // End of method 'Rx3NavStore::saveSnapshot()'
+
+
+   void Rx3NavStore::loadSnapshot(const std::string& file)
+      noexcept(false)
+   {
+      BinarySnapshotReader r(file, "Rx3NavStore");
+
+      r.beginSection("HEADER");
+      rx3NavFile  = r.getString();
+      version     = r.getDouble();
+      fileType    = r.getString();
+      fileSys     = r.getString();
+      fileProgram = r.getString();
+      fileAgency  = r.getString();
+      date        = r.getString();
+      leapSeconds = r.getInt();
+      leapDelta   = r.getInt();
+      leapWeek    = r.getInt();
+      leapDay     = r.getInt();
+
+      uint64_t num = r.beginSection("COMMENT");
+      for(uint64_t i=0; i<num; i++)
+      {
+         commentList.push_back(r.getString());
+      }
+
+      num = r.beginSection("IONOCORR");
+      for(uint64_t i=0; i<num; i++)
+      {
+         string type = r.getString();
+         vector<double> coeff(r.getInt());
+         for(size_t k=0; k<coeff.size(); k++)
+         {
+            coeff[k] = r.getDouble();
+         }
+         ionoCorrData[type] = coeff;
+      }
+
+      num = r.beginSection("TIMECORR");
+      for(uint64_t i=0; i<num; i++)
+      {
+         string type = r.getString();
+         TimeSysCorr corr;
+         corr.A0 = r.getDouble();
+         corr.A1 = r.getDouble();
+         corr.refSOW = r.getInt();
+         corr.refWeek = r.getInt();
+         corr.geoProvider = r.getString();
+         corr.geoUTCid = r.getInt();
+         timeSysCorrData[type] = corr;
+      }
+
+      num = r.beginSection("SATTABLE");
+      for(uint64_t i=0; i<num; i++)
+      {
+         SatID sat = getSat(r);
+         if(find(satTable.begin(), satTable.end(), sat) == satTable.end())
+         {
+            satTable.push_back(sat);
+         }
+      }
+
+      getEphData(r, "GPSEPH", gpsEphData);
+      getEphData(r, "BDSEPH", bdsEphData);
+      getEphData(r, "GALEPH", galEphData);
+      getEphData(r, "GLOEPH", gloEphData);
+
+   }  // End of method 'Rx3NavStore::loadSnapshot()'
+
+
    void Rx3NavStore::showEphNum()
    {
        int count(0);
@@ -769,6 +1283,7 @@ namespace gnssSpace
    }
 
    Xvt Rx3NavStore::getXvt(const SatID& sat, const CommonTime& epoch) 
+      noexcept(false)
    {
       Xvt xvt;
       CommonTime realEpoch;
@@ -777,88 +1292,153 @@ namespace gnssSpace
       {
           ts = TimeSystem::GPS;
           realEpoch = convertTimeSystem(epoch, ts);
-          GPSEphemeris gpsEph = findGPSEphemeris(sat, realEpoch);
-          xvt = gpsEph.svXvt(realEpoch);
+          const GPSEphemeris* pEph = findGPSEphemeris(sat, realEpoch);
+          if(pEph != NULL)
+          {
+              return pEph->svXvt(realEpoch);
+          }
       }
       else if(sat.system == SatelliteSystem::BDS)
       {
           ts = TimeSystem::BDT;
           realEpoch = convertTimeSystem(epoch, ts);
-          BDSEphemeris bdsEph = findBDSEphemeris(sat, realEpoch);
-          xvt = bdsEph.svXvt(sat, realEpoch);
+          const BDSEphemeris* pEph = findBDSEphemeris(sat, realEpoch);
+          if(pEph != NULL)
+          {
+              return pEph->svXvt(sat, realEpoch);
+          }
       }
       else if(sat.system == SatelliteSystem::Galileo)
       {
           ts = TimeSystem::GAL;
           realEpoch = convertTimeSystem(epoch, ts);
-          GalEphemeris galEph = findGalEphemeris(sat, realEpoch);
-          xvt = galEph.svXvt(realEpoch);
+          const GalEphemeris* pEph = findGalEphemeris(sat, realEpoch);
+          if(pEph != NULL)
+          {
+              return pEph->svXvt(realEpoch);
+          }
       }
       else if(sat.system == SatelliteSystem::GLONASS)
       {
           ts = TimeSystem::GLO;
           realEpoch = convertTimeSystem(epoch, ts);
-          GloEphemeris gloEph = findGloEphemeris(sat, realEpoch);
-          xvt = gloEph.svXvt(realEpoch);
+          const GloEphemeris* pEph = findGloEphemeris(sat, realEpoch);
+          if(pEph != NULL)
+          {
+              return pEph->svXvt(realEpoch);
+          }
       }
 
+      InvalidRequest e("Rx3NavStore: no valid ephemeris for " + sat.toString()
+                       + " at " + epoch.asString());
+      THROW(e);
+
       return xvt;
    };
 
-    GPSEphemeris Rx3NavStore::findGPSEphemeris(const SatID& sat , const CommonTime& epoch)
+   int Rx3NavStore::getXvtBatch(const std::vector<SatID>& sats,
+                                const std::vector<CommonTime>& times,
+                                std::vector<Xvt>& xvts,
+                                std::vector<char>& valid)
+   {
+      xvts.resize(sats.size());
+      valid.assign(sats.size(), 0);
+
+      // batch of the Keplerian orbits, and the index in the request of
+      // each satellite of the batch
+      KeplerBatch keplerBatch;
+      std::vector<size_t> batchIndex;
+
+      int num(0);
+      for(size_t i=0; i<sats.size(); i++)
+      {
+          const SatID& sat = sats[i];
+
+          if(sat.system == SatelliteSystem::GPS)
+          {
+              CommonTime realEpoch = convertTimeSystem(times[i], TimeSystem::GPS);
+              const GPSEphemeris* pEph = findGPSEphemeris(sat, realEpoch);
+              if(pEph == NULL) continue;
+
+              addToBatch(keplerBatch, batchIndex,
+                         *pEph, realEpoch, i, xvts[i]);
+          }
+          else if(sat.system == SatelliteSystem::Galileo)
+          {
+              CommonTime realEpoch = convertTimeSystem(times[i], TimeSystem::GAL);
+              const GalEphemeris* pEph = findGalEphemeris(sat, realEpoch);
+              if(pEph == NULL) continue;
+
+              addToBatch(keplerBatch, batchIndex,
+                         *pEph, realEpoch, i, xvts[i]);
+          }
+          else if( sat.system == SatelliteSystem::BDS &&
+                   !(sat.id<=5 || sat.id>=59) )
+          {
+              CommonTime realEpoch = convertTimeSystem(times[i], TimeSystem::BDT);
+              const BDSEphemeris* pEph = findBDSEphemeris(sat, realEpoch);
+              if(pEph == NULL) continue;
+
+              addToBatch(keplerBatch, batchIndex,
+                         *pEph, realEpoch, i, xvts[i]);
+          }
+          else
+          {
+              // BDS GEO and GLONASS, one by one
+              try
+              {
+                  xvts[i] = getXvt(sat, times[i]);
+              }
+              catch(InvalidRequest& e)
+              {
+                  continue;
+              }
+          }
+
+          valid[i] = 1;
+          num++;
+      }
+
+      keplerBatch.compute();
+
+      for(size_t k=0; k<batchIndex.size(); k++)
+      {
+          Xvt& xvt = xvts[batchIndex[k]];
+          xvt.x[0] = keplerBatch.x[k];
+          xvt.x[1] = keplerBatch.y[k];
+          xvt.x[2] = keplerBatch.z[k];
+          xvt.v[0] = keplerBatch.vx[k];
+          xvt.v[1] = keplerBatch.vy[k];
+          xvt.v[2] = keplerBatch.vz[k];
+          xvt.relcorr = keplerBatch.relcorr[k];
+      }
+
+      return num;
+
+   }  // End of method 'Rx3NavStore::getXvtBatch()'
+
+    const GPSEphemeris* Rx3NavStore::findGPSEphemeris(const SatID& sat, 
+                                                      const CommonTime& epoch) const
     {
-        GPSWeekSecond targetWS(epoch);
-        for(auto it:gpsEphData[sat])
-        {
-            GPSWeekSecond ws(it.first);
-            double diff = ws.sow - targetWS.sow;
-            if( diff > -7200 && diff <7200)
-            {
-                return it.second;
-            }
-        }
+        return findNearest(gpsEphData, sat, epoch, validGPSEph);
     }
 
-    BDSEphemeris Rx3NavStore::findBDSEphemeris(const SatID& sat , const CommonTime& epoch)
+    const BDSEphemeris* Rx3NavStore::findBDSEphemeris(const SatID& sat, 
+                                                      const CommonTime& epoch) const
     {
-        GPSWeekSecond targetWS(epoch);
-        for(auto it:bdsEphData[sat])
-        {
-            GPSWeekSecond ws(it.first);
-            double diff = ws.sow - targetWS.sow;
-            if( diff > -7200 && diff <7200)
-            {
-                return it.second;
-            }
-        }
+        return findNearest(bdsEphData, sat, epoch, validBDSEph);
     }
 
-    GalEphemeris Rx3NavStore::findGalEphemeris(const SatID& sat , const CommonTime& epoch)
+    const GalEphemeris* Rx3NavStore::findGalEphemeris(const SatID& sat, 
+                                                      const CommonTime& epoch) const
     {
-        GPSWeekSecond targetWS(epoch);
-        for(auto it:galEphData[sat])
-        {
-            GPSWeekSecond ws(it.first);
-            double diff = ws.sow - targetWS.sow;
-            if( diff > -7200 && diff <7200)
-            {
-                return it.second;
-            }
-        }
+        return findNearest(galEphData, sat, epoch, validGalEph);
     }
 
-    GloEphemeris Rx3NavStore::findGloEphemeris(const SatID& sat , const CommonTime& epoch)
+    const GloEphemeris* Rx3NavStore::findGloEphemeris(const SatID& sat, 
+                                                      const CommonTime& epoch) const
     {
-        GPSWeekSecond targetWS(epoch);
-        for(auto it:gloEphData[sat])
-        {
-            GPSWeekSecond ws(it.first);
-            double diff = ws.sow - targetWS.sow;
-            if( diff > -1800 && diff <1800)
-            {
-                return it.second;
-            }
-        }
+        return findNearest(gloEphData, sat, epoch, validGloEph);
     }
 
 }  // namespace gnssSpace
@@ -23,6 +23,8 @@
 #include <map>
 #include <algorithm>
 #include <fstream>
+#include <vector>
+#include <memory>
 
 #include "Exception.hpp"
 #include "StringUtils.hpp"
@@ -34,6 +36,7 @@
 #include "BDSEphemeris.hpp"
 #include "GalEphemeris.hpp"
 #include "GloEphemeris.hpp"
+#include "KeplerOrbit.hpp"
 #include "GPSWeekSecond.hpp"
 #include "BDSWeekSecond.hpp"
 
@@ -51,9 +54,13 @@ namespace gnssSpace
    public:
 
       Rx3NavStore()
+         : version(0.0), leapSeconds(0), leapDelta(0), leapWeek(0), leapDay(0),
+           numDuplicates(0), numReplaced(0)
       {};
 
       Rx3NavStore(const std::string& navFile )
+         : version(0.0), leapSeconds(0), leapDelta(0), leapWeek(0), leapDay(0),
+           numDuplicates(0), numReplaced(0)
       {
          rx3NavFile = navFile;
       };
@@ -66,14 +73,126 @@ namespace gnssSpace
 
       void loadFile(string& file);
 
+      /// Load several navigation files, e.g. the daily files of a
+      /// reprocessing campaign. Each file is parsed by a worker thread into
+      /// its own staging store, then the stores are merged in the order of
+      /// the files, so the result is the same as calling loadFile() for
+      /// each file in turn.
+      /// @param numThreads  number of worker threads, 0 for the number of
+      ///                    cores
+      /// @throw the first error of the files, in the order of the files
+      void loadFiles(const std::vector<std::string>& files,
+                     int numThreads = 0)
+         noexcept(false);
+
+      /// Add the ephemerides and the header records of store. An ephemeris
+      /// with the same reference time as a stored one replaces it, unless
+      /// both are identical (same IODE and toe, or same state for GLONASS),
+      /// in which case it is counted as a duplicate.
+      void merge(const Rx3NavStore& store);
+
+      /// Save the ephemerides and the header records to a binary snapshot
+      /// (BinarySnapshot.hpp), which loadSnapshot() reads back without
+      /// parsing the RINEX files again.
+      /// @throw FileMissingException if the file can't be written
+      void saveSnapshot(const std::string& file) const
+         noexcept(false);
+
+      /// Load a snapshot written by saveSnapshot(), as loadFile() does
+      /// for a RINEX file
+      /// @throw FFStreamError if the file is not a valid snapshot
+      void loadSnapshot(const std::string& file)
+         noexcept(false);
+
+      /// Identical ephemerides skipped by merge()
+      size_t getNumDuplicates() const
+      { return numDuplicates; };
+
+      /// Ephemerides replaced by merge() by another one with the same
+      /// reference time
+      size_t getNumReplaced() const
+      { return numReplaced; };
+
       void showEphNum();
 
-      Xvt getXvt(const SatID& sat, const CommonTime& epoch) ;
+      /// Returns the position, velocity and clock of the satellite.
+      /// @throw InvalidRequest if no valid ephemeris is found
+      Xvt getXvt(const SatID& sat, const CommonTime& epoch)
+         noexcept(false);
+
+      /// Xvt of several satellites at their own times. The GPS, Galileo
+      /// and BDS MEO/IGSO orbits are evaluated together in a KeplerBatch,
+      /// the BDS GEO and GLONASS ones with getXvt(). The batch is local
+      /// to the call, so several threads may call it on the same store.
+      virtual int getXvtBatch(const std::vector<SatID>& sats,
+                              const std::vector<CommonTime>& times,
+                              std::vector<Xvt>& xvts,
+                              std::vector<char>& valid);
+
+      /// Find the ephemeris of the satellite nearest to epoch, among the
+      /// ones whose reference time is within the validity interval
+      /// (validGPSEph etc.). The epoch must be in the time system of the
+      /// satellite system.
+      /// @return pointer to the stored ephemeris, NULL if none is valid
+      const GPSEphemeris* findGPSEphemeris(const SatID& sat, const CommonTime& epoch) const;
+      const BDSEphemeris* findBDSEphemeris(const SatID& sat, const CommonTime& epoch) const;
+      const GalEphemeris* findGalEphemeris(const SatID& sat, const CommonTime& epoch) const;
+      const GloEphemeris* findGloEphemeris(const SatID& sat, const CommonTime& epoch) const;
+
+      /// validity interval of the ephemerides, in seconds
+      static const double validGPSEph;
+      static const double validBDSEph;
+      static const double validGalEph;
+      static const double validGloEph;
+
+      /// Binary search of the ephemeris nearest to epoch in the map of
+      /// one satellite. The keys are full CommonTime, so the week rollover
+      /// is handled by the comparison itself.
+      /// @return NULL if no ephemeris is within validity (s)
+      template <class EphType>
+      static const EphType* nearestEphemeris(
+         const std::map<CommonTime, EphType>& ephMap,
+         const CommonTime& epoch,
+         double validity )
+      {
+         if(ephMap.empty())
+         {
+            return NULL;
+         }
+
+         // first ephemeris at or after epoch, and the one before it
+         typename std::map<CommonTime, EphType>::const_iterator
+            itAfter = ephMap.lower_bound(epoch);
+
+         const EphType* pEph(NULL);
+         double minDiff(validity);
+
+         if(itAfter != ephMap.end())
+         {
+            double diff = itAfter->first - epoch;
+            if(diff < minDiff)
+            {
+               minDiff = diff;
+               pEph = &itAfter->second;
+            }
+         }
 
-      GPSEphemeris findGPSEphemeris(const SatID& sat, const CommonTime& epoch);
-      BDSEphemeris findBDSEphemeris(const SatID& sat, const CommonTime& epoch);
-      GalEphemeris findGalEphemeris(const SatID& sat, const CommonTime& epoch);
-      GloEphemeris findGloEphemeris(const SatID& sat, const CommonTime& epoch);
+         if(itAfter != ephMap.begin())
+         {
+            typename std::map<CommonTime, EphType>::const_iterator
+               itBefore = itAfter;
+            --itBefore;
+
+            double diff = epoch - itBefore->first;
+            if(diff < minDiff)
+            {
+               pEph = &itBefore->second;
+            }
+         }
+
+         return pEph;
+
+      }  // End of method 'Rx3NavStore::nearestEphemeris()'
 
 
 
@@ -165,6 +284,106 @@ namespace gnssSpace
       /// destructor
       virtual ~Rx3NavStore()
       {};
+
+   private:
+
+      /// statistics of merge()
+      size_t numDuplicates;
+      size_t numReplaced;
+
+      /// Same issue of the broadcast ephemeris
+      static bool sameEphemeris(const GPSEphemeris& a, const GPSEphemeris& b)
+      { return a.IODE == b.IODE && a.Toe == b.Toe; };
+
+      static bool sameEphemeris(const BDSEphemeris& a, const BDSEphemeris& b)
+      { return a.IODE == b.IODE && a.Toe == b.Toe; };
+
+      static bool sameEphemeris(const GalEphemeris& a, const GalEphemeris& b)
+      { return a.IODE == b.IODE && a.Toe == b.Toe; };
+
+      static bool sameEphemeris(const GloEphemeris& a, const GloEphemeris& b)
+      {
+         return a.px == b.px && a.py == b.py && a.pz == b.pz &&
+                a.TauN == b.TauN && a.MFtime == b.MFtime;
+      };
+
+      /// Merge the ephemerides of one system
+      template <class EphType>
+      void mergeEphData(
+         map<SatID, std::map<CommonTime, EphType>>& dst,
+         const map<SatID, std::map<CommonTime, EphType>>& src )
+      {
+         for(typename map<SatID, std::map<CommonTime, EphType>>::const_iterator
+                itSat = src.begin(); itSat != src.end(); ++itSat)
+         {
+            std::map<CommonTime, EphType>& ephMap = dst[itSat->first];
+
+            if(ephMap.empty())
+            {
+               ephMap = itSat->second;
+               continue;
+            }
+
+            for(typename std::map<CommonTime, EphType>::const_iterator
+                   it = itSat->second.begin(); it != itSat->second.end(); ++it)
+            {
+               typename std::map<CommonTime, EphType>::iterator
+                  itOld = ephMap.find(it->first);
+               if(itOld == ephMap.end())
+               {
+                  ephMap.insert(itOld, *it);
+               }
+               else if(sameEphemeris(itOld->second, it->second))
+               {
+                  numDuplicates++;
+               }
+               else
+               {
+                  itOld->second = it->second;
+                  numReplaced++;
+               }
+            }
+         }
+      }
+
+      /// Put the orbit of the ephemeris at t into the batch, with the
+      /// index i of the satellite in the request, and the clock into xvt
+      template <class EphType>
+      static void addToBatch(KeplerBatch& batch,
+                             std::vector<size_t>& batchIndex,
+                             const EphType& eph, const CommonTime& t,
+                             size_t i, Xvt& xvt)
+      {
+         double tk = t - eph.ctToe;
+         if(tk > 302400)  tk = tk-604800;
+         if(tk < -302400) tk = tk+604800;
+
+         KeplerOrbitConst tmpConst;
+         batch.add(eph, eph.orbitConstants(tmpConst), tk);
+         batchIndex.push_back(i);
+
+         xvt.clkbias = eph.svClockBias(t);
+         xvt.clkdrift = eph.svClockDrift(t);
+         xvt.frame = ReferenceFrame::WGS84;
+      }
+
+      /// Find the ephemeris nearest to epoch in the map of one system
+      template <class EphType>
+      static const EphType* findNearest(
+         const map<SatID, std::map<CommonTime, EphType>>& ephData,
+         const SatID& sat,
+         const CommonTime& epoch,
+         double validity )
+      {
+         typename map<SatID, std::map<CommonTime, EphType>>::const_iterator
+            itSat = ephData.find(sat);
+         if(itSat == ephData.end())
+         {
+            return NULL;
+         }
+
+         return nearestEphemeris(itSat->second, epoch, validity);
+      }
        
    };
 
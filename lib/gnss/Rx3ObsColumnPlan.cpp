@@ -0,0 +1,97 @@
+/**
+ * @file Rx3ObsColumnPlan.cpp
+ * Precompiled description of the observation columns of a RINEX 3 file.
+ */
+
+#include "Rx3ObsColumnPlan.hpp"
+
+using namespace std;
+
+namespace gnssSpace
+{
+
+   void Rx3ObsColumnPlan::build(const Rx3ObsHeader& hdr)
+      noexcept(false)
+   {
+      for(int i=0; i<128; i++)
+      {
+         sysColumns[i].clear();
+      }
+
+      for(auto sysIt=hdr.mapObsTypes.begin();
+               sysIt!=hdr.mapObsTypes.end(); ++sysIt)
+      {
+         if(sysIt->first.empty()) continue;
+
+         char sysChar = sysIt->first[0];
+
+         SatID sat;
+         sat.fromChar(sysChar);
+
+         Rx3ObsColumnVec& cols = sysColumns[static_cast<unsigned char>(sysChar) & 0x7f];
+         cols.resize(sysIt->second.size());
+
+         for(size_t i=0; i<sysIt->second.size(); i++)
+         {
+            Rx3ObsColumn& col = cols[i];
+
+            col.type = sysIt->second[i];
+
+            string R3ot = col.type.asString();
+            col.kind = R3ot[0];
+
+            // carrier-band
+            if(R3ot[1] == 'A')
+               col.band = 1;
+            else if(R3ot[1] >= '0' && R3ot[1] <= '9')
+               col.band = R3ot[1] - '0';
+            else
+               col.band = 0;
+
+            col.wavelength = 0.0;
+            col.gloFdma = false;
+
+            if(col.kind == 'L' && col.band > 0)
+            {
+               if(R3ot[3] == 'R')
+               {
+                  col.gloFdma = true;
+               }
+               else
+               {
+                  col.wavelength = getWavelength(sat, col.band);
+               }
+            }
+         }
+      }
+
+      // GLONASS wavelengths, one per slot
+      SatelliteSystem glo(SatelliteSystem::GLONASS);
+      for(int prn=0; prn<=MAX_PRN_GLO; prn++)
+      {
+         gloKnown[prn] = false;
+         gloWave1[prn] = 0.0;
+         gloWave2[prn] = 0.0;
+      }
+
+      for(auto it=hdr.glonassFreqNo.begin(); it!=hdr.glonassFreqNo.end(); ++it)
+      {
+         int prn = it->first.id;
+         if(prn <= 0 || prn > MAX_PRN_GLO) continue;
+
+         int k = it->second;
+         gloKnown[prn] = true;
+         gloWave1[prn] = getWavelength(glo, 1, k);
+         gloWave2[prn] = getWavelength(glo, 2, k);
+      }
+
+      for(int n=0; n<10; n++)
+      {
+         gloWaveCDMA[n] = (n==0) ? 0.0 : getWavelength(glo, n);
+      }
+
+      pHeader = &hdr;
+
+   }  // End of method 'Rx3ObsColumnPlan::build()'
+
+}  // End of namespace gnssSpace
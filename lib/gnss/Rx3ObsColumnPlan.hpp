@@ -0,0 +1,120 @@
+/**
+ * @file Rx3ObsColumnPlan.hpp
+ * Precompiled description of the observation columns of a RINEX 3 file.
+ *
+ * Rx3ObsData::readRecord decodes, for every observation of every
+ * satellite, the TypeID string, the carrier band and the wavelength.
+ * All of these only depend on the header, so they are computed here
+ * once per system from Rx3ObsHeader::mapObsTypes, and the readers only
+ * index the plan with the column number.
+ */
+
+#ifndef Rx3ObsColumnPlan_HPP
+#define Rx3ObsColumnPlan_HPP
+
+#include <vector>
+
+#include "TypeID.hpp"
+#include "SatID.hpp"
+#include "constants.hpp"
+#include "Rx3ObsHeader.hpp"
+
+namespace gnssSpace
+{
+
+      /// Everything the reader needs to know about one observation column
+   struct Rx3ObsColumn
+   {
+      Rx3ObsColumn()
+         : kind(' '), band(0), wavelength(0.0), gloFdma(false)
+      {};
+
+         /// the 4-char TypeID of this column, e.g. C1CG
+      TypeID type;
+
+         /// observation kind: 'C' code, 'L' phase, 'D' doppler, 'S' snr
+      char kind;
+
+         /// carrier band n, 'A' is mapped to 1
+      int band;
+
+         /// wavelength in meters for phase columns, 0 otherwise.
+         /// For GLONASS the channel-dependent wavelength is taken from
+         /// Rx3ObsColumnPlan::gloWavelength() instead.
+      double wavelength;
+
+         /// true for GLONASS phase, which needs the frequency channel
+      bool gloFdma;
+   };
+
+   typedef std::vector<Rx3ObsColumn> Rx3ObsColumnVec;
+
+
+      /** Column plan for all the systems of one Rx3ObsHeader.
+       *
+       * @code
+       *   Rx3ObsColumnPlan plan;
+       *   plan.build(rxHeader);
+       *   const Rx3ObsColumnVec& cols = plan.columns('G');
+       * @endcode
+       */
+   class Rx3ObsColumnPlan
+   {
+   public:
+
+         /// Default constructor
+      Rx3ObsColumnPlan()
+         : pHeader(NULL)
+      {};
+
+         /// Build the plan from the SYS / # / OBS TYPES and the
+         /// GLONASS SLOT / FRQ # records of the header.
+      void build(const Rx3ObsHeader& hdr)
+         noexcept(false);
+
+         /// Return true if the plan was built from the given header
+      bool isBuiltFor(const Rx3ObsHeader* pHdr) const
+      { return (pHdr != NULL && pHdr == pHeader); };
+
+         /// Columns of the given system char, empty if not in the header
+      const Rx3ObsColumnVec& columns(char sysChar) const
+      { return sysColumns[static_cast<unsigned char>(sysChar) & 0x7f]; };
+
+         /// Return true if the GLONASS slot has a known frequency channel
+      bool hasGloChannel(int prn) const
+      { return (prn > 0 && prn <= MAX_PRN_GLO && gloKnown[prn]); };
+
+         /** Wavelength of a GLONASS slot on the given band.
+          *  hasGloChannel() must be checked first.
+          */
+      double gloWavelength(int prn, int band) const
+      {
+         if(band == 1) return gloWave1[prn];
+         if(band == 2) return gloWave2[prn];
+         return (band > 0 && band < 10) ? gloWaveCDMA[band] : 0.0;
+      };
+
+         /// Destructor
+      virtual ~Rx3ObsColumnPlan() {};
+
+   private:
+
+         /// header the plan was built from
+      const Rx3ObsHeader* pHeader;
+
+         /// columns indexed with the ASCII system char
+      Rx3ObsColumnVec sysColumns[128];
+
+         /// GLONASS FDMA wavelengths indexed with the slot number
+      bool   gloKnown[MAX_PRN_GLO+1];
+      double gloWave1[MAX_PRN_GLO+1];
+      double gloWave2[MAX_PRN_GLO+1];
+
+         /// GLONASS CDMA wavelengths indexed with the band
+      double gloWaveCDMA[10];
+
+   }; // End of class 'Rx3ObsColumnPlan'
+
+}  // End of namespace gnssSpace
+
+#endif   // Rx3ObsColumnPlan_HPP
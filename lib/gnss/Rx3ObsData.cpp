@@ -12,6 +12,9 @@
 
 #include <fstream>
 #include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
 #include "StringUtils.hpp"
 #include "CivilTime.hpp"
 #include "TypeID.hpp"
@@ -27,6 +30,103 @@ using namespace gnssSpace;
 namespace gnssSpace
 {
 
+      // In-place parsing of fixed-width fields for readRecord(MappedFile&).
+      // The field [pos, pos+width) is clipped to the line, and blanks
+      // give 0, just like asInt()/asDouble() on a space-padded substr().
+
+   static const double pow10Table[] =
+   { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+   static inline long fieldAsInt( const char* line, size_t len,
+                                  size_t pos, size_t width )
+   {
+      if(pos >= len) return 0;
+      const char* p = line + pos;
+      const char* e = line + ((pos + width < len) ? pos + width : len);
+
+      while(p < e && *p == ' ') p++;
+
+      bool neg(false);
+      if(p < e && (*p == '-' || *p == '+'))
+      {
+         neg = (*p == '-');
+         p++;
+      }
+
+      long v(0);
+      while(p < e && *p >= '0' && *p <= '9')
+      {
+         v = v*10 + (*p - '0');
+         p++;
+      }
+
+      return neg ? -v : v;
+   }
+
+   static inline double fieldAsDouble( const char* line, size_t len,
+                                       size_t pos, size_t width )
+   {
+      if(pos >= len) return 0.0;
+      const char* b = line + pos;
+      const char* e = line + ((pos + width < len) ? pos + width : len);
+      const char* p = b;
+
+      while(p < e && *p == ' ') p++;
+
+      bool neg(false);
+      if(p < e && (*p == '-' || *p == '+'))
+      {
+         neg = (*p == '-');
+         p++;
+      }
+
+      // the digits are accumulated into an integer mantissa, which is
+      // exact below 2^53, so mantissa/10^frac is rounded exactly as strtod
+      unsigned long long mant(0);
+      int ndigit(0), nfrac(0);
+      while(p < e && *p >= '0' && *p <= '9')
+      {
+         mant = mant*10 + (*p - '0');
+         ndigit++;
+         p++;
+      }
+      if(p < e && *p == '.')
+      {
+         p++;
+         while(p < e && *p >= '0' && *p <= '9')
+         {
+            mant = mant*10 + (*p - '0');
+            ndigit++;
+            nfrac++;
+            p++;
+         }
+      }
+
+      while(p < e && *p == ' ') p++;
+
+      // exponents, overlong mantissas etc. are left to strtod
+      if(p != e || ndigit > 15)
+      {
+         char buf[64];
+         size_t n = e - b;
+         if(n > sizeof(buf)-1) n = sizeof(buf)-1;
+         memcpy(buf, b, n);
+         buf[n] = '\0';
+         return strtod(buf, 0);
+      }
+
+      double v = static_cast<double>(mant) / pow10Table[nfrac];
+      return neg ? -v : v;
+   }
+
+   static inline size_t trimmedLength(const char* line, size_t len)
+   {
+      while(len > 0 && line[len-1] == ' ') len--;
+      return len;
+   }
+
+
 
    void Rx3ObsData::writeRecordVer2( std::fstream& strm ) 
       noexcept(false)
@@ -579,9 +679,12 @@ namespace gnssSpace
             sat = satIndex[isv];                   // sat for this data
             satsys = asString(sat.systemChar());   // system for this sat
 
-            typeValueMap typeObs;
-            typeValueMap typeLLI;
-            typeValueMap typeSSI;
+            typeValueMap& typeObs = stvData[sat];
+            typeValueMap& typeLLI = stvDataLLI[sat];
+            typeValueMap& typeSSI = stvDataSSI[sat];
+            typeObs.clear();
+            typeLLI.clear();
+            typeSSI.clear();
 
                // loop over data in the line
             for(ndx=0, line_ndx=0; ndx < numObs; ndx++, line_ndx++)
@@ -695,11 +798,6 @@ namespace gnssSpace
                }
             }
 
-            // insert current satellite data 
-            stvData[sat] = typeObs;
-            stvDataLLI[sat] = typeLLI;
-            stvDataSSI[sat] = typeSSI;
-
          }  // end loop over sats to read obs data
 
       }
@@ -874,9 +972,13 @@ namespace gnssSpace
                line += string(minSize-line.size(), ' ');
 
             // get the data (# entries in ObsType map of maps from header)
-            typeValueMap typeObs;
-            typeValueMap typeLLI;
-            typeValueMap typeSSI;
+            // written in place, the nodes come from the pool
+            typeValueMap& typeObs = stvData[sat];
+            typeValueMap& typeLLI = stvDataLLI[sat];
+            typeValueMap& typeSSI = stvDataSSI[sat];
+            typeObs.clear();
+            typeLLI.clear();
+            typeSSI.clear();
             for(int i = 0; i < size; i++)
             {
                size_t pos = 3 + 16*i;
@@ -965,11 +1067,6 @@ namespace gnssSpace
 
             }
 
-            // insert current satellite data into stvData
-            stvData[satIndex[isv]] = typeObs;
-            stvDataLLI[satIndex[isv]] = typeLLI;
-            stvDataSSI[satIndex[isv]] = typeSSI;
-
          }
 
       }
@@ -1010,6 +1107,195 @@ namespace gnssSpace
    } // end of readRecord()
 
 
+   void Rx3ObsData::readRecord(MappedFile& mf)
+      noexcept(false)
+   {
+      if(pHeader==NULL)
+      {
+          cerr << " Rx3ObsData:: you must read rinex header and set into this class firstly! " << endl;
+          exit(-1);
+      }
+
+      if( (*pHeader).version < 3)
+      {
+         FFStreamError e("readRecord(MappedFile&) only supports RINEX 3 files");
+         THROW(e);
+      }
+
+      if(!colPlan.isBuiltFor(pHeader))
+      {
+         colPlan.build(*pHeader);
+      }
+
+      const char* line;
+      size_t len(0);
+
+      // read the epoch line, blank lines are ignored
+      while(true)
+      {
+         if(!mf.getLine(line, len))
+         {
+            EndOfFile err("EOF encountered!");
+            THROW(err);
+         }
+         len = trimmedLength(line, len);
+         if(len > 0) break;
+      }
+
+      if(debug)
+          cout << string(line, len) << endl;
+
+         // Check and parse the epoch line -----------------------------------
+         // Check for epoch marker ('>') and following space.
+      if(len < 35 || line[0] != '>' || line[1] != ' ')
+      {
+         FFStreamError e("Bad epoch line: >" + string(line, len) + "<");
+         THROW(e);
+      }
+
+      epochFlag = fieldAsInt(line, len, 31, 1);
+      if(epochFlag < 0 || epochFlag > 6)
+      {
+         FFStreamError e("Invalid epoch flag: " + asString(epochFlag));
+         THROW(e);
+      }
+
+      TimeSystem timeSys = (*pHeader).firstObs.timeSystem;
+      currEpoch = parseTime(line, len, timeSys);
+
+      numSVs = fieldAsInt(line, len, 32, 3);
+
+      if(len > 41)
+         clockOffset = fieldAsDouble(line, len, 41, 15);
+      else
+         clockOffset = 0.0;
+
+      // Read the observations: SV ID and data ----------------------------
+      if(epochFlag == 0 || epochFlag == 1 || epochFlag == 6)
+      {
+         stvData.clear();
+         stvDataLLI.clear();
+         stvDataSSI.clear();
+
+         for(int isv = 0; isv < numSVs; isv++)
+         {
+            if(!mf.getLine(line, len))
+            {
+                EndOfFile err("EOF encountered!");
+                THROW(err);
+            }
+
+            if(debug)
+                cout << string(line, len) << endl;
+
+            // get the SV ID, the same as SatID(line.substr(0,3))
+            SatID sat;
+            char sysChar = (len > 0) ? line[0] : ' ';
+            if(sysChar >= '0' && sysChar <= '9')
+            {
+               sat.system = SatelliteSystem::GPS;
+               sat.id = fieldAsInt(line, len, 0, 3);
+            }
+            else
+            {
+               sat.fromChar(sysChar);
+               sat.id = fieldAsInt(line, len, 1, 2);
+            }
+            if(sat.id <= 0) sat.id = -1;
+
+            const Rx3ObsColumnVec& cols = colPlan.columns(sat.systemChar());
+
+            typeValueMap& typeObs = stvData[sat];
+            typeValueMap& typeLLI = stvDataLLI[sat];
+            typeValueMap& typeSSI = stvDataSSI[sat];
+            typeObs.clear();
+            typeLLI.clear();
+            typeSSI.clear();
+
+            for(size_t i = 0; i < cols.size(); i++)
+            {
+               const Rx3ObsColumn& col = cols[i];
+               size_t pos = 3 + 16*i;
+
+               // observation
+               double data = fieldAsDouble(line, len, pos, 14);
+
+               // carrier-phase
+               if(col.kind == 'L')
+               {
+                  double wavelength(col.wavelength);
+
+                  // GLONASS
+                  if(col.gloFdma)
+                  {
+                     if(!colPlan.hasGloChannel(sat.id))
+                     {
+                        continue;
+                     }
+
+                     wavelength = colPlan.gloWavelength(sat.id, col.band);
+
+                     if(col.band == 1)
+                     {
+                        typeObs[TypeID::wavelengthL1R] = wavelength;
+                     }
+                     else if(col.band == 2)
+                     {
+                        typeObs[TypeID::wavelengthL2R] = wavelength;
+                     }
+                  }
+
+                  if(wavelength == 0.0) continue;
+
+                  // convert cycles to meters
+                  data = data * wavelength;
+               }
+
+               typeObs[col.type] = data;
+               typeLLI[col.type] = fieldAsInt(line, len, pos+14, 1);
+               typeSSI[col.type] = fieldAsInt(line, len, pos+15, 1);
+            }
+         }
+
+      }
+
+         // ... or the auxiliary header information
+      else if(numSVs > 0)
+      {
+         auxHeader.clear();
+         for(int i = 0; i < numSVs; i++)
+         {
+            if(!mf.getLine(line, len))
+            {
+                EndOfFile err("EOF encountered!");
+                THROW(err);
+            }
+
+            string auxLine(line, trimmedLength(line, len));
+
+            if(debug)
+                cout << auxLine << endl;
+            try
+            {
+               auxHeader.parseHeaderRecord(auxLine);
+            }
+            catch(FFStreamError& e)
+            {
+               RETHROW(e);
+            }
+            catch(StringException& e)
+            {
+               RETHROW(e);
+            }
+         }
+      }
+
+      return;
+
+   } // end of readRecord(MappedFile&)
+
+
+
    CommonTime Rx3ObsData::parseTime( const string& line,
                                           const Rx3ObsHeader& hdr,
                                           const TimeSystem& ts) const
@@ -1069,6 +1355,70 @@ namespace gnssSpace
       }
    }  // end parseTime
 
+   CommonTime Rx3ObsData::parseTime( const char* line,
+                                     size_t len,
+                                     const TimeSystem& ts) const
+      noexcept(false)
+   {
+         // check if the spaces are in the right place - an easy
+         // way to check if there's corruption in the file
+      if( len < 31 ||
+          (line[ 1] != ' ') || (line[ 6] != ' ') || (line[ 9] != ' ') ||
+          (line[12] != ' ') || (line[15] != ' ') || (line[18] != ' ') ||
+          (line[29] != ' ') || (line[30] != ' '))
+      {
+         FFStreamError e("Invalid time format");
+         THROW(e);
+      }
+
+         // if there's no time, just return a bad time
+      bool noTime(true);
+      for(size_t i=2; i<29; i++)
+      {
+         if(line[i] != ' ')
+         {
+            noTime = false;
+            break;
+         }
+      }
+      if(noTime)
+         return CommonTime::BEGINNING_OF_TIME;
+
+      int year, month, day, hour, min;
+      double sec;
+
+      year  = fieldAsInt(   line, len,  2,  4);
+      month = fieldAsInt(   line, len,  7,  2);
+      day   = fieldAsInt(   line, len, 10,  2);
+      hour  = fieldAsInt(   line, len, 13,  2);
+      min   = fieldAsInt(   line, len, 16,  2);
+      sec   = fieldAsDouble(line, len, 19, 11);
+
+         // Real Rinex has epochs 'yy mm dd hr 59 60.0' surprisingly often.
+      double ds = 0;
+      if(sec >= 60.)
+      {
+         ds = sec;
+         sec = 0.0;
+      }
+
+      try
+      {
+         CommonTime rv = CivilTime(year,month,day,hour,min,sec).convertToCommonTime();
+         if(ds != 0) rv += ds;
+
+         rv.setTimeSystem(ts);
+
+         return rv;
+      }
+      catch (Exception& e)
+      {
+         FFStreamError err(e);
+         THROW(err);
+      }
+   }  // end parseTime
+
+
    string Rx3ObsData::writeTime(const CommonTime& ct) const
       noexcept(false)
    {
@@ -1148,6 +1498,19 @@ namespace gnssSpace
        double Tolerance=5;
        CommonTime roverTime=current;
        CommonTime lastEpoch=currEpoch;
+
+       // jump over the records before (current - Tolerance)
+       if(pIndex != NULL && roverTime-lastEpoch>Tolerance)
+       {
+           size_t n = pIndex->findEpoch(roverTime - Tolerance);
+           if(n == pIndex->size() || (*pIndex)[n].time > lastEpoch)
+           {
+               seekTime(strm, roverTime - Tolerance);
+               readRecord(strm);
+               lastEpoch = currEpoch;
+           }
+       }
+
        while(true)
        {
            if(abs(lastEpoch-roverTime)<=Tolerance)
@@ -1173,6 +1536,120 @@ namespace gnssSpace
    }
 
 
+   bool Rx3ObsData::tryReadRecord(std::fstream& strm)
+      noexcept(false)
+   {
+      // the epoch line starts with '>', blank lines are skipped
+      strm >> std::ws;
+      if(strm.peek() == EOF)
+      {
+         return false;
+      }
+
+      try
+      {
+         readRecord(strm);
+      }
+      catch(EndOfFile& e)
+      {
+         // last record without '\n'
+         return false;
+      }
+
+      return true;
+   }
+
+
+   bool Rx3ObsData::tryReadRecord(MappedFile& mf)
+      noexcept(false)
+   {
+      const char* p = mf.data() + mf.tell();
+      const char* pEnd = mf.data() + mf.size();
+      while(p < pEnd && isspace(static_cast<unsigned char>(*p)))
+      {
+         p++;
+      }
+
+      if(p == pEnd)
+      {
+         mf.seek(mf.size());
+         return false;
+      }
+
+      readRecord(mf);
+
+      return true;
+   }
+
+
+   size_t Rx3ObsData::seekTime(std::fstream& strm, const CommonTime& t)
+      noexcept(false)
+   {
+      if(pIndex==NULL)
+      {
+         InvalidRequest e("Rx3ObsData::seekTime: pIndex is not set");
+         THROW(e);
+      }
+
+      size_t n = pIndex->findEpoch(t);
+
+      strm.clear();
+      if(n < pIndex->size())
+         strm.seekg((*pIndex)[n].offset);
+      else
+         strm.seekg(0, ios::end);
+
+      return n;
+   }
+
+
+   size_t Rx3ObsData::seekTime(MappedFile& mf, const CommonTime& t)
+      noexcept(false)
+   {
+      if(pIndex==NULL)
+      {
+         InvalidRequest e("Rx3ObsData::seekTime: pIndex is not set");
+         THROW(e);
+      }
+
+      size_t n = pIndex->findEpoch(t);
+
+      if(n < pIndex->size())
+         mf.seek((*pIndex)[n].offset);
+      else
+         mf.seek(mf.size());
+
+      return n;
+   }
+
+
+   void Rx3ObsData::seekEpoch(std::fstream& strm, size_t n)
+      noexcept(false)
+   {
+      if(pIndex==NULL || n >= pIndex->size())
+      {
+         InvalidRequest e("Rx3ObsData::seekEpoch: no epoch " + asString(int(n)));
+         THROW(e);
+      }
+
+      strm.clear();
+      strm.seekg((*pIndex)[n].offset);
+   }
+
+
+   void Rx3ObsData::seekEpoch(MappedFile& mf, size_t n)
+      noexcept(false)
+   {
+      if(pIndex==NULL || n >= pIndex->size())
+      {
+         InvalidRequest e("Rx3ObsData::seekEpoch: no epoch " + asString(int(n)));
+         THROW(e);
+      }
+
+      mf.seek((*pIndex)[n].offset);
+   }
+
+
     // end dump
 
 }
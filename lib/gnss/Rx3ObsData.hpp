@@ -32,6 +32,9 @@
 #include "CommonTime.hpp"
 #include "DataStructures.hpp"
 #include "Rx3ObsHeader.hpp"
+#include "Rx3ObsColumnPlan.hpp"
+#include "MappedFile.hpp"
+#include "Rx3ObsEpochIndex.hpp"
 
 using namespace utilSpace;
 using namespace timeSpace;
@@ -51,6 +54,7 @@ namespace gnssSpace
 
       Rx3ObsData()
          : pHeader(NULL),
+           pIndex(NULL),
            currEpoch(CommonTime::BEGINNING_OF_TIME),
            epochFlag(-1),
            numSVs(-1),
@@ -77,6 +81,11 @@ namespace gnssSpace
       /// 在读取数据以前，先读取头文件，如果读取完成了，则直接读数据
       Rx3ObsHeader* pHeader;
 
+      /// epoch index of the file, optional. If it is set, seekTime and
+      /// seekEpoch are available, and readRecordByTime jumps over the
+      /// records before the requested time instead of reading them.
+      const Rx3ObsEpochIndex* pIndex;
+
       /// Time corresponding to the observations
       CommonTime currEpoch;
 
@@ -118,6 +127,10 @@ namespace gnssSpace
       /// 读辅助行，比如接收机开始移动了等等（epochFlag 2-5）
       Rx3ObsHeader auxHeader; ///< auxiliary header records (epochFlag 2-5)
 
+      /// column plan of (*pHeader), built by the first readRecord(MappedFile&).
+      /// call colPlan.build() again if the header is re-read in place.
+      Rx3ObsColumnPlan colPlan;
+
       /////////////////////////
       /////////////////////////
       /////////////////////////
@@ -157,9 +170,71 @@ namespace gnssSpace
       virtual void readRecordByTime(std::fstream& strm,CommonTime current)
         noexcept(false);
 
+      /// Read a RINEX 3 record from a memory-mapped file.
+      /// The fields are parsed in place, and TypeID, kind and wavelength
+      /// of each column are taken from colPlan, so no string is built
+      /// for the observations. The cursor of mf must be positioned after
+      /// the header, e.g. mf.seek(strm.tellg()) after strm >> header.
+      virtual void readRecord(MappedFile& mf)
+         noexcept(false);
+
+      /// Read the next record, returning false instead of throwing
+      /// EndOfFile when only blank lines are left. Format errors are
+      /// still thrown as FFStreamError.
+      virtual bool tryReadRecord(std::fstream& strm)
+         noexcept(false);
+
+      virtual bool tryReadRecord(MappedFile& mf)
+         noexcept(false);
+
+      /// Exchange the record data (epoch, flag, clock offset, and the
+      /// observation maps) with another object without copying the maps.
+      /// pHeader, pIndex, auxHeader and colPlan are not exchanged.
+      void swapRecord(Rx3ObsData& right)
+      {
+         std::swap(currEpoch, right.currEpoch);
+         std::swap(epochFlag, right.epochFlag);
+         std::swap(numSVs, right.numSVs);
+         std::swap(clockOffset, right.clockOffset);
+         stvData.swap(right.stvData);
+         stvDataLLI.swap(right.stvDataLLI);
+         stvDataSSI.swap(right.stvDataSSI);
+      };
+
+      /// Copy the record data exchanged by swapRecord() from another
+      /// object, e.g. a base record used for several rover epochs.
+      void copyRecord(const Rx3ObsData& right)
+      {
+         currEpoch = right.currEpoch;
+         epochFlag = right.epochFlag;
+         numSVs = right.numSVs;
+         clockOffset = right.clockOffset;
+         stvData = right.stvData;
+         stvDataLLI = right.stvDataLLI;
+         stvDataSSI = right.stvDataSSI;
+      };
+
       virtual void readRecordVer2(std::fstream& strm)
          noexcept(false);
 
+      /// Position the stream at the first epoch not earlier than t, the
+      /// next readRecord() returns this epoch. pIndex must be set.
+      /// @return the epoch number, pIndex->size() if t is after the
+      ///         last epoch (then the next readRecord() throws EndOfFile)
+      virtual size_t seekTime(std::fstream& strm, const CommonTime& t)
+         noexcept(false);
+
+      virtual size_t seekTime(MappedFile& mf, const CommonTime& t)
+         noexcept(false);
+
+      /// Position the stream at the n-th epoch (0 is the first epoch).
+      /// pIndex must be set, InvalidRequest is thrown if n is too large.
+      virtual void seekEpoch(std::fstream& strm, size_t n)
+         noexcept(false);
+
+      virtual void seekEpoch(MappedFile& mf, size_t n)
+         noexcept(false);
+
       virtual void setCycleSlipLLI(satValueMap& satCycleSlipData)
       {
          for(auto& stv: stvData)
@@ -307,6 +382,12 @@ namespace gnssSpace
                             const TimeSystem& ts) const
          noexcept(false);
 
+         /// the same as parseTime(), but parse the epoch line in place.
+      CommonTime parseTime( const char* line,
+                            size_t len,
+                            const TimeSystem& ts) const
+         noexcept(false);
+
 
 
 
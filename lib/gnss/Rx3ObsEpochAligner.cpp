@@ -0,0 +1,184 @@
+/**
+ * @file Rx3ObsEpochAligner.cpp
+ * Merge-join of the epochs of several observation streams.
+ */
+
+#include <cmath>
+
+#include "Rx3ObsEpochAligner.hpp"
+
+#define debug 0
+
+using namespace std;
+
+namespace gnssSpace
+{
+
+   int Rx3ObsEpochAligner::addStream(Rx3ObsData& data, std::fstream& strm)
+   {
+      Stream s;
+      s.pData = &data;
+      s.pStrm = &strm;
+      streams.push_back(s);
+
+      return streams.size()-1;
+   }
+
+
+   int Rx3ObsEpochAligner::addStream(Rx3ObsData& data, MappedFile& mf)
+   {
+      Stream s;
+      s.pData = &data;
+      s.pMapped = &mf;
+      streams.push_back(s);
+
+      return streams.size()-1;
+   }
+
+
+   bool Rx3ObsEpochAligner::fill(Stream& s, Rx3ObsData& data)
+      noexcept(false)
+   {
+      if(s.ended)
+      {
+         return false;
+      }
+
+      // the buffers of a base read with the header of the stream
+      data.pHeader = s.pData->pHeader;
+      data.pIndex = s.pData->pIndex;
+
+      while(true)
+      {
+         bool ok = (s.pStrm != NULL) ? data.tryReadRecord(*s.pStrm)
+                                     : data.tryReadRecord(*s.pMapped);
+         if(!ok)
+         {
+            s.ended = true;
+            return false;
+         }
+
+         // skip the auxiliary records
+         if(data.epochFlag == 0 || data.epochFlag == 1)
+         {
+            return true;
+         }
+      }
+
+   }  // End of method 'Rx3ObsEpochAligner::fill()'
+
+
+   void Rx3ObsEpochAligner::alignBase(Stream& s)
+      noexcept(false)
+   {
+      while(true)
+      {
+         if(!s.hasCurr)
+         {
+            if(s.hasNext)
+            {
+               s.curr.swapRecord(s.nextRec);
+               s.hasNext = false;
+               s.hasCurr = true;
+            }
+            else
+            {
+               s.hasCurr = fill(s, s.curr);
+            }
+         }
+
+         if(!s.hasCurr)
+         {
+            return;
+         }
+
+         double diff( currEpoch - s.curr.currEpoch );
+
+         // too old for this and the next rover epochs
+         if(diff > tolerance)
+         {
+            s.hasCurr = false;
+            continue;
+         }
+
+         // a later record can only be nearer if this one is earlier
+         if(diff > 0.0)
+         {
+            if(!s.hasNext)
+            {
+               s.hasNext = fill(s, s.nextRec);
+            }
+
+            if( s.hasNext &&
+                std::abs(s.nextRec.currEpoch - currEpoch) < diff )
+            {
+               s.hasCurr = false;
+               continue;
+            }
+         }
+
+         return;
+      }
+
+   }  // End of method 'Rx3ObsEpochAligner::alignBase()'
+
+
+   Rx3ObsEpochAligner::Status Rx3ObsEpochAligner::next()
+      noexcept(false)
+   {
+      for(size_t i=0; i<streams.size(); i++)
+      {
+         streams[i].present = false;
+      }
+
+      if(streams.empty())
+      {
+         return End;
+      }
+
+      Stream& rover = streams[0];
+
+      try
+      {
+         if(!fill(rover, *rover.pData))
+         {
+            return End;
+         }
+
+         rover.present = true;
+         currEpoch = rover.pData->currEpoch;
+
+         bool base(false);
+         for(size_t i=1; i<streams.size(); i++)
+         {
+            Stream& s = streams[i];
+
+            alignBase(s);
+
+            if( s.hasCurr &&
+                std::abs(s.curr.currEpoch - currEpoch) <= tolerance )
+            {
+               // copied, the record may be used again for the next
+               // rover epochs
+               s.pData->copyRecord(s.curr);
+               s.present = true;
+               base = true;
+            }
+         }
+
+         if(debug)
+         {
+            cout << "Rx3ObsEpochAligner: " << currEpoch
+                 << " base " << base << endl;
+         }
+
+         return base ? Matched : RoverOnly;
+      }
+      catch(Exception& e)
+      {
+         RETHROW(e);
+      }
+
+   }  // End of method 'Rx3ObsEpochAligner::next()'
+
+}  // End of namespace gnssSpace
@@ -0,0 +1,164 @@
+/**
+ * @file Rx3ObsEpochAligner.hpp
+ * Merge-join of the epochs of several observation streams.
+ *
+ * Rx3ObsData::readRecordByTime reports an unsynchronized epoch by
+ * throwing a bool and the end of data by throwing EndOfFile. For long
+ * kinematic sessions with data gaps this unwinds the stack for every
+ * epoch which is out of step. This class joins the streams by time and
+ * reports the result of each step with a return value instead.
+ *
+ * Stream 0 is the rover, the others are base stations, so the same
+ * class is used for rtk (one base) and network processing (N bases).
+ * Each rover epoch is matched, as readRecordByTime did, with the nearest
+ * record of each base within the tolerance, and a base record is used
+ * for all the rover epochs it is the nearest to, e.g. a 30 s base with
+ * a 1 Hz rover.
+ */
+
+#ifndef Rx3ObsEpochAligner_HPP
+#define Rx3ObsEpochAligner_HPP
+
+#include <vector>
+#include <fstream>
+
+#include "Exception.hpp"
+#include "CommonTime.hpp"
+#include "MappedFile.hpp"
+#include "Rx3ObsData.hpp"
+
+namespace gnssSpace
+{
+
+      /** Epoch aligner for a rover and one or more base streams.
+       *
+       * Only observation records (epoch flag 0 and 1) are returned, the
+       * auxiliary records are skipped.
+       *
+       * @code
+       *   Rx3ObsEpochAligner aligner(5.0);
+       *   aligner.addStream(rxDataRover, rxStreamRover);
+       *   aligner.addStream(rxDataBase, rxStreamBase);
+       *
+       *   while(true)
+       *   {
+       *      Rx3ObsEpochAligner::Status status = aligner.next();
+       *      if(status == Rx3ObsEpochAligner::End) break;
+       *      if(status != Rx3ObsEpochAligner::Matched) continue;
+       *
+       *      // rxDataBase holds the base record nearest to rxDataRover
+       *   }
+       * @endcode
+       */
+   class Rx3ObsEpochAligner
+   {
+   public:
+
+         /// Result of next()
+      enum Status
+      {
+         Matched,    ///< at least one base has a record for this epoch
+         RoverOnly,  ///< no base has a record for this epoch
+         End         ///< the rover stream is exhausted
+      };
+
+         /// Constructor, tolerance in seconds for two epochs to match
+      Rx3ObsEpochAligner(double tol = 5.0)
+         : tolerance(tol)
+      {};
+
+         /** Add a stream read with an fstream, the header must be read
+          *  and data.pHeader set. The first stream is the rover.
+          *
+          * @return the stream number
+          */
+      int addStream(Rx3ObsData& data, std::fstream& strm);
+
+         /// Add a stream read from a MappedFile
+      int addStream(Rx3ObsData& data, MappedFile& mf);
+
+         /// Set the tolerance in seconds
+      Rx3ObsEpochAligner& setTolerance(double tol)
+      { tolerance = tol; return (*this); };
+
+         /// Get the tolerance in seconds
+      double getTolerance() const
+      { return tolerance; };
+
+         /** Advance to the next rover epoch.
+          *
+          * The next rover record is read into its Rx3ObsData. For each
+          * base, the records more than the tolerance before the rover
+          * epoch, or followed by a record nearer to it, are dropped; the
+          * remaining record is copied into the Rx3ObsData of the base,
+          * which is marked present, if it is within the tolerance. It is
+          * kept for the next rover epochs.
+          */
+      Status next()
+         noexcept(false);
+
+         /// Return true if stream i holds the current epoch
+      bool isPresent(int i) const
+      { return streams[i].present; };
+
+         /// Return true if stream i has no more records to return
+      bool isEnded(int i) const
+      { return streams[i].ended && !streams[i].hasCurr && !streams[i].hasNext; };
+
+         /// Time of the current rover epoch
+      const CommonTime& getEpoch() const
+      { return currEpoch; };
+
+         /// Number of streams
+      int numStreams() const
+      { return streams.size(); };
+
+         /// Destructor
+      virtual ~Rx3ObsEpochAligner() {};
+
+   private:
+
+      struct Stream
+      {
+         Stream()
+            : pData(NULL), pStrm(NULL), pMapped(NULL),
+              hasCurr(false), hasNext(false), ended(false), present(false)
+         {};
+
+         Rx3ObsData*   pData;
+         std::fstream* pStrm;
+         MappedFile*   pMapped;
+
+            /// records of a base: the candidate for the rover epochs, and
+            /// the record after it, read to know which one is nearer
+         Rx3ObsData curr;
+         Rx3ObsData nextRec;
+         bool hasCurr;
+         bool hasNext;
+
+            /// the end of the stream was reached
+         bool ended;
+
+            /// the record belongs to the current epoch
+         bool present;
+      };
+
+         /// Read the next observation record of the stream into data
+      bool fill(Stream& s, Rx3ObsData& data)
+         noexcept(false);
+
+         /// Find the record of base s for the rover epoch
+      void alignBase(Stream& s)
+         noexcept(false);
+
+      std::vector<Stream> streams;
+
+      double tolerance;
+
+      CommonTime currEpoch;
+
+   }; // End of class 'Rx3ObsEpochAligner'
+
+}  // End of namespace gnssSpace
+
+#endif   // Rx3ObsEpochAligner_HPP
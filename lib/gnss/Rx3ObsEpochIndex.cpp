@@ -0,0 +1,369 @@
+/**
+ * @file Rx3ObsEpochIndex.cpp
+ * Byte-offset index of the epochs of a RINEX 3 observation file.
+ */
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+
+#include "Rx3ObsEpochIndex.hpp"
+#include "MappedFile.hpp"
+#include "CivilTime.hpp"
+
+#define debug 0
+
+using namespace std;
+using namespace utilSpace;
+using namespace timeSpace;
+
+namespace gnssSpace
+{
+      // sidecar file layout
+   static const char idxMagic[8] = { 'R','X','3','E','I','D','X','\0' };
+   static const int  idxVersion  = 1;
+
+      // integer in the fixed-width field [pos, pos+n), blanks are ignored
+   static int scanInt(const char* line, size_t len, size_t pos, size_t n)
+   {
+      int sign(1), val(0);
+      size_t end = std::min(len, pos+n);
+      for(size_t i=pos; i<end; i++)
+      {
+         char c = line[i];
+         if(c >= '0' && c <= '9') val = val*10 + (c-'0');
+         else if(c == '-') sign = -1;
+      }
+      return sign*val;
+   }
+
+      // seconds field 'ss.sssssss', parsed without strtod
+   static double scanSec(const char* line, size_t len, size_t pos, size_t n)
+   {
+      double val(0.0), scale(0.0);
+      size_t end = std::min(len, pos+n);
+      for(size_t i=pos; i<end; i++)
+      {
+         char c = line[i];
+         if(c >= '0' && c <= '9')
+         {
+            val = val*10.0 + (c-'0');
+            if(scale > 0.0) scale *= 10.0;
+         }
+         else if(c == '.')
+         {
+            scale = 1.0;
+         }
+      }
+      return (scale > 0.0) ? val/scale : val;
+   }
+
+
+   void Rx3ObsEpochIndex::build(const std::string& obsFile,
+                                const Rx3ObsHeader& hdr)
+      noexcept(false)
+   {
+      if(hdr.version < 3)
+      {
+         FFStreamError e("Rx3ObsEpochIndex only supports RINEX 3 files");
+         THROW(e);
+      }
+
+      entries.clear();
+
+      MappedFile mf;
+      try
+      {
+         mf.open(obsFile);
+      }
+      catch(Exception& e)
+      {
+         RETHROW(e);
+      }
+
+      fileStatus(obsFile, fileSize, fileTime);
+
+      TimeSystem timeSys = hdr.firstObs.timeSystem;
+
+      const char* line;
+      size_t len;
+
+      // skip the header
+      bool headerEnd(false);
+      while(mf.getLine(line, len))
+      {
+         if(len >= 73 && strncmp(line+60, "END OF HEADER", 13) == 0)
+         {
+            headerEnd = true;
+            break;
+         }
+      }
+
+      if(!headerEnd)
+      {
+         FFStreamError e("END OF HEADER not found in " + obsFile);
+         THROW(e);
+      }
+
+      // a 1 Hz daily file has 86400 epochs
+      entries.reserve(mf.size()/4096 + 16);
+
+      while(true)
+      {
+         size_t offset = mf.tell();
+
+         if(!mf.getLine(line, len)) break;
+
+         // blank lines are ignored by the readers
+         bool blank(true);
+         for(size_t i=0; i<len; i++)
+         {
+            if(line[i] != ' ') { blank = false; break; }
+         }
+         if(blank) continue;
+
+         if(len < 35 || line[0] != '>' || line[1] != ' ')
+         {
+            FFStreamError e("Bad epoch line: >" + string(line, len) + "<");
+            THROW(e);
+         }
+
+         short flag  = scanInt(line, len, 31, 1);
+         short numSV = scanInt(line, len, 32, 3);
+
+         if(flag == 0 || flag == 1)
+         {
+            Rx3ObsEpochEntry entry;
+
+            int year  = scanInt(line, len,  2, 4);
+            int month = scanInt(line, len,  7, 2);
+            int day   = scanInt(line, len, 10, 2);
+            int hour  = scanInt(line, len, 13, 2);
+            int min   = scanInt(line, len, 16, 2);
+            double sec = scanSec(line, len, 19, 11);
+
+            // see Rx3ObsData::parseTime for 'hr 59 60.0'
+            double ds(0.0);
+            if(sec >= 60.0)
+            {
+               ds = sec;
+               sec = 0.0;
+            }
+
+            try
+            {
+               entry.time = CivilTime(year,month,day,hour,min,sec).convertToCommonTime();
+               if(ds != 0.0) entry.time += ds;
+               entry.time.setTimeSystem(timeSys);
+            }
+            catch(Exception& e)
+            {
+               FFStreamError err(e);
+               THROW(err);
+            }
+
+            entry.offset = offset;
+            entry.epochFlag = flag;
+            entry.numSVs = numSV;
+
+            entries.push_back(entry);
+         }
+
+         // skip the satellite lines, or the auxiliary header lines
+         for(int i=0; i<numSV; i++)
+         {
+            if(!mf.getLine(line, len)) break;
+         }
+      }
+
+      if(debug)
+      {
+         cout << "Rx3ObsEpochIndex: " << entries.size()
+              << " epochs in " << obsFile << endl;
+      }
+
+   }  // End of method 'Rx3ObsEpochIndex::build()'
+
+
+   void Rx3ObsEpochIndex::save(const std::string& idxFile) const
+      noexcept(false)
+   {
+      ofstream strm(idxFile.c_str(), ios::out | ios::binary | ios::trunc);
+      if(!strm)
+      {
+         FileMissingException e("can't create file:" + idxFile);
+         THROW(e);
+      }
+
+      unsigned long long size = fileSize;
+      unsigned long long num  = entries.size();
+
+      strm.write(idxMagic, sizeof(idxMagic));
+      strm.write(reinterpret_cast<const char*>(&idxVersion), sizeof(int));
+      strm.write(reinterpret_cast<const char*>(&size), sizeof(size));
+      strm.write(reinterpret_cast<const char*>(&fileTime), sizeof(fileTime));
+      strm.write(reinterpret_cast<const char*>(&num), sizeof(num));
+
+      for(size_t i=0; i<entries.size(); i++)
+      {
+         const Rx3ObsEpochEntry& entry = entries[i];
+
+         long day, msod;
+         double fsod;
+         TimeSystem ts;
+         entry.time.getInternal(day, msod, fsod, ts);
+
+         long long iday = day, imsod = msod;
+         int its = static_cast<int>(ts.getTimeSystem());
+         unsigned long long offset = entry.offset;
+
+         strm.write(reinterpret_cast<const char*>(&iday), sizeof(iday));
+         strm.write(reinterpret_cast<const char*>(&imsod), sizeof(imsod));
+         strm.write(reinterpret_cast<const char*>(&fsod), sizeof(fsod));
+         strm.write(reinterpret_cast<const char*>(&its), sizeof(its));
+         strm.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+         strm.write(reinterpret_cast<const char*>(&entry.epochFlag), sizeof(short));
+         strm.write(reinterpret_cast<const char*>(&entry.numSVs), sizeof(short));
+      }
+
+      if(!strm)
+      {
+         FFStreamError e("error while writing " + idxFile);
+         THROW(e);
+      }
+
+   }  // End of method 'Rx3ObsEpochIndex::save()'
+
+
+   bool Rx3ObsEpochIndex::load(const std::string& idxFile,
+                               const std::string& obsFile)
+   {
+      size_t size;
+      long long mtime;
+      if(!fileStatus(obsFile, size, mtime)) return false;
+
+      ifstream strm(idxFile.c_str(), ios::in | ios::binary);
+      if(!strm) return false;
+
+      char magic[8];
+      int version;
+      unsigned long long idxSize, num;
+      long long idxTime;
+
+      strm.read(magic, sizeof(magic));
+      strm.read(reinterpret_cast<char*>(&version), sizeof(version));
+      strm.read(reinterpret_cast<char*>(&idxSize), sizeof(idxSize));
+      strm.read(reinterpret_cast<char*>(&idxTime), sizeof(idxTime));
+      strm.read(reinterpret_cast<char*>(&num), sizeof(num));
+
+      if( !strm ||
+          memcmp(magic, idxMagic, sizeof(magic)) != 0 ||
+          version != idxVersion ||
+          idxSize != size ||
+          idxTime != mtime ||
+          num > size/35 )
+      {
+         return false;
+      }
+
+      Rx3ObsEpochEntryVec vec;
+      vec.resize(num);
+
+      for(size_t i=0; i<num; i++)
+      {
+         Rx3ObsEpochEntry& entry = vec[i];
+
+         long long iday, imsod;
+         double fsod;
+         int its;
+         unsigned long long offset;
+
+         strm.read(reinterpret_cast<char*>(&iday), sizeof(iday));
+         strm.read(reinterpret_cast<char*>(&imsod), sizeof(imsod));
+         strm.read(reinterpret_cast<char*>(&fsod), sizeof(fsod));
+         strm.read(reinterpret_cast<char*>(&its), sizeof(its));
+         strm.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+         strm.read(reinterpret_cast<char*>(&entry.epochFlag), sizeof(short));
+         strm.read(reinterpret_cast<char*>(&entry.numSVs), sizeof(short));
+
+         if(!strm || offset >= size) return false;
+
+         try
+         {
+            entry.time.setInternal(iday, imsod, fsod,
+                                   TimeSystem(its));
+         }
+         catch(Exception& e)
+         {
+            return false;
+         }
+
+         entry.offset = offset;
+      }
+
+      entries.swap(vec);
+      fileSize = size;
+      fileTime = mtime;
+
+      return true;
+
+   }  // End of method 'Rx3ObsEpochIndex::load()'
+
+
+   void Rx3ObsEpochIndex::loadOrBuild(const std::string& obsFile,
+                                      const Rx3ObsHeader& hdr)
+      noexcept(false)
+   {
+      string idxFile = sidecarName(obsFile);
+
+      if(load(idxFile, obsFile)) return;
+
+      build(obsFile, hdr);
+
+      try
+      {
+         save(idxFile);
+      }
+      catch(Exception& e)
+      {
+         // e.g. read-only data directory, the index is still usable
+         if(debug)
+            cerr << e << endl;
+      }
+
+   }  // End of method 'Rx3ObsEpochIndex::loadOrBuild()'
+
+
+   size_t Rx3ObsEpochIndex::findEpoch(const CommonTime& t) const
+      noexcept(false)
+   {
+      Rx3ObsEpochEntryVec::const_iterator it =
+         std::lower_bound( entries.begin(), entries.end(), t,
+                           [](const Rx3ObsEpochEntry& e, const CommonTime& tt)
+                           { return e.time < tt; } );
+
+      return it - entries.begin();
+
+   }  // End of method 'Rx3ObsEpochIndex::findEpoch()'
+
+
+   bool Rx3ObsEpochIndex::fileStatus(const std::string& obsFile,
+                                     size_t& size,
+                                     long long& mtime)
+   {
+      struct stat st;
+      if(stat(obsFile.c_str(), &st) != 0)
+      {
+         size = 0;
+         mtime = 0;
+         return false;
+      }
+
+      size = static_cast<size_t>(st.st_size);
+      mtime = static_cast<long long>(st.st_mtime);
+
+      return true;
+   }
+
+}  // End of namespace gnssSpace
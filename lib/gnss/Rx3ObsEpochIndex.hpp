@@ -0,0 +1,143 @@
+/**
+ * @file Rx3ObsEpochIndex.hpp
+ * Byte-offset index of the epochs of a RINEX 3 observation file.
+ *
+ * The index is built in one pass over the memory-mapped file, only the
+ * epoch lines ('>') are parsed, the observation lines are skipped with
+ * the number of satellites of the epoch line. With the index, a reader
+ * can jump to any epoch instead of parsing all the earlier records.
+ *
+ * The index can be saved as a binary sidecar file next to the obs file,
+ * (default name: obsFile + ".eidx"), and is only reloaded if the size and
+ * the modification time of the obs file are unchanged.
+ */
+
+#ifndef Rx3ObsEpochIndex_HPP
+#define Rx3ObsEpochIndex_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "Exception.hpp"
+#include "CommonTime.hpp"
+#include "Rx3ObsHeader.hpp"
+
+namespace gnssSpace
+{
+
+      /// one observation epoch of the file
+   struct Rx3ObsEpochEntry
+   {
+      Rx3ObsEpochEntry()
+         : offset(0), epochFlag(0), numSVs(0)
+      {};
+
+         /// epoch time, in the time system of the header
+      CommonTime time;
+
+         /// byte offset of the epoch line ('>') in the file
+      size_t offset;
+
+         /// epoch flag, 0 or 1
+      short epochFlag;
+
+         /// number of satellites
+      short numSVs;
+   };
+
+   typedef std::vector<Rx3ObsEpochEntry> Rx3ObsEpochEntryVec;
+
+
+      /** Epoch index of a RINEX 3 observation file.
+       *
+       * Only observation epochs (flag 0 and 1) are indexed, so the epoch
+       * number n is the n-th observation epoch of the file. Auxiliary
+       * records (flag 2-6) are skipped by the scan.
+       *
+       * @code
+       *   Rx3ObsEpochIndex index;
+       *   index.loadOrBuild(obsFile, rxHeader);
+       *
+       *   rxData.pHeader = &rxHeader;
+       *   rxData.pIndex = &index;
+       *   rxData.seekTime(rxStream, firstEpoch);
+       *   rxStream >> rxData;
+       * @endcode
+       */
+   class Rx3ObsEpochIndex
+   {
+   public:
+
+         /// Default constructor
+      Rx3ObsEpochIndex()
+         : fileSize(0), fileTime(0)
+      {};
+
+         /// Scan the obs file and build the index. hdr is the header of
+         /// the file, it gives the version and the time system.
+      void build(const std::string& obsFile, const Rx3ObsHeader& hdr)
+         noexcept(false);
+
+         /// Write the index to a binary sidecar file
+      void save(const std::string& idxFile) const
+         noexcept(false);
+
+         /** Read the index from a sidecar file.
+          *
+          * @return false if the sidecar is missing, broken, or was
+          *         written for another version of the obs file.
+          */
+      bool load(const std::string& idxFile, const std::string& obsFile);
+
+         /** Load the index from the default sidecar file, or build it
+          *  and try to save the sidecar if it can't be loaded.
+          *  A sidecar which can't be written is silently ignored.
+          */
+      void loadOrBuild(const std::string& obsFile, const Rx3ObsHeader& hdr)
+         noexcept(false);
+
+         /// Default name of the sidecar file
+      static std::string sidecarName(const std::string& obsFile)
+      { return obsFile + ".eidx"; };
+
+         /// Number of indexed epochs
+      size_t size() const
+      { return entries.size(); };
+
+         /// Return true if no epoch is indexed
+      bool empty() const
+      { return entries.empty(); };
+
+         /// The n-th epoch
+      const Rx3ObsEpochEntry& operator[](size_t n) const
+      { return entries[n]; };
+
+         /// Number of the first epoch not earlier than t, size() if none.
+      size_t findEpoch(const CommonTime& t) const
+         noexcept(false);
+
+         /// Size of the obs file in bytes, also the end offset of the data
+      size_t getFileSize() const
+      { return fileSize; };
+
+         /// Destructor
+      virtual ~Rx3ObsEpochIndex() {};
+
+   private:
+
+         /// Size and modification time of the indexed obs file
+      static bool fileStatus(const std::string& obsFile,
+                             size_t& size,
+                             long long& mtime);
+
+      Rx3ObsEpochEntryVec entries;
+
+      size_t fileSize;
+      long long fileTime;
+
+   }; // End of class 'Rx3ObsEpochIndex'
+
+}  // End of namespace gnssSpace
+
+#endif   // Rx3ObsEpochIndex_HPP
@@ -0,0 +1,248 @@
+/**
+ * @file Rx3ObsPrefetcher.cpp
+ * Background reader which decodes observation epochs ahead of the solver.
+ */
+
+#include "Rx3ObsPrefetcher.hpp"
+
+#define debug 0
+
+using namespace std;
+
+namespace gnssSpace
+{
+
+   Rx3ObsPrefetcher::Rx3ObsPrefetcher(size_t depth, double tol)
+      : head(0), count(0),
+        tolerance(tol), matchedOnly(false),
+        stopping(false), finished(false)
+   {
+      ring.resize( (depth > 0) ? depth : 1 );
+   }
+
+
+   int Rx3ObsPrefetcher::addStream(Rx3ObsData& data, std::fstream& strm)
+   {
+      targets.push_back(&data);
+      strms.push_back(&strm);
+      mapped.push_back(NULL);
+
+      return targets.size()-1;
+   }
+
+
+   int Rx3ObsPrefetcher::addStream(Rx3ObsData& data, MappedFile& mf)
+   {
+      targets.push_back(&data);
+      strms.push_back(NULL);
+      mapped.push_back(&mf);
+
+      return targets.size()-1;
+   }
+
+
+   void Rx3ObsPrefetcher::start()
+      noexcept(false)
+   {
+      if(worker.joinable())
+      {
+         InvalidRequest e("Rx3ObsPrefetcher is already started");
+         THROW(e);
+      }
+
+      size_t n = targets.size();
+      if(n == 0)
+      {
+         InvalidRequest e("Rx3ObsPrefetcher: no stream is given");
+         THROW(e);
+      }
+
+      readers.resize(n);
+      for(size_t i=0; i<n; i++)
+      {
+         if(targets[i]->pHeader == NULL)
+         {
+            InvalidRequest e("Rx3ObsPrefetcher: pHeader of the stream is not set");
+            THROW(e);
+         }
+         readers[i].pHeader = targets[i]->pHeader;
+         readers[i].pIndex = targets[i]->pIndex;
+      }
+
+      for(size_t k=0; k<ring.size(); k++)
+      {
+         ring[k].present.assign(n, false);
+         ring[k].ended.assign(n, false);
+         ring[k].data.resize(n);
+      }
+      current.present.assign(n, false);
+      current.ended.assign(n, false);
+
+      head = 0;
+      count = 0;
+      stopping = false;
+      finished = false;
+      error = std::exception_ptr();
+
+      worker = std::thread(&Rx3ObsPrefetcher::run, this);
+
+   }  // End of method 'Rx3ObsPrefetcher::start()'
+
+
+   void Rx3ObsPrefetcher::run()
+   {
+      Rx3ObsEpochAligner aligner(tolerance);
+      for(size_t i=0; i<readers.size(); i++)
+      {
+         if(strms[i] != NULL)
+            aligner.addStream(readers[i], *strms[i]);
+         else
+            aligner.addStream(readers[i], *mapped[i]);
+      }
+
+      while(true)
+      {
+         Rx3ObsEpochAligner::Status status;
+         try
+         {
+            status = aligner.next();
+         }
+         catch(...)
+         {
+            // rethrown by next() in the solver thread
+            std::lock_guard<std::mutex> lock(mtx);
+            error = std::current_exception();
+            finished = true;
+            notEmpty.notify_one();
+            return;
+         }
+
+         if(status == Rx3ObsEpochAligner::End)
+         {
+            std::lock_guard<std::mutex> lock(mtx);
+            finished = true;
+            notEmpty.notify_one();
+            return;
+         }
+
+         if(matchedOnly && status != Rx3ObsEpochAligner::Matched)
+         {
+            continue;
+         }
+
+         std::unique_lock<std::mutex> lock(mtx);
+
+         if(count == ring.size())
+         {
+            stats.readerStalls++;
+            notFull.wait(lock, [this]{ return count < ring.size() || stopping; });
+         }
+
+         if(stopping)
+         {
+            return;
+         }
+
+         // the maps are swapped, not copied, the old maps of the slot
+         // are cleared when the aligner reads the next record
+         Slot& slot = ring[(head + count) % ring.size()];
+         slot.status = status;
+         for(size_t i=0; i<readers.size(); i++)
+         {
+            slot.present[i] = aligner.isPresent(i);
+            slot.ended[i] = aligner.isEnded(i);
+            if(slot.present[i])
+            {
+               slot.data[i].swapRecord(readers[i]);
+            }
+         }
+
+         count++;
+         notEmpty.notify_one();
+      }
+
+   }  // End of method 'Rx3ObsPrefetcher::run()'
+
+
+   Rx3ObsEpochAligner::Status Rx3ObsPrefetcher::next()
+      noexcept(false)
+   {
+      std::unique_lock<std::mutex> lock(mtx);
+
+      if(count == 0 && !finished)
+      {
+         stats.solverStalls++;
+         notEmpty.wait(lock, [this]{ return count > 0 || finished; });
+      }
+
+      if(count == 0)
+      {
+         if(error)
+         {
+            std::exception_ptr e = error;
+            error = std::exception_ptr();
+            std::rethrow_exception(e);
+         }
+
+         current.present.assign(current.present.size(), false);
+         current.ended.assign(current.ended.size(), true);
+         return Rx3ObsEpochAligner::End;
+      }
+
+      stats.epochs++;
+      stats.sumDepth += count;
+      if(count > stats.maxDepth) stats.maxDepth = count;
+
+      Slot& slot = ring[head];
+      for(size_t i=0; i<targets.size(); i++)
+      {
+         current.present[i] = slot.present[i];
+         current.ended[i] = slot.ended[i];
+         if(slot.present[i])
+         {
+            targets[i]->swapRecord(slot.data[i]);
+         }
+      }
+      Rx3ObsEpochAligner::Status status = slot.status;
+
+      head = (head + 1) % ring.size();
+      count--;
+      notFull.notify_one();
+
+      if(debug)
+      {
+         cout << "Rx3ObsPrefetcher: depth " << count+1 << endl;
+      }
+
+      return status;
+
+   }  // End of method 'Rx3ObsPrefetcher::next()'
+
+
+   void Rx3ObsPrefetcher::stop()
+   {
+      {
+         std::lock_guard<std::mutex> lock(mtx);
+         stopping = true;
+      }
+      notFull.notify_all();
+
+      if(worker.joinable())
+      {
+         worker.join();
+      }
+   }
+
+
+   void Rx3ObsPrefetcher::dumpStats(std::ostream& s) const
+   {
+      s << "prefetch: epochs " << stats.epochs
+        << " depth " << ring.size()
+        << " mean depth " << stats.meanDepth()
+        << " max depth " << stats.maxDepth
+        << " reader stalls " << stats.readerStalls
+        << " solver stalls " << stats.solverStalls
+        << endl;
+   }
+
+}  // End of namespace gnssSpace
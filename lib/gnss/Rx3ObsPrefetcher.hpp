@@ -0,0 +1,191 @@
+/**
+ * @file Rx3ObsPrefetcher.hpp
+ * Background reader which decodes observation epochs ahead of the solver.
+ *
+ * In rtk and spp the epoch N+1 is parsed only after epoch N went through
+ * spp, LsqRTK and lambda. This class moves the reading and the alignment
+ * of the streams (Rx3ObsEpochAligner) into a worker thread, which fills
+ * a bounded ring of reusable Rx3ObsData records while the main thread
+ * is solving, so that I/O and parsing overlap with the processing.
+ *
+ * The counters tell whether a run is parser-bound (the solver often
+ * waits for an empty ring) or solver-bound (the reader often waits for
+ * a full ring).
+ */
+
+#ifndef Rx3ObsPrefetcher_HPP
+#define Rx3ObsPrefetcher_HPP
+
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "Exception.hpp"
+#include "MappedFile.hpp"
+#include "Rx3ObsData.hpp"
+#include "Rx3ObsEpochAligner.hpp"
+
+namespace gnssSpace
+{
+
+      /// queue statistics of Rx3ObsPrefetcher
+   struct Rx3ObsPrefetchStats
+   {
+      Rx3ObsPrefetchStats()
+         : epochs(0), readerStalls(0), solverStalls(0),
+           maxDepth(0), sumDepth(0)
+      {};
+
+         /// number of epochs delivered by next()
+      unsigned long epochs;
+
+         /// the reader found the ring full (solver-bound)
+      unsigned long readerStalls;
+
+         /// next() found the ring empty (parser-bound)
+      unsigned long solverStalls;
+
+         /// maximum number of filled slots seen by next()
+      size_t maxDepth;
+
+         /// sum of the filled slots seen by next(), for the mean depth
+      unsigned long sumDepth;
+
+         /// mean number of filled slots seen by next()
+      double meanDepth() const
+      { return (epochs > 0) ? double(sumDepth)/epochs : 0.0; };
+   };
+
+
+      /** Prefetching reader for a rover and zero or more base streams.
+       *
+       * The streams are added as for Rx3ObsEpochAligner, with the
+       * Rx3ObsData objects the epochs are delivered to. The headers must
+       * be read and pHeader set before start(), and the streams must not
+       * be touched by the caller until the prefetcher is stopped.
+       *
+       * @code
+       *   Rx3ObsPrefetcher prefetcher(8, 5.0);
+       *   prefetcher.addStream(rxDataRover, rxStreamRover);
+       *   prefetcher.addStream(rxDataBase, rxStreamBase);
+       *   prefetcher.start();
+       *
+       *   while(true)
+       *   {
+       *      Rx3ObsEpochAligner::Status status = prefetcher.next();
+       *      if(status == Rx3ObsEpochAligner::End) break;
+       *      ...
+       *   }
+       *   prefetcher.dumpStats(cout);
+       * @endcode
+       */
+   class Rx3ObsPrefetcher
+   {
+   public:
+
+         /// Constructor with the number of ring slots and the tolerance
+         /// in seconds of the epoch alignment.
+      Rx3ObsPrefetcher(size_t depth = 8, double tol = 5.0);
+
+         /// Add a stream read with an fstream, the first one is the rover
+      int addStream(Rx3ObsData& data, std::fstream& strm);
+
+         /// Add a stream read from a MappedFile
+      int addStream(Rx3ObsData& data, MappedFile& mf);
+
+         /// Only deliver the epochs with rover and base data
+      Rx3ObsPrefetcher& setMatchedOnly(bool only)
+      { matchedOnly = only; return (*this); };
+
+         /// Start the reader thread
+      void start()
+         noexcept(false);
+
+         /** Deliver the next epoch into the Rx3ObsData objects of the
+          *  present streams, waiting for the reader if necessary.
+          *  A read error of the reader thread is rethrown here.
+          */
+      Rx3ObsEpochAligner::Status next()
+         noexcept(false);
+
+         /// Return true if stream i has data in the current epoch
+      bool isPresent(int i) const
+      { return current.present[i]; };
+
+         /// Return true if stream i had no more records after the
+         /// current epoch was read
+      bool isEnded(int i) const
+      { return current.ended[i]; };
+
+         /// Stop and join the reader thread
+      void stop();
+
+         /// Queue statistics
+      const Rx3ObsPrefetchStats& getStats() const
+      { return stats; };
+
+         /// Print the queue statistics
+      void dumpStats(std::ostream& s) const;
+
+         /// Destructor, stops the reader
+      virtual ~Rx3ObsPrefetcher()
+      { stop(); };
+
+   private:
+
+         /// one decoded epoch of all the streams
+      struct Slot
+      {
+         Slot() : status(Rx3ObsEpochAligner::End) {};
+
+         Rx3ObsEpochAligner::Status status;
+         std::vector<bool> present;
+         std::vector<bool> ended;
+         std::vector<Rx3ObsData> data;
+      };
+
+         /// the prefetcher is not copyable
+      Rx3ObsPrefetcher(const Rx3ObsPrefetcher&);
+      Rx3ObsPrefetcher& operator=(const Rx3ObsPrefetcher&);
+
+         /// body of the reader thread
+      void run();
+
+         /// objects the epochs are delivered to
+      std::vector<Rx3ObsData*> targets;
+
+         /// objects read by the aligner in the reader thread
+      std::vector<Rx3ObsData> readers;
+
+      std::vector<std::fstream*> strms;
+      std::vector<MappedFile*> mapped;
+
+      std::vector<Slot> ring;
+      size_t head;     ///< next slot to be delivered
+      size_t count;    ///< number of filled slots
+
+      Slot current;
+
+      double tolerance;
+      bool matchedOnly;
+
+      bool stopping;
+      bool finished;
+      std::exception_ptr error;
+
+      std::thread worker;
+      std::mutex mtx;
+      std::condition_variable notEmpty;
+      std::condition_variable notFull;
+
+      Rx3ObsPrefetchStats stats;
+
+   }; // End of class 'Rx3ObsPrefetcher'
+
+}  // End of namespace gnssSpace
+
+#endif   // Rx3ObsPrefetcher_HPP
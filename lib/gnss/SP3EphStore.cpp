@@ -51,6 +51,8 @@ namespace gnssSpace
         PositionRecord prec;
         ClockRecord crec;
 
+        if (streaming) updateStream(ttag);
+
         try
         { prec = posStore.getValue(sat, ttag); }
         catch (InvalidRequest &e)
@@ -88,6 +90,88 @@ namespace gnssSpace
         {RETHROW(e); }
     }
 
+    // Returns the Xvt of several satellites at the same time
+    int SP3EphStore::getXvtBatch(const std::vector<SatID>& sats,
+                                 const CommonTime& ttag,
+                                 std::vector<Xvt>& xvts,
+                                 std::vector<char>& valid)
+    {
+        xvts.resize(sats.size());
+        valid.assign(sats.size(), 0);
+
+        if (streaming) updateStream(ttag);
+
+        posStore.getPositionBatch(sats, ttag, batchPos, batchVel, batchPosValid);
+        clkStore.getClockBatch(sats, ttag, batchBias, batchDrift, batchClkValid);
+
+        // microsec -> sec for SP3, sec for RINEX clock
+        const double clkScale(useSP3clock ? 1.e-6 : 1.0);
+
+        int num(0);
+        for (size_t i = 0; i < sats.size(); i++)
+        {
+            if (!batchPosValid[i] || !batchClkValid[i]) continue;
+
+            Xvt& xvt(xvts[i]);
+            for (int j = 0; j < 3; j++)
+            {
+                xvt.x[j] = batchPos[3*i+j] * 1000.0;    // km -> m
+                xvt.v[j] = batchVel[3*i+j] * 0.1;       // dm/s -> m/s
+            }
+            xvt.clkbias = batchBias[i] * clkScale;
+            xvt.clkdrift = batchDrift[i] * clkScale;
+
+            xvt.computeRelativityCorrection();
+
+            valid[i] = 1;
+            num++;
+        }
+
+        return num;
+    }
+
+    // Returns the Xvt of several satellites, each one at its own time:
+    // the satellites are sorted by time, and each run of the same time
+    // is computed by the batch above
+    int SP3EphStore::getXvtBatch(const std::vector<SatID>& sats,
+                                 const std::vector<CommonTime>& times,
+                                 std::vector<Xvt>& xvts,
+                                 std::vector<char>& valid)
+    {
+        xvts.resize(sats.size());
+        valid.assign(sats.size(), 0);
+
+        batchOrder.resize(sats.size());
+        for (size_t i = 0; i < sats.size(); i++) batchOrder[i] = i;
+        std::stable_sort(batchOrder.begin(), batchOrder.end(),
+                         [&times](size_t a, size_t b)
+                         { return times[a] < times[b]; });
+
+        int num(0);
+        size_t k(0);
+        while (k < batchOrder.size())
+        {
+            const CommonTime& ttag(times[batchOrder[k]]);
+
+            batchSats.clear();
+            size_t end(k);
+            while (end < batchOrder.size() && times[batchOrder[end]] == ttag)
+                batchSats.push_back(sats[batchOrder[end++]]);
+
+            num += getXvtBatch(batchSats, ttag, batchXvts, batchValid);
+
+            for (size_t j = 0; j < batchSats.size(); j++)
+            {
+                xvts[batchOrder[k+j]] = batchXvts[j];
+                valid[batchOrder[k+j]] = batchValid[j];
+            }
+
+            k = end;
+        }
+
+        return num;
+    }
+
     // Determine the earliest time for which this object can successfully
     // determine the Xvt for any object.
     // return the earliest time in the table
@@ -564,6 +648,93 @@ namespace gnssSpace
         }
     }
 
+    // Streaming mode: the store is cleared, and the files are loaded by
+    // updateStream()
+    void SP3EphStore::setStreamFiles(const std::vector<std::string>& sp3Files,
+                                     const std::vector<std::string>& clkFiles)
+    {
+        clear();
+        SP3Files.clear();
+        this->clkFiles.clear();
+
+        if (clkFiles.empty()) useSP3ClockData();
+        else                  useRinexClockData();
+
+        streaming = !sp3Files.empty();
+        streamSP3Files = sp3Files;
+        streamClkFiles = clkFiles;
+        nextSP3File = nextClkFile = 0;
+
+        // the first call of updateStream() loads the first files
+        streamLoadTime = streamEvictTime = CommonTime::BEGINNING_OF_TIME;
+    }
+
+    // Streaming mode: load the files until the data reach the margin after
+    // ttag, and remove the data before the margin. The margin is known once
+    // there are data. The time is assumed to advance; a time before the
+    // data kept finds no data, as a time out of the files would.
+    void SP3EphStore::updateStream(const CommonTime& ttag)
+    noexcept(false)
+    {
+        if (!streaming ||
+            (ttag <= streamLoadTime && ttag <= streamEvictTime)) return;
+
+        try
+        {
+            while (nextSP3File < streamSP3Files.size() &&
+                   (posStore.ndata() == 0 ||
+                    posStore.getFinalTime() < ttag + getStreamMargin()))
+                loadSP3File(streamSP3Files[nextSP3File++]);
+
+            while (nextClkFile < streamClkFiles.size() &&
+                   (clkStore.ndata() == 0 ||
+                    clkStore.getFinalTime() < ttag + getStreamMargin()))
+                loadRinexClockFile(streamClkFiles[nextClkFile++]);
+
+            double margin(getStreamMargin());
+
+            // edit() keeps the last record before tmin
+            CommonTime tmin(ttag - margin);
+            posStore.edit(tmin);
+            clkStore.edit(tmin);
+
+            // nothing to do until ttag comes within the margin of the end
+            // of the data, or has advanced by another margin
+            streamLoadTime = CommonTime::END_OF_TIME;
+            if (nextSP3File < streamSP3Files.size() && posStore.ndata() > 0)
+                streamLoadTime = posStore.getFinalTime() - margin;
+            if (nextClkFile < streamClkFiles.size() && clkStore.ndata() > 0)
+            {
+                CommonTime t(clkStore.getFinalTime() - margin);
+                if (t < streamLoadTime) streamLoadTime = t;
+            }
+            streamEvictTime = ttag + margin;
+        }
+        catch (Exception &e)
+        {
+            RETHROW(e);
+        }
+    }
+
+    // Seconds of data needed on each side of a time by the interpolation
+    double SP3EphStore::getStreamMargin(void)
+    {
+        if (streamMargin > 0.0) return streamMargin;
+
+        double margin(0.0);
+        std::vector<SatID> sats(posStore.getSatList());
+        if (!sats.empty())
+            margin = (posStore.getInterpolationOrder()/2 + 1)
+                   * posStore.nomTimeStep(sats[0]);
+
+        sats = clkStore.getSatList();
+        if (!sats.empty())
+            margin = std::max(margin, (clkStore.getInterpolationOrder()/2 + 1)
+                                    * clkStore.nomTimeStep(sats[0]));
+
+        return margin;
+    }
+
     // Load a RINEX clock file; may set the 'have' bias and drift flags
     void SP3EphStore::loadRinexClockFile(const std::string &filename)
     noexcept(false)
@@ -695,6 +866,75 @@ namespace gnssSpace
         }
     }
 
+    // Save the position and clock tables to a binary snapshot
+    void SP3EphStore::saveSnapshot(const std::string &filename) const
+    noexcept(false)
+    {
+        BinarySnapshotWriter w("SP3EphStore");
+
+        w.beginSection("SP3STORE", 1);
+        w.putInt(storeTimeSystem.getTimeSystem());
+        w.putBool(useSP3clock);
+
+        posStore.writeSnapshot(w);
+        clkStore.writeSnapshot(w);
+
+        w.save(filename);
+    }
+
+    // Load a binary snapshot written by saveSnapshot()
+    void SP3EphStore::loadSnapshot(const std::string &filename)
+    noexcept(false)
+    {
+        try
+        {
+            BinarySnapshotReader r(filename, "SP3EphStore");
+
+            r.beginSection("SP3STORE");
+            TimeSystem ts((int)r.getInt());
+            bool sp3clock = r.getBool();
+
+            // check/save TimeSystem to storeTimeSystem, as loadSP3File()
+            if (ts != TimeSystem::Any && ts != TimeSystem::Unknown)
+            {
+                if (storeTimeSystem == TimeSystem::Any)
+                {
+                    storeTimeSystem = ts;
+                    posStore.setTimeSystem(ts);
+                    clkStore.setTimeSystem(ts);
+                }
+                else if (storeTimeSystem != ts)
+                {
+                    InvalidRequest ir("Time system of snapshot " + filename
+                                      + " (" + ts.asString()
+                                      + ") is incompatible with store time system ("
+                                      + storeTimeSystem.asString() + ").");
+                    THROW(ir);
+                }
+            }
+
+            if (!sp3clock) useRinexClockData();
+
+            posStore.readSnapshot(r);
+
+            if (sp3clock == useSP3clock)
+            {
+                clkStore.readSnapshot(r);
+            }
+            else
+            {
+                // SP3 clocks, not used by a store of RINEX clock data
+                ClockSatStore ignored;
+                ignored.readSnapshot(r);
+            }
+        }
+        catch (Exception &e)
+        {
+            e.addText("Error reading snapshot " + filename);
+            RETHROW(e);
+        }
+    }
+
     //@}
 
 using namespace utilSpace;
@@ -88,6 +88,28 @@ namespace gnssSpace
           * from RINEX clock files. */
         bool rejectPredClockFlag;
 
+         /// streaming mode (setStreamFiles()): the files in time order,
+         /// and the index of the next one to load
+        bool streaming;
+        std::vector<std::string> streamSP3Files, streamClkFiles;
+        size_t nextSP3File, nextClkFile;
+
+         /// seconds of data kept on each side of the processing time,
+         /// 0 to compute it from the time steps and orders
+        double streamMargin;
+
+         /// updateStream() has nothing to do until the processing time
+         /// passes either of these
+        CommonTime streamLoadTime, streamEvictTime;
+
+         /// work vectors of getXvtBatch(), kept to reuse their memory
+        std::vector<double> batchPos, batchVel, batchBias, batchDrift;
+        std::vector<char> batchPosValid, batchClkValid;
+        std::vector<size_t> batchOrder;
+        std::vector<SatID> batchSats;
+        std::vector<Xvt> batchXvts;
+        std::vector<char> batchValid;
+
          // member functions
 
          /** Private utility routine used by the loadFile and
@@ -99,6 +121,9 @@ namespace gnssSpace
         void loadSP3Store(const std::string& filename, bool fillClockStore)
             noexcept(false);
 
+         /// Margin of data kept in streaming mode, see setStreamMargin()
+        double getStreamMargin(void);
+
     public:
 
          /// Default constructor
@@ -107,7 +132,10 @@ namespace gnssSpace
                                       rejectBadPosFlag(true),
                                       rejectBadClockFlag(true),
                                       rejectPredPosFlag(false),
-                                      rejectPredClockFlag(false)
+                                      rejectPredClockFlag(false),
+                                      streaming(false),
+                                      nextSP3File(0), nextClkFile(0),
+                                      streamMargin(0.0)
         { }
 
          /// Destructor
@@ -127,6 +155,30 @@ namespace gnssSpace
         virtual Xvt getXvt(const SatID& sat, const CommonTime& ttag)
             noexcept(false);
 
+         /** Returns the Xvt of several satellites at the same time,
+          * as getXvt() computes them. The satellites on the same SP3
+          * (or clock) epochs share the interpolation interval and
+          * weights (PositionSatStore::getPositionBatch() and
+          * ClockSatStore::getClockBatch()).
+          * @param[in] sats the satellites of interest
+          * @param[in] ttag the time to look up
+          * @param[out] xvts the Xvt of each satellite
+          * @param[out] valid 1 if the Xvt of the satellite is computed,
+          *    0 if getXvt() would have thrown InvalidRequest
+          * @return the number of satellites computed */
+        int getXvtBatch(const std::vector<SatID>& sats,
+                        const CommonTime& ttag,
+                        std::vector<Xvt>& xvts,
+                        std::vector<char>& valid);
+
+         /** Returns the Xvt of several satellites, each one at its own
+          * time (XvtStore). The satellites with the same time are
+          * computed together, as above. */
+        virtual int getXvtBatch(const std::vector<SatID>& sats,
+                                const std::vector<CommonTime>& times,
+                                std::vector<Xvt>& xvts,
+                                std::vector<char>& valid);
+
          /** Dump information about the store to an ostream.
           * @param[in] os ostream to receive the output; defaults to std::cout
           * @param[in] detail integer level of detail to provide;
@@ -517,6 +569,63 @@ namespace gnssSpace
           * @throw if time step is inconsistent with previous value */
         void loadRinexClockFile(const std::string& filename) noexcept(false);
 
+         /** Streaming mode, for processing weeks of data: instead of
+          * loading all the files, give them in time order (e.g. the
+          * daily SP3 and RINEX clock files). The store then keeps only
+          * the data around the processing time: updateStream() loads
+          * the next files before the time reaches the end of the data,
+          * and removes the data older than the interpolation needs.
+          * getXvt() and getXvtBatch() call updateStream() themselves;
+          * call it before the other queries, e.g. once per epoch.
+          * The store is cleared, and if clock files are given the
+          * clocks are taken from them (useRinexClockData()).
+          * @param sp3Files the SP3 files, in time order; none to stop
+          *    streaming
+          * @param clkFiles the RINEX clock files, in time order, or
+          *    none for the SP3 clocks */
+        void setStreamFiles(const std::vector<std::string>& sp3Files,
+                            const std::vector<std::string>& clkFiles
+                               = std::vector<std::string>());
+
+         /** Streaming mode: load and remove data for the processing
+          * time ttag; the files are only read when ttag comes within
+          * the margin of the end of the data.
+          * @param[in] ttag the processing time
+          * @throw if a file can't be read, as loadSP3File() and
+          *    loadRinexClockFile() */
+        void updateStream(const CommonTime& ttag) noexcept(false);
+
+         /** Set the seconds of data kept on each side of the processing
+          * time in streaming mode. The default (0) is the half order of
+          * the interpolation plus one, times the time step, for both
+          * the positions and the clocks. */
+        void setStreamMargin(double seconds) throw()
+        { streamMargin = seconds; }
+
+         /// Is the store in streaming mode?
+        bool isStreaming(void) const throw()
+        { return streaming; }
+
+         /** Save the position and clock tables to a binary snapshot
+          * (BinarySnapshot.hpp). A batch job parses the SP3 and clock
+          * files once, and the runs call loadSnapshot() instead of
+          * loadSP3File() and loadRinexClockFile().
+          * @note the file headers (FileStore) are not saved.
+          * @param filename name of the snapshot to write
+          * @throw FileMissingException if the file can't be written */
+        void saveSnapshot(const std::string& filename) const noexcept(false);
+
+         /** Load a snapshot written by saveSnapshot(), as loading the
+          * SP3 and clock files again would. If the clocks of the
+          * snapshot are from RINEX clock files, this will call
+          * useRinexClockData(); if they are from SP3 files and the store
+          * uses RINEX clock data, they are ignored.
+          * @param filename name of the snapshot to load
+          * @throw FFStreamError if it is not a valid snapshot
+          * @throw InvalidRequest if the time system is incompatible
+          *  with the store time system */
+        void loadSnapshot(const std::string& filename) noexcept(false);
+
 
          /** Add a complete PositionRecord to the store; this is the
           * preferred method of adding data to the tables.
@@ -0,0 +1,109 @@
+/**
+ * @file SnapshotRecords.hpp
+ * Binary snapshot (BinarySnapshot.hpp) of the time, satellite and
+ * vector fields shared by the stores.
+ *
+ * A CommonTime is saved with its internal day, msod, fsod and time
+ * system, so it is restored exactly, without any conversion.
+ */
+
+#ifndef SnapshotRecords_HPP
+#define SnapshotRecords_HPP
+
+#include "BinarySnapshot.hpp"
+#include "CommonTime.hpp"
+#include "CivilTime.hpp"
+#include "TimeSystem.hpp"
+#include "Triple.hpp"
+#include "SatID.hpp"
+
+namespace gnssSpace
+{
+
+   inline void putTime(utilSpace::BinarySnapshotWriter& w,
+                       const timeSpace::CommonTime& t)
+   {
+      long day, msod;
+      double fsod;
+      timeSpace::TimeSystem ts;
+      t.getInternal(day, msod, fsod, ts);
+
+      w.putInt(day);
+      w.putInt(msod);
+      w.putDouble(fsod);
+      w.putInt(ts.getTimeSystem());
+   }
+
+   inline timeSpace::CommonTime getTime(utilSpace::BinarySnapshotReader& r)
+      noexcept(false)
+   {
+      long day = r.getInt();
+      long msod = r.getInt();
+      double fsod = r.getDouble();
+      int ts = r.getInt();
+
+      timeSpace::CommonTime t;
+      t.setInternal(day, msod, fsod, timeSpace::TimeSystem(ts));
+      return t;
+   }
+
+   inline void putCivilTime(utilSpace::BinarySnapshotWriter& w,
+                            const timeSpace::CivilTime& t)
+   {
+      w.putInt(t.year);
+      w.putInt(t.month);
+      w.putInt(t.day);
+      w.putInt(t.hour);
+      w.putInt(t.minute);
+      w.putDouble(t.second);
+      w.putInt(t.timeSystem.getTimeSystem());
+   }
+
+   inline timeSpace::CivilTime getCivilTime(utilSpace::BinarySnapshotReader& r)
+      noexcept(false)
+   {
+      timeSpace::CivilTime t;
+      t.year = r.getInt();
+      t.month = r.getInt();
+      t.day = r.getInt();
+      t.hour = r.getInt();
+      t.minute = r.getInt();
+      t.second = r.getDouble();
+      t.timeSystem = timeSpace::TimeSystem((int)r.getInt());
+      return t;
+   }
+
+   inline void putSat(utilSpace::BinarySnapshotWriter& w, const SatID& sat)
+   {
+      w.putInt(sat.system);
+      w.putInt(sat.id);
+   }
+
+   inline SatID getSat(utilSpace::BinarySnapshotReader& r)
+      noexcept(false)
+   {
+      int sys = r.getInt();
+      int id = r.getInt();
+      return SatID(static_cast<SatelliteSystem::Systems>(sys), id);
+   }
+
+   inline void putTriple(utilSpace::BinarySnapshotWriter& w,
+                         const mathSpace::Triple& v)
+   {
+      w.putDouble(v[0]);
+      w.putDouble(v[1]);
+      w.putDouble(v[2]);
+   }
+
+   inline mathSpace::Triple getTriple(utilSpace::BinarySnapshotReader& r)
+      noexcept(false)
+   {
+      double x = r.getDouble();
+      double y = r.getDouble();
+      double z = r.getDouble();
+      return mathSpace::Triple(x, y, z);
+   }
+
+}  // End of namespace gnssSpace
+
+#endif   // SnapshotRecords_HPP
@@ -6,9 +6,12 @@
 #define TABULAR_SAT_STORE_INCLUDE
 
 #include <map>
+#include <vector>
 #include <iostream>
 #include <cmath>
 #include <set>
+#include <atomic>
+#include <mutex>
 
 #include "Exception.hpp"
 #include "SatID.hpp"
@@ -96,6 +99,58 @@ namespace gnssSpace
 
       typedef typename DataTable::const_iterator DataTableIterator;
 
+      /// Largest nhalf interpolated on the uniform grids
+      static const unsigned int maxGridHalf = 10;
+
+      /// Dense copy of the table of a satellite whose records are on a
+      /// uniform time grid, as the SP3 and RINEX clock files. The record of
+      /// time t is at index (t - times[0])/step, and its values (see
+      /// putGridRecord()) at data[index*gridRecordSize()].
+      struct UniformGrid
+      {
+         double step;                        ///< seconds between records
+         std::vector<CommonTime> times;
+         std::vector<double> data;
+      };
+
+      /// Uniform grids of the satellites and the barycentric weights of
+      /// the interpolation. They are rebuilt by the first query after the
+      /// tables or the order have been changed, under the mutex, so the
+      /// queries may come from several threads; a copy of the store
+      /// rebuilds its own.
+      struct GridCache
+      {
+         GridCache()
+            : valid(false), rebuildAll(true), nhalf(0)
+         {};
+
+         GridCache(const GridCache& /*right*/)
+            : valid(false), rebuildAll(true), nhalf(0)
+         {};
+
+         GridCache& operator=(const GridCache& /*right*/)
+         {
+            std::lock_guard<std::mutex> lock(mtx);
+            rebuildAll = true;
+            valid = false;
+            return (*this);
+         };
+
+         std::mutex mtx;
+         std::atomic<bool> valid;
+         bool rebuildAll;                    ///< rebuild all the satellites
+         std::set<SatID> dirty;              ///< satellites to rebuild
+
+         /// satellites with a uniform grid only
+         std::map<SatID, UniformGrid> grids;
+
+         /// barycentric weights of the 2*nhalf equally spaced nodes
+         unsigned int nhalf;
+         double weights[2*maxGridHalf];
+      };
+
+      mutable GridCache gridCache;
+
    // member functions
    public:
 #pragma clang diagnostic push
@@ -569,6 +624,8 @@ namespace gnssSpace
       void edit(const CommonTime& tmin,
                 const CommonTime& tmax = CommonTime::END_OF_TIME) throw()
       {
+         gridChanged();
+
          // loop over satellites
          typename SatTable::iterator it;
          for(it=tables.begin(); it!=tables.end(); it++) {
@@ -592,6 +649,8 @@ namespace gnssSpace
 
       /// Remove all data and reset time limits
       inline void clear() throw() {
+         gridChanged();
+
          typename std::map<SatID, DataTable>::iterator satit;
          for(satit=tables.begin(); satit!=tables.end(); ++satit)
             satit->second.clear();
@@ -845,6 +904,244 @@ namespace gnssSpace
       /// set the store's time system
       void setTimeSystem(const TimeSystem& ts) throw() { storeTimeSystem = ts; }
 
+   protected:
+
+      /// Number of values of a record in the uniform grids; 0, the default,
+      /// if the derived class doesn't interpolate on grids
+      virtual int gridRecordSize() const
+         { return 0; }
+
+      /// Copy the values of a record to the uniform grid
+      virtual void putGridRecord(const DataRecord& /*rec*/,
+                                 double* /*values*/) const
+         { }
+
+      /// The table of sat has changed: its grid is rebuilt by the next query
+      void gridChanged(const SatID& sat)
+      {
+         gridCache.dirty.insert(sat);
+         gridCache.valid = false;
+      }
+
+      /// All the tables have changed
+      void gridChanged()
+      {
+         gridCache.rebuildAll = true;
+         gridCache.valid = false;
+      }
+
+      /// Return the uniform grid of sat, rebuilding the grids of the tables
+      /// changed since the last query, or NULL if the table of sat is not
+      /// uniform or the order nhalf is not supported, and the data tables
+      /// must be interpolated.
+      const UniformGrid* findGrid(const SatID& sat, unsigned int nhalf) const
+      {
+         if(nhalf < 1 || nhalf > maxGridHalf || gridRecordSize() == 0)
+            return 0;
+
+         if(!gridCache.valid.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(gridCache.mtx);
+
+            if(!gridCache.valid.load(std::memory_order_relaxed)) {
+               std::vector<SatID> sats;
+               if(gridCache.rebuildAll) {
+                  gridCache.grids.clear();
+                  for(typename SatTable::const_iterator it = tables.begin();
+                      it != tables.end(); ++it)
+                     sats.push_back(it->first);
+                  gridCache.rebuildAll = false;
+               }
+               else {
+                  sats.assign(gridCache.dirty.begin(), gridCache.dirty.end());
+               }
+               gridCache.dirty.clear();
+
+               for(size_t k=0; k<sats.size(); k++) {
+                  gridCache.grids.erase(sats[k]);
+                  buildGrid(sats[k]);
+               }
+
+               // barycentric weights of n equally spaced nodes,
+               // w[m] = (-1)^m C(n-1,m)
+               int n(2*nhalf);
+               gridCache.nhalf = nhalf;
+               gridCache.weights[0] = 1.0;
+               for(int m=1; m<n; m++)
+                  gridCache.weights[m] = -gridCache.weights[m-1]*(n-m)/m;
+
+               gridCache.valid.store(true, std::memory_order_release);
+            }
+         }
+
+         if(gridCache.nhalf != nhalf) return 0;
+
+         typename std::map<SatID, UniformGrid>::const_iterator
+            it(gridCache.grids.find(sat));
+         return (it == gridCache.grids.end() ? 0 : &it->second);
+      }
+
+      /// Locate ttag in the grid, as getTableInterval() does in the table:
+      /// same window, same checks and exceptions. This follows
+      /// getTableInterval() step by step, with the indexes of the grid in
+      /// place of the iterators of the table.
+      /// @param[out] first index of the first of the 2*nhalf records, or of
+      ///    the matching record if ttag is exact and exactReturn is true
+      /// @param[out] match index of the matching record if ttag is exact
+      /// @return true if ttag matches a time of the grid
+      bool getGridInterval(const UniformGrid& grid, const SatID& sat,
+                           const CommonTime& ttag, int nhalf, bool exactReturn,
+                           int& first, int& match) const
+         noexcept(false)
+      {
+         const int N(grid.times.size());
+
+         // lower bound of ttag, from its place on the grid
+         double k((ttag - grid.times[0])/grid.step);
+         int lo(k <= 0.0 ? 0 : (k >= N ? N : int(std::ceil(k))));
+         while(lo > 0 && !(grid.times[lo-1] < ttag)) --lo;
+         while(lo < N && grid.times[lo] < ttag) ++lo;
+
+         bool exactMatch(lo < N && !(ttag < grid.times[lo]));
+         match = lo;
+         if(exactMatch && exactReturn) {
+            first = lo;
+            return true;
+         }
+
+         int i1, i2;
+         if(nhalf == 1 && (lo <= 1 || lo == N)) {
+            // an interval of only 2, at either end of the table
+            i1 = (lo == N ? N-2 : 0);
+            i2 = i1+1;
+         }
+         else {
+            if(lo == 0)
+               gridError("Inadequate data before(1) requested time", sat, ttag);
+            if(lo-1 == 0)
+               gridError("Inadequate data before(2) requested time", sat, ttag);
+            if(lo == N)
+               gridError("Inadequate data after requested time", sat, ttag);
+
+            if(checkDataGap && grid.step > gapInterval)
+               gridError("Gap at interpolation time", sat, ttag);
+
+            // expand the interval to include 2*nhalf records
+            i1 = lo-1; i2 = lo;
+            for(int k=0; k<nhalf-1; k++) {
+               bool last(k==nhalf-2);
+               if(--i1 == 0 && !last)
+                  gridError("Inadequate data before(3) requested time", sat, ttag);
+               if(++i2 == N) {
+                  if(exactMatch && last && i1 != 0) { i2--; i1--; }
+                  else gridError("Inadequate data after(2) requested time",
+                                 sat, ttag);
+               }
+            }
+         }
+
+         if(checkInterval &&
+            ( ( std::abs(grid.times[i2] - grid.times[i1]) > maxInterval ) ||
+              ( std::abs(ttag           - grid.times[i1]) > maxInterval ) ||
+              ( std::abs(ttag           - grid.times[i2]) > maxInterval ) ) )
+            gridError("Interpolation interval too large", sat, ttag);
+
+         first = i1;
+         return exactMatch;
+      }
+
+      /// Lagrange basis L of the 2*nhalf records from first at ttag, and its
+      /// time derivative dL (1/s, not computed if dL is NULL), in the
+      /// barycentric form: with x in steps from the first record and
+      /// c[m] = w[m]/(x-m), L[m] = c[m]/SUM(c) and
+      /// dL[m]/dx = L[m]*(SUM(L[j]/(x-j)) - 1/(x-m)).
+      /// On the record k = match-first, L is 1 at k, and dL/dx the row k of
+      /// the differentiation matrix, (w[m]/w[k])/(k-m).
+      /// @param[in] match index of the record matching ttag, or -1
+      void getGridBasis(const UniformGrid& grid, const CommonTime& ttag,
+                        int nhalf, int first, int match,
+                        double* L, double* dL) const
+      {
+         const int n(2*nhalf);
+         const double *w(gridCache.weights);
+         double x((ttag - grid.times[first])/grid.step);
+
+         int k(match >= 0 ? match-first : -1);
+         for(int m=0; k < 0 && m<n; m++)
+            if(x == m) k = m;
+
+         if(k >= 0) {
+            double sum(0.0);
+            for(int m=0; m<n; m++) {
+               L[m] = 0.0;
+               if(dL && m != k) {
+                  dL[m] = (w[m]/w[k])/(k-m)/grid.step;
+                  sum += dL[m];
+               }
+            }
+            L[k] = 1.0;
+            if(dL) dL[k] = -sum;
+            return;
+         }
+
+         double S(0.0), R(0.0);
+         for(int m=0; m<n; m++) {
+            L[m] = w[m]/(x-m);
+            S += L[m];
+         }
+         for(int m=0; m<n; m++) {
+            L[m] /= S;
+            R += L[m]/(x-m);
+         }
+         if(dL)
+            for(int m=0; m<n; m++)
+               dL[m] = L[m]*(R - 1.0/(x-m))/grid.step;
+      }
+
+   private:
+
+      /// Copy the table of sat to its grid, if it is uniform
+      void buildGrid(const SatID& sat) const
+      {
+         typename SatTable::const_iterator itSat(tables.find(sat));
+         if(itSat == tables.end() || itSat->second.size() < 2) return;
+
+         const DataTable& dtable(itSat->second);
+         const int size(gridRecordSize());
+
+         UniformGrid grid;
+         grid.step = dtable.rbegin()->first - dtable.begin()->first;
+         grid.step /= (dtable.size()-1);
+         if(!(grid.step > 0.0)) return;
+
+         grid.times.reserve(dtable.size());
+         grid.data.resize(dtable.size()*size);
+
+         // keep the grid only if all the records are equally spaced
+         for(DataTableIterator it = dtable.begin(); it != dtable.end(); ++it)
+         {
+            if(!grid.times.empty() && it->first - grid.times.back() != grid.step)
+               return;
+
+            putGridRecord(it->second, &grid.data[grid.times.size()*size]);
+            grid.times.push_back(it->first);
+         }
+
+         UniformGrid& g(gridCache.grids[sat]);
+         g.step = grid.step;
+         g.times.swap(grid.times);
+         g.data.swap(grid.data);
+      }
+
+      /// Throw the same exceptions as getTableInterval()
+      static void gridError(const std::string& what, const SatID& sat,
+                            const CommonTime& ttag)
+         noexcept(false)
+      {
+         InvalidRequest e(what + " for satellite " + sat.toString()
+                          + ttag.asString());
+         THROW(e);
+      }
+
    };
 
 }  // End of namespace gnssSpace
@@ -12,6 +12,9 @@
  * add "MWC78", "MWC75", "MWC71"
  */
 
+#include <cstring>
+#include <vector>
+
 #include "TypeID.hpp"
 #include "Exception.hpp"
 
@@ -531,16 +534,87 @@ namespace gnssSpace
     };
 
 
+    namespace
+    {
+        // FNV-1a hash of the name
+        inline unsigned int hashName(const char* name, std::size_t len)
+        {
+            unsigned int h = 2166136261u;
+            for(std::size_t i=0; i<len; i++)
+            {
+                h ^= static_cast<unsigned char>(name[i]);
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        // Open-addressing table from the names of tStrings to the
+        // ValueType, built once on first use. The table is at least
+        // twice as large as tStrings, so the probe sequences are short.
+        class TypeNameIndex
+        {
+        public:
+
+            TypeNameIndex()
+            {
+                std::size_t size(64);
+                while(size < 2*TypeID::count) size <<= 1;
+
+                mask = size - 1;
+                slots.assign(size, -1);
+
+                for(int i=0; i<TypeID::count; i++)
+                {
+                    const std::string& name = TypeID::tStrings[i];
+
+                    // keep the first one of duplicated names, as the
+                    // linear search did
+                    if(find(name.c_str(), name.size()) >= 0) continue;
+
+                    std::size_t k = hashName(name.c_str(), name.size()) & mask;
+                    while(slots[k] >= 0) k = (k+1) & mask;
+                    slots[k] = i;
+                }
+            }
+
+            int find(const char* name, std::size_t len) const
+            {
+                std::size_t k = hashName(name, len) & mask;
+                while(slots[k] >= 0)
+                {
+                    const std::string& s = TypeID::tStrings[slots[k]];
+                    if( s.size() == len &&
+                        std::memcmp(s.data(), name, len) == 0 )
+                    {
+                        return slots[k];
+                    }
+                    k = (k+1) & mask;
+                }
+                return -1;
+            }
+
+        private:
+
+            std::vector<int> slots;
+            std::size_t mask;
+        };
+
+        const TypeNameIndex& typeNameIndex()
+        {
+            static const TypeNameIndex index;
+            return index;
+        }
+    }
+
+
     // Explicit constructor
     TypeID::TypeID(std::string name)
     {
-        for(int i=0; i<count; i++) 
+        int i = typeNameIndex().find(name.c_str(), name.size());
+        if(i >= 0)
         {
-           if(tStrings[i] == name ) 
-           {
-              type = static_cast<ValueType>(i);
-              return;
-           }
+            type = static_cast<ValueType>(i);
+            return;
         }
 
         // if it comes here, the type is unknown
@@ -554,6 +628,17 @@ namespace gnssSpace
     }
 
 
+    // Look up the ValueType of a name without throwing
+    bool TypeID::tryParse(const char* name, std::size_t len, TypeID& t)
+    {
+        int i = typeNameIndex().find(name, len);
+        if(i < 0) return false;
+
+        t.type = static_cast<ValueType>(i);
+        return true;
+    }
+
+
     // Assignment operator
     TypeID TypeID::operator=(const TypeID& right)
     {
@@ -581,9 +666,7 @@ namespace gnssSpace
     // convert this object to a string representation
     std::string TypeID::asString() const
     {
-        std::ostringstream oss;
-        oss << TypeID::tStrings[type];
-        return oss.str();
+        return TypeID::tStrings[type];
     }
 
 
@@ -601,6 +601,23 @@ namespace gnssSpace
         TypeID(std::string name);
 
 
+        /** Look up the ValueType of a name without throwing.
+         *
+         * The names are found with a hash table built once from tStrings,
+         * so the lookup takes constant time and allocates nothing.
+         *
+         * @param name  pointer to the first char of the name
+         * @param len   length of the name
+         * @param t     the TypeID found, unchanged if not found
+         * @return true if the name is a known type
+         */
+        static bool tryParse(const char* name, std::size_t len, TypeID& t);
+
+        /// Same as above for a std::string
+        static bool tryParse(const std::string& name, TypeID& t)
+        { return tryParse(name.c_str(), name.size(), t); };
+
+
         /// Equality requires all fields to be the same
         virtual bool operator==(const TypeID& right) const
         { return type==right.type; };
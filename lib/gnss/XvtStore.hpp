@@ -10,6 +10,7 @@
 #define XVTSTORE_INCLUDE
 
 #include <iostream>
+#include <vector>
 
 #include "Exception.hpp"
 #include "CommonTime.hpp"
@@ -45,6 +46,41 @@ namespace gnssSpace
       ///    information as to why the request failed.
       virtual Xvt getXvt(const IndexType& id, const CommonTime& t) = 0;
 
+      /// Returns the Xvt of several objects, each one at its own time.
+      /// The default implementation calls getXvt() for each object;
+      /// stores able to share the work among the objects override it.
+      /// @param[in] ids the objects' identifiers
+      /// @param[in] times the time to look up for each object
+      /// @param[out] xvts the Xvt of each object
+      /// @param[out] valid 1 if the Xvt of the object is computed, 0 if
+      ///    getXvt() would have thrown InvalidRequest
+      /// @return the number of objects computed
+      virtual int getXvtBatch(const std::vector<IndexType>& ids,
+                              const std::vector<CommonTime>& times,
+                              std::vector<Xvt>& xvts,
+                              std::vector<char>& valid)
+      {
+         xvts.resize(ids.size());
+         valid.assign(ids.size(), 0);
+
+         int num(0);
+         for(size_t i=0; i<ids.size(); i++)
+         {
+            try
+            {
+               xvts[i] = getXvt(ids[i], times[i]);
+               valid[i] = 1;
+               num++;
+            }
+            catch(InvalidRequest& e)
+            {
+               continue;
+            }
+         }
+
+         return num;
+      }
+
       /// A debugging function that outputs in human readable form,
       /// all data stored in this object.
       /// @param[in] s the stream to receive the output; defaults to cout
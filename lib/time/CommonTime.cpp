@@ -232,8 +232,11 @@ namespace timeSpace
          THROW( ir );
       }
 
-      return( SEC_PER_DAY * static_cast<double>( m_day  - right.m_day  ) +
-              SEC_PER_MS  * static_cast<double>( m_msod - right.m_msod ) +
+         // whole milliseconds as one 64-bit difference
+      long long ticks = static_cast<long long>( m_day - right.m_day ) * MS_PER_DAY
+                      + ( m_msod - right.m_msod );
+
+      return( SEC_PER_MS * static_cast<double>( ticks ) +
               m_fsod - right.m_fsod ) ;
    }
 
@@ -395,20 +398,18 @@ namespace timeSpace
    {
       std::numeric_limits<double> eps;
 
+         // milliseconds from the start of m_day as one 64-bit count: the
+         // carries of the fraction go into it, and it is split into days
+         // only when it leaves the day
+      long long ticks = m_msod;
+
       if( std::abs( m_fsod ) >= SEC_PER_MS - eps.epsilon() ) // allow for machine rounding errors
       {
          long ms = static_cast<long>( (m_fsod + eps.epsilon()) * MS_PER_SEC ); // again
-         m_msod += ms;
+         ticks += ms;
          m_fsod -= static_cast<double>( ms ) * SEC_PER_MS;
       }
 
-      if( std::abs( m_msod ) >= MS_PER_DAY )
-      {
-         long day = m_msod / MS_PER_DAY;
-         m_day  += day;
-         m_msod -= day * MS_PER_DAY;
-      }
-
       if( std::abs(m_fsod) < 1e-15 )
       {
          m_fsod = 0.0;
@@ -417,18 +418,21 @@ namespace timeSpace
       if( m_fsod < 0 )
       {
          m_fsod += SEC_PER_MS;
-         --m_msod;
+         --ticks;
       }
 
-      if( m_msod < 0 )
+      if( ticks < 0 || ticks >= MS_PER_DAY )
       {
-         m_msod = m_msod + MS_PER_DAY;
-         --m_day;
+         long long day = ticks / MS_PER_DAY;
+         ticks -= day * MS_PER_DAY;
+         if( ticks < 0 )
+         {
+            ticks += MS_PER_DAY;
+            --day;
+         }
+         m_day += static_cast<long>( day );
       }
-
-      // byte logic to repair fixed-point math
-      if ( m_fsod >= static_cast<double>(0.999) )
-         m_fsod -= static_cast<double>(0.999);
+      m_msod = static_cast<long>( ticks );
 
       return ( ( m_day >= BEGIN_LIMIT_JDAY ) &&
                ( m_day <  END_LIMIT_JDAY   ) );
@@ -1,3 +1,6 @@
+#include <atomic>
+#include <algorithm>
+
 #include "Exception.hpp"
 #include "ConvertTime.hpp"
 #include "TimeSystem.hpp"
@@ -6,6 +9,118 @@ using namespace timeSpace;
 
 namespace gnssSpace
 {
+   namespace
+   {
+      // Julian day (JD+0.5, as CommonTime) of the first day of a month of
+      // the Gregorian calendar, after Fliegel and van Flandern (1968)
+   constexpr long firstDayJD(int year, int month)
+   {
+      return 1 - 32075L
+             + 1461L*(year + 4800 + (month - 14)/12)/4
+             + 367L*(month - 2 - (month - 14)/12*12)/12
+             - 3L*((year + 4900 + (month - 14)/12)/100)/4;
+   }
+
+   static_assert(firstDayJD(2000, 1) == 2451545L, "firstDayJD");
+
+   struct LeapEntry
+   {
+      long jday;     // first day of UTC-TAI = nleap
+      int nleap;
+   };
+
+      // Leap seconds history, sorted by jday
+      // ***** This table must be updated for new leap seconds **************
+   constexpr LeapEntry leaps[] = {
+      { firstDayJD(1972, 1), 10 },
+      { firstDayJD(1972, 7), 11 },
+      { firstDayJD(1973, 1), 12 },
+      { firstDayJD(1974, 1), 13 },
+      { firstDayJD(1975, 1), 14 },
+      { firstDayJD(1976, 1), 15 },
+      { firstDayJD(1977, 1), 16 },
+      { firstDayJD(1978, 1), 17 },
+      { firstDayJD(1979, 1), 18 },
+      { firstDayJD(1980, 1), 19 },
+      { firstDayJD(1981, 7), 20 },
+      { firstDayJD(1982, 7), 21 },
+      { firstDayJD(1983, 7), 22 },
+      { firstDayJD(1985, 7), 23 },
+      { firstDayJD(1988, 1), 24 },
+      { firstDayJD(1990, 1), 25 },
+      { firstDayJD(1991, 1), 26 },
+      { firstDayJD(1992, 7), 27 },
+      { firstDayJD(1993, 7), 28 },
+      { firstDayJD(1994, 7), 29 },
+      { firstDayJD(1996, 1), 30 },
+      { firstDayJD(1997, 7), 31 },
+      { firstDayJD(1999, 1), 32 },
+      { firstDayJD(2006, 1), 33 },
+      { firstDayJD(2009, 1), 34 },
+      { firstDayJD(2012, 7), 35 },
+      { firstDayJD(2015, 7), 36 },
+      { firstDayJD(2017, 1), 37 },  // leave the last comma!
+      // add new entry here, of the form:
+      // { firstDayJD(year, month(1-12)), leap_sec }, // leave the last comma!
+   };
+
+   constexpr int NLEAPS = sizeof(leaps)/sizeof(leaps[0]);
+
+      // Entry found by the last search. The processing time moves slowly,
+      // so it is nearly always the entry of the next call; any value is a
+      // valid start, so the threads may share it without a lock.
+   std::atomic<int> lastLeap(NLEAPS-1);
+
+      // UTC-TAI leap seconds at the Julian day jday >= leaps[0].jday
+   int leapSecondsAt(long jday)
+   {
+      int i = lastLeap.load(std::memory_order_relaxed);
+      if( jday >= leaps[i].jday &&
+          (i == NLEAPS-1 || jday < leaps[i+1].jday) )
+         return leaps[i].nleap;
+
+      const LeapEntry* p = std::upper_bound(leaps, leaps + NLEAPS, jday,
+         [](long jd, const LeapEntry& e) { return jd < e.jday; });
+      i = static_cast<int>(p - leaps) - 1;
+      lastLeap.store(i, std::memory_order_relaxed);
+
+      return leaps[i].nleap;
+   }
+
+      // Seconds to add to a time of the system ts at the Julian day jday
+      // to get TAI, without the calendar. Only the systems with a fixed
+      // offset, and UTC and GLO after 1972, are handled here.
+      // @return false for the others, left to Correction()
+   bool offsetToTAI(const TimeSystem& ts, long jday, double& dt)
+   {
+      switch(ts.getTimeSystem())
+      {
+         case TimeSystem::GPS:
+         case TimeSystem::GAL:
+            dt = 19.;
+            return true;
+         case TimeSystem::BDT:
+            dt = 33.;
+            return true;
+         case TimeSystem::TAI:
+            dt = 0.;
+            return true;
+         case TimeSystem::TT:
+            dt = -32.184;
+            return true;
+         case TimeSystem::UTC:
+         case TimeSystem::GLO:
+            if(jday < leaps[0].jday) return false;
+            dt = double(leapSecondsAt(jday));
+            return true;
+         default:
+            return false;
+      }
+   }
+
+   }  // End of anonymous namespace
+
+
    CommonTime convertTimeSystem(const CommonTime& inCommonTime,
                             const TimeSystem& targetSys)
    {
@@ -16,6 +131,20 @@ namespace gnssSpace
        if(fromSys == targetSys)
            return outCommonTime;
 
+       // fast path: both offsets to TAI are known from the day alone
+       long day, msod;
+       double fsod;
+       inCommonTime.getInternal(day, msod, fsod);
+
+       double fromTAI, toTAI;
+       if( offsetToTAI(fromSys, day, fromTAI) &&
+           offsetToTAI(targetSys, day, toTAI) )
+       {
+           outCommonTime += fromTAI - toTAI;
+           outCommonTime.setTimeSystem(targetSys);
+           return outCommonTime;
+       }
+
        // first correct for leap seconds
        const CivilTime cvt(inCommonTime);
        double dt = Correction(fromSys, 
@@ -85,48 +214,7 @@ namespace gnssSpace
          { 1968,  2,  4.2131700, 0.0025920 }
       };
 
-      // Leap seconds history
-      // ***** This table must be updated for new leap seconds **************
-      static const struct {
-         int year, month, nleap;
-      } leaps[] = {
-         { 1972,  1, 10 },
-         { 1972,  7, 11 },
-         { 1973,  1, 12 },
-         { 1974,  1, 13 },
-         { 1975,  1, 14 },
-         { 1976,  1, 15 },
-         { 1977,  1, 16 },
-         { 1978,  1, 17 },
-         { 1979,  1, 18 },
-         { 1980,  1, 19 },
-         { 1981,  7, 20 },
-         { 1982,  7, 21 },
-         { 1983,  7, 22 },
-         { 1985,  7, 23 },
-         { 1988,  1, 24 },
-         { 1990,  1, 25 },
-         { 1991,  1, 26 },
-         { 1992,  7, 27 },
-         { 1993,  7, 28 },
-         { 1994,  7, 29 },
-         { 1996,  1, 30 },
-         { 1997,  7, 31 },
-         { 1999,  1, 32 },
-         { 2006,  1, 33 },
-         { 2009,  1, 34 },
-         { 2012,  7, 35 },
-         { 2015,  7, 36 },
-         { 2017,  1, 37 },// leave the last comma!
-         // add new entry here, of the form:
-         // { year, month(1-12), leap_sec }, // leave the last comma!
-      };
-
-      // the number of leaps (do not change this)
-      static const int NLEAPS = sizeof(leaps)/sizeof(leaps[0]);
-
-      // last year in leaps
-      //static const int MAXYEAR = leaps[NLEAPS-1].year;
+      // the leap seconds from 1972 are in the table 'leaps' above
 
       // END static data -----------------------------------------------------
 
@@ -151,11 +239,7 @@ namespace gnssSpace
          }
       }
       else {                                    // [1972- leap seconds
-         for(int i=NLEAPS-1; i>=0; i--) {
-            if(leaps[i].year > year ||
-               (leaps[i].year == year && leaps[i].month > month)) continue;
-            return double(leaps[i].nleap);
-         }
+         return double(leapSecondsAt(firstDayJD(year, month)));
       }
 
       return 0.0;
@@ -27,6 +27,9 @@ using namespace utilSpace;
 
 namespace gnssSpace
 {
+    /// Convert the time to the system targetSys. The offset between GPS,
+    /// GAL, BDT, TAI, TT, and UTC or GLO after 1972, is found from the day
+    /// alone, without the calendar; it is safe to call from several threads.
     CommonTime convertTimeSystem(const CommonTime& inCommonTime,
                              const TimeSystem& targetSys);
 
@@ -0,0 +1,215 @@
+/**
+ * @file BinarySnapshot.cpp
+ * Versioned binary snapshot of a loaded data store.
+ */
+
+#include <cstdio>
+#include <fstream>
+
+#include "BinarySnapshot.hpp"
+
+using namespace std;
+
+namespace utilSpace
+{
+
+   namespace
+   {
+      const char snapshotMagic[8] = { 'G','N','S','S','B','O','X','\n' };
+
+      const uint32_t snapshotByteOrder = 0x01020304;
+
+         /// magic, version, byte order, kind, payload size and checksum
+      const size_t snapshotHeaderSize = 8 + 4 + 4 + 16 + 8 + 8;
+
+         /// FNV-1a over the 64-bit words of the payload, which is always a
+         /// multiple of 8 bytes; a word at a time is much faster than the
+         /// bytes for the large clock snapshots
+      uint64_t fnv1a(const char* p, size_t n)
+      {
+         uint64_t h = 14695981039346656037ULL;
+         for(size_t i=0; i+8<=n; i+=8)
+         {
+            uint64_t w;
+            memcpy(&w, p+i, 8);
+            h ^= w;
+            h *= 1099511628211ULL;
+         }
+         return h;
+      }
+
+         /// tag padded with '\0' to 8 chars
+      void copyTag(char* dst, const std::string& tag, size_t n)
+      {
+         memset(dst, 0, n);
+         memcpy(dst, tag.c_str(), tag.size() < n ? tag.size() : n);
+      }
+   }
+
+
+   void BinarySnapshotWriter::beginSection(const std::string& tag,
+                                           uint64_t num)
+   {
+      char t[8];
+      copyTag(t, tag, 8);
+      append(t);
+      append(&num);
+
+   }  // End of method 'BinarySnapshotWriter::beginSection()'
+
+
+   void BinarySnapshotWriter::putString(const std::string& value)
+   {
+      putInt(value.size());
+
+      size_t n = (value.size() + 7) / 8 * 8;
+      payload.insert(payload.end(), value.begin(), value.end());
+      payload.insert(payload.end(), n - value.size(), '\0');
+
+   }  // End of method 'BinarySnapshotWriter::putString()'
+
+
+   void BinarySnapshotWriter::save(const std::string& file) const
+      noexcept(false)
+   {
+      char header[snapshotHeaderSize];
+      char* p = header;
+
+      memcpy(p, snapshotMagic, 8);                     p += 8;
+      memcpy(p, &snapshotFormatVersion, 4);            p += 4;
+      memcpy(p, &snapshotByteOrder, 4);                p += 4;
+      copyTag(p, kind, 16);                            p += 16;
+      uint64_t size = payload.size();
+      memcpy(p, &size, 8);                             p += 8;
+      uint64_t sum = fnv1a(payload.data(), payload.size());
+      memcpy(p, &sum, 8);
+
+      std::string tmpFile = file + ".tmp";
+      std::ofstream out(tmpFile.c_str(), ios::out | ios::binary | ios::trunc);
+      if(!out)
+      {
+         FileMissingException e("can't write snapshot:" + tmpFile);
+         THROW(e);
+      }
+
+      out.write(header, snapshotHeaderSize);
+      out.write(payload.data(), payload.size());
+      out.close();
+
+      if( !out || std::rename(tmpFile.c_str(), file.c_str()) != 0 )
+      {
+         std::remove(tmpFile.c_str());
+         FileMissingException e("can't write snapshot:" + file);
+         THROW(e);
+      }
+
+   }  // End of method 'BinarySnapshotWriter::save()'
+
+
+   BinarySnapshotReader::BinarySnapshotReader(const std::string& file,
+                                              const std::string& storeKind)
+      noexcept(false)
+      : cursor(NULL), end(NULL)
+   {
+      mapped.open(file);
+
+      const char* p = mapped.data();
+
+      if( mapped.size() < snapshotHeaderSize ||
+          memcmp(p, snapshotMagic, 8) != 0 )
+      {
+         FFStreamError e("not a snapshot file:" + file);
+         THROW(e);
+      }
+
+      uint32_t version, byteOrder;
+      memcpy(&version, p + 8, 4);
+      memcpy(&byteOrder, p + 12, 4);
+
+      if(byteOrder != snapshotByteOrder)
+      {
+         FFStreamError e("snapshot of another byte order:" + file);
+         THROW(e);
+      }
+
+      if(version != snapshotFormatVersion)
+      {
+         FFStreamError e("snapshot of another format version:" + file);
+         THROW(e);
+      }
+
+      char kind[16];
+      copyTag(kind, storeKind, 16);
+      if(memcmp(kind, p + 16, 16) != 0)
+      {
+         FFStreamError e("snapshot " + file + " is not of a " + storeKind);
+         THROW(e);
+      }
+
+      uint64_t size, sum;
+      memcpy(&size, p + 32, 8);
+      memcpy(&sum, p + 40, 8);
+
+      if( size != mapped.size() - snapshotHeaderSize ||
+          sum != fnv1a(p + snapshotHeaderSize, size) )
+      {
+         FFStreamError e("corrupted snapshot:" + file);
+         THROW(e);
+      }
+
+      cursor = p + snapshotHeaderSize;
+      end = cursor + size;
+
+   }  // End of constructor 'BinarySnapshotReader::BinarySnapshotReader()'
+
+
+   uint64_t BinarySnapshotReader::beginSection(const std::string& tag)
+      noexcept(false)
+   {
+      char t[8], expected[8];
+      extract(t);
+      copyTag(expected, tag, 8);
+
+      if(memcmp(t, expected, 8) != 0)
+      {
+         FFStreamError e("snapshot " + mapped.fileName +
+                         ": missing section " + tag);
+         THROW(e);
+      }
+
+      uint64_t num;
+      extract(&num);
+
+      return num;
+
+   }  // End of method 'BinarySnapshotReader::beginSection()'
+
+
+   std::string BinarySnapshotReader::getString()
+      noexcept(false)
+   {
+      int64_t len = getInt();
+      int64_t n = (len + 7) / 8 * 8;
+
+      if(len < 0 || end - cursor < n)
+      {
+         truncated();
+      }
+
+      std::string value(cursor, len);
+      cursor += n;
+
+      return value;
+
+   }  // End of method 'BinarySnapshotReader::getString()'
+
+
+   void BinarySnapshotReader::truncated() const
+      noexcept(false)
+   {
+      FFStreamError e("truncated snapshot:" + mapped.fileName);
+      THROW(e);
+
+   }  // End of method 'BinarySnapshotReader::truncated()'
+
+}  // End of namespace utilSpace
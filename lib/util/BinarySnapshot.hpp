@@ -0,0 +1,168 @@
+/**
+ * @file BinarySnapshot.hpp
+ * Versioned binary snapshot of a loaded data store.
+ *
+ * Parsing the text RINEX navigation, SP3 and clock files is the main
+ * part of the start-up of a run. A batch job can parse them once and
+ * save the stores to a snapshot, which the station runs then load by
+ * mapping the file and copying the records, without any text
+ * conversion.
+ *
+ * The file has a fixed header followed by the payload:
+ *
+ * @code
+ *   char     magic[8]      "GNSSBOX\n"
+ *   uint32   version       snapshotFormatVersion
+ *   uint32   byteOrder     0x01020304 as written by the host
+ *   char     kind[16]      type of the store, e.g. "Rx3NavStore"
+ *   uint64   payloadSize   bytes after the header
+ *   uint64   checksum      FNV-1a of the 64-bit words of the payload
+ * @endcode
+ *
+ * The payload is a list of sections, each a tag of 8 chars and the
+ * number of entries (e.g. satellites), followed by the entries. All the
+ * values are 8 bytes long (integers as int64, reals as IEEE double,
+ * strings as a length and 8-byte padded chars), so the records of a
+ * table have a fixed size and are aligned in the mapping. A snapshot is
+ * only read on a host with the same byte order, and the version is
+ * increased whenever the layout of a record changes, so an old snapshot
+ * is rejected instead of being misread.
+ */
+
+#ifndef BinarySnapshot_HPP
+#define BinarySnapshot_HPP
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+#include "Exception.hpp"
+#include "MappedFile.hpp"
+
+namespace utilSpace
+{
+
+      /// Version of the layout of the snapshots
+   const uint32_t snapshotFormatVersion = 1;
+
+      /** Writer of a snapshot. The payload is built in memory, then
+       * written at once by save().
+       *
+       * @code
+       *   BinarySnapshotWriter writer("Rx3NavStore");
+       *   writer.beginSection("GPSEPH", num);
+       *   writer.putDouble(eph.af0);
+       *   ...
+       *   writer.save("nav.snap");
+       * @endcode
+       */
+   class BinarySnapshotWriter
+   {
+   public:
+
+         /// @param storeKind  type of the store, at most 15 chars
+      explicit BinarySnapshotWriter(const std::string& storeKind)
+         : kind(storeKind)
+      {};
+
+         /// Start a section of num entries
+      void beginSection(const std::string& tag, uint64_t num);
+
+      void putInt(int64_t value)
+      { append(&value); };
+
+      void putDouble(double value)
+      { append(&value); };
+
+      void putBool(bool value)
+      { putInt(value ? 1 : 0); };
+
+      void putString(const std::string& value);
+
+         /// Bytes of the payload written so far
+      size_t size() const
+      { return payload.size(); };
+
+         /// Write the snapshot. It is written to a temporary file first
+         /// and renamed, so a reader never sees a partial snapshot.
+         /// @throw FileMissingException if the file can't be written
+      void save(const std::string& file) const
+         noexcept(false);
+
+   private:
+
+      void append(const void* p)
+      {
+         size_t n = payload.size();
+         payload.resize(n + 8);
+         std::memcpy(&payload[n], p, 8);
+      };
+
+      std::string kind;
+      std::vector<char> payload;
+
+   }; // End of class 'BinarySnapshotWriter'
+
+
+      /** Reader of a snapshot. The file is mapped, and the header and the
+       * checksum are checked by the constructor; the values are then read
+       * in the order they were written.
+       */
+   class BinarySnapshotReader
+   {
+   public:
+
+         /// Map the snapshot and check that it is a valid snapshot of the
+         /// given kind
+         /// @throw FileMissingException if the file can't be mapped
+         /// @throw FFStreamError if it is not a snapshot of this kind and
+         ///        version, or it is corrupted
+      BinarySnapshotReader(const std::string& file,
+                           const std::string& storeKind)
+         noexcept(false);
+
+         /// Start the next section, which must have the given tag
+         /// @return number of entries of the section
+      uint64_t beginSection(const std::string& tag)
+         noexcept(false);
+
+      int64_t getInt() noexcept(false)
+      { int64_t v; extract(&v); return v; };
+
+      double getDouble() noexcept(false)
+      { double v; extract(&v); return v; };
+
+      bool getBool() noexcept(false)
+      { return getInt() != 0; };
+
+      std::string getString() noexcept(false);
+
+         /// Return true when the whole payload has been read
+      bool atEnd() const
+      { return cursor == end; };
+
+   private:
+
+      void extract(void* p) noexcept(false)
+      {
+         if(end - cursor < 8)
+         {
+            truncated();
+         }
+         std::memcpy(p, cursor, 8);
+         cursor += 8;
+      };
+
+         /// @throw FFStreamError
+      void truncated() const noexcept(false);
+
+      MappedFile mapped;
+      const char* cursor;
+      const char* end;
+
+   }; // End of class 'BinarySnapshotReader'
+
+}  // End of namespace utilSpace
+
+#endif   // BinarySnapshot_HPP
@@ -0,0 +1,120 @@
+/**
+ * @file MappedFile.cpp
+ * Read-only memory-mapped file with a line cursor.
+ */
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MappedFile.hpp"
+
+using namespace std;
+
+namespace utilSpace
+{
+
+   void MappedFile::open(const std::string& file)
+      noexcept(false)
+   {
+      close();
+
+      int fd = ::open(file.c_str(), O_RDONLY);
+      if(fd < 0)
+      {
+         FileMissingException e("can't open file:" + file);
+         THROW(e);
+      }
+
+      struct stat st;
+      if(fstat(fd, &st) != 0)
+      {
+         ::close(fd);
+         FileMissingException e("can't stat file:" + file);
+         THROW(e);
+      }
+
+      length = static_cast<size_t>(st.st_size);
+
+      // mmap refuses zero-length mappings, an empty file is simply at eof
+      if(length > 0)
+      {
+         void* p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+         if(p == MAP_FAILED)
+         {
+            ::close(fd);
+            length = 0;
+            FileMissingException e("can't map file:" + file);
+            THROW(e);
+         }
+
+         // the file is read from the beginning to the end
+         madvise(p, length, MADV_SEQUENTIAL);
+
+         pData = static_cast<const char*>(p);
+      }
+
+      // the mapping stays valid after the descriptor is closed
+      ::close(fd);
+
+      fileName = file;
+      cursor = 0;
+      opened = true;
+
+   }  // End of method 'MappedFile::open()'
+
+
+   void MappedFile::close()
+   {
+      if(pData != NULL)
+      {
+         munmap(const_cast<char*>(pData), length);
+      }
+
+      pData = NULL;
+      length = 0;
+      cursor = 0;
+      opened = false;
+      fileName.clear();
+   }
+
+
+   bool MappedFile::getLine(const char*& line, size_t& len)
+   {
+      if(cursor >= length)
+      {
+         line = NULL;
+         len = 0;
+         return false;
+      }
+
+      line = pData + cursor;
+
+      const char* pEnd = static_cast<const char*>(
+                           memchr(line, '\n', length - cursor));
+
+      if(pEnd == NULL)
+      {
+         // last line without '\n'
+         len = length - cursor;
+         cursor = length;
+      }
+      else
+      {
+         len = pEnd - line;
+         cursor += len + 1;
+      }
+
+      // DOS line endings
+      if(len > 0 && line[len-1] == '\r')
+      {
+         len--;
+      }
+
+      return true;
+
+   }  // End of method 'MappedFile::getLine()'
+
+}  // End of namespace utilSpace
@@ -0,0 +1,113 @@
+/**
+ * @file MappedFile.hpp
+ * Read-only memory-mapped file with a line cursor.
+ *
+ * The whole file is mapped into the address space once, and lines are
+ * returned as (pointer, length) pairs pointing into the mapping, so no
+ * std::string is built for each line as getline() does. It is used by
+ * Rx3ObsData for the zero-copy observation reader.
+ */
+
+#ifndef MappedFile_HPP
+#define MappedFile_HPP
+
+#include <string>
+#include <cstddef>
+
+#include "Exception.hpp"
+
+namespace utilSpace
+{
+
+      /** This class maps a whole file read-only into memory.
+       *
+       * A typical way to use this class follows:
+       *
+       * @code
+       *   MappedFile mf("obs.rnx");
+       *
+       *   const char* line;
+       *   size_t len;
+       *   while( mf.getLine(line, len) )
+       *   {
+       *      // parse [line, line+len)
+       *   }
+       * @endcode
+       */
+   class MappedFile
+   {
+   public:
+
+         /// Default constructor
+      MappedFile()
+         : pData(NULL), length(0), cursor(0), opened(false)
+      {};
+
+         /// Map the given file
+      MappedFile(const std::string& file)
+         noexcept(false)
+         : pData(NULL), length(0), cursor(0), opened(false)
+      { open(file); };
+
+         /// Map the given file read-only, the cursor is set to the beginning.
+      void open(const std::string& file)
+         noexcept(false);
+
+         /// Unmap the file
+      void close();
+
+         /// Return true if a file is mapped
+      bool isOpen() const
+      { return opened; };
+
+         /// Pointer to the first byte of the mapping
+      const char* data() const
+      { return pData; };
+
+         /// Size of the mapped file in bytes
+      size_t size() const
+      { return length; };
+
+         /// Current byte offset of the line cursor
+      size_t tell() const
+      { return cursor; };
+
+         /// Move the line cursor to the given byte offset
+      void seek(size_t pos)
+      { cursor = (pos > length) ? length : pos; };
+
+         /// Return true when the cursor reached the end of the file
+      bool eof() const
+      { return cursor >= length; };
+
+         /** Return the next line in place and advance the cursor.
+          *
+          * @param line  pointer to the first char of the line
+          * @param len   length of the line, without '\n' and '\r'
+          * @return false if the end of the file has been reached
+          */
+      bool getLine(const char*& line, size_t& len);
+
+         /// Name of the mapped file
+      std::string fileName;
+
+         /// Destructor
+      virtual ~MappedFile()
+      { close(); };
+
+   private:
+
+         /// the mapping is not copyable
+      MappedFile(const MappedFile&);
+      MappedFile& operator=(const MappedFile&);
+
+      const char* pData;
+      size_t length;
+      size_t cursor;
+      bool opened;
+
+   }; // End of class 'MappedFile'
+
+}  // End of namespace utilSpace
+
+#endif   // MappedFile_HPP
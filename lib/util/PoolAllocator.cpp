@@ -0,0 +1,34 @@
+/**
+ * @file PoolAllocator.cpp
+ * Counters of the node pools.
+ */
+
+#include "PoolAllocator.hpp"
+
+namespace utilSpace
+{
+
+   namespace poolDetail
+   {
+      std::atomic<unsigned long> heapAllocations(0);
+      std::atomic<unsigned long> bytesReserved(0);
+      std::atomic<unsigned long> nodeAllocations(0);
+      std::atomic<unsigned long> nodeReleases(0);
+      std::atomic<unsigned long> heapFallbacks(0);
+   }
+
+
+   PoolStats getPoolStats()
+   {
+      PoolStats stats;
+
+      stats.heapAllocations = poolDetail::heapAllocations;
+      stats.bytesReserved   = poolDetail::bytesReserved;
+      stats.nodeAllocations = poolDetail::nodeAllocations;
+      stats.nodeReleases    = poolDetail::nodeReleases;
+      stats.heapFallbacks   = poolDetail::heapFallbacks;
+
+      return stats;
+   }
+
+}  // End of namespace utilSpace
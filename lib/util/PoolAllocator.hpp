@@ -0,0 +1,346 @@
+/**
+ * @file PoolAllocator.hpp
+ * Node-recycling allocator for the std::map based GDS structures.
+ *
+ * typeValueMap and satTypeValueMap allocate one node per satellite and
+ * per type, and release them again when the epoch is cleared. With this
+ * allocator the released nodes go to a free list of their size instead
+ * of the heap, so clearing an epoch keeps the memory for the next one,
+ * and in the steady state no heap allocation is done at all.
+ *
+ * Memory is taken from the heap in chunks and never given back. Each
+ * thread keeps its own free list of every node size, so allocating and
+ * releasing a node takes no lock. The threads exchange nodes with a
+ * shared list, under a mutex, in batches only: an epoch may be filled in
+ * one thread (Rx3ObsPrefetcher) and cleared in another, and the nodes a
+ * thread holds when it exits go back to the shared list.
+ *
+ * getPoolStats() returns the counters, e.g. to check in long runs that
+ * heapAllocations stops growing after the first epochs. The node
+ * counters are collected when a thread exchanges a batch, so they may
+ * lag behind by a batch per thread.
+ */
+
+#ifndef PoolAllocator_HPP
+#define PoolAllocator_HPP
+
+#include <cstddef>
+#include <new>
+#include <mutex>
+#include <atomic>
+
+namespace utilSpace
+{
+
+      /// counters of all the node pools
+   struct PoolStats
+   {
+         /// chunks taken from the heap by the pools
+      unsigned long heapAllocations;
+
+         /// bytes taken from the heap by the pools
+      unsigned long bytesReserved;
+
+         /// nodes handed out by the pools
+      unsigned long nodeAllocations;
+
+         /// nodes given back to the pools
+      unsigned long nodeReleases;
+
+         /// array requests (n > 1) passed through to the heap
+      unsigned long heapFallbacks;
+   };
+
+      /// Return the current counters of the node pools
+   PoolStats getPoolStats();
+
+
+   namespace poolDetail
+   {
+      extern std::atomic<unsigned long> heapAllocations;
+      extern std::atomic<unsigned long> bytesReserved;
+      extern std::atomic<unsigned long> nodeAllocations;
+      extern std::atomic<unsigned long> nodeReleases;
+      extern std::atomic<unsigned long> heapFallbacks;
+
+
+         /// Free lists of nodes of one size, shared by all the allocators
+         /// of that node size: one list per thread, and a shared list
+         /// the threads exchange batches of nodes with.
+      template <std::size_t NodeSize>
+      class FixedPool
+      {
+      public:
+
+            /// The pool is never destroyed, so maps with static storage
+            /// can still release their nodes at exit.
+         static FixedPool& instance()
+         {
+            static FixedPool* pPool = new FixedPool;
+            return *pPool;
+         }
+
+         void* get()
+         {
+            LocalList& local( localList() );
+
+            if(local.head == NULL)
+            {
+               if(local.dead)
+               {
+                  return getShared();
+               }
+
+               takeBatch(local);
+            }
+
+            FreeNode* p = local.head;
+            local.head = p->next;
+            local.count--;
+            local.allocations++;
+
+            return p;
+         }
+
+         void put(void* p)
+         {
+            LocalList& local( localList() );
+
+            if(local.dead)
+            {
+               putShared(p);
+               return;
+            }
+
+            FreeNode* node = static_cast<FreeNode*>(p);
+            node->next = local.head;
+            local.head = node;
+            local.count++;
+            local.releases++;
+
+               // the nodes released by a thread which doesn't allocate
+               // them, e.g. the solver clearing the epochs of the reader
+            if(local.count >= 2*batchNodes)
+            {
+               giveBatch(local, batchNodes);
+            }
+         }
+
+      private:
+
+         struct FreeNode
+         {
+            FreeNode* next;
+         };
+
+            /// free list of a thread. It is trivially destructible, so it
+            /// can still be used by the maps released after the thread
+            /// exit, see Flusher.
+         struct LocalList
+         {
+            FreeNode* head;
+            std::size_t count;
+            unsigned long allocations;
+            unsigned long releases;
+            bool dead;
+         };
+
+            /// gives the nodes of the thread back to the shared list at
+            /// the thread exit; the thread then uses the shared list
+         struct Flusher
+         {
+            ~Flusher()
+            {
+               LocalList& local( localList() );
+               instance().giveBatch(local, local.count);
+               local.dead = true;
+            }
+         };
+
+            /// node size rounded up to the largest fundamental alignment
+         static const std::size_t align = 16;
+         static const std::size_t nodeBytes =
+            ((NodeSize < sizeof(FreeNode) ? sizeof(FreeNode) : NodeSize)
+             + align - 1) / align * align;
+
+            /// nodes per chunk
+         static const std::size_t chunkNodes = 256;
+
+            /// nodes moved at once between a thread and the shared list
+         static const std::size_t batchNodes = 64;
+
+         FixedPool()
+            : freeList(NULL)
+         {};
+
+         static LocalList& localList()
+         {
+            static thread_local LocalList local = { NULL, 0, 0, 0, false };
+            static thread_local Flusher flusher;
+            (void)flusher;
+            return local;
+         }
+
+            /// move a batch of nodes from the shared list to the thread
+         void takeBatch(LocalList& local)
+         {
+            std::lock_guard<std::mutex> lock(mtx);
+
+            for(std::size_t i=0; i<batchNodes; i++)
+            {
+               if(freeList == NULL)
+               {
+                  refill();
+               }
+
+               FreeNode* node = freeList;
+               freeList = node->next;
+               node->next = local.head;
+               local.head = node;
+            }
+            local.count += batchNodes;
+
+            collect(local);
+         }
+
+            /// move n nodes of the thread to the shared list
+         void giveBatch(LocalList& local, std::size_t n)
+         {
+            std::lock_guard<std::mutex> lock(mtx);
+
+            for(std::size_t i=0; i<n; i++)
+            {
+               FreeNode* node = local.head;
+               local.head = node->next;
+               node->next = freeList;
+               freeList = node;
+            }
+            local.count -= n;
+
+            collect(local);
+         }
+
+         void* getShared()
+         {
+            std::lock_guard<std::mutex> lock(mtx);
+
+            if(freeList == NULL)
+            {
+               refill();
+            }
+
+            FreeNode* p = freeList;
+            freeList = p->next;
+
+            nodeAllocations++;
+
+            return p;
+         }
+
+         void putShared(void* p)
+         {
+            std::lock_guard<std::mutex> lock(mtx);
+
+            FreeNode* node = static_cast<FreeNode*>(p);
+            node->next = freeList;
+            freeList = node;
+
+            nodeReleases++;
+         }
+
+            /// add the counters of the thread to the global ones
+         void collect(LocalList& local)
+         {
+            nodeAllocations += local.allocations;
+            nodeReleases += local.releases;
+            local.allocations = 0;
+            local.releases = 0;
+         }
+
+         void refill()
+         {
+            char* chunk = static_cast<char*>(
+                             ::operator new(nodeBytes*chunkNodes));
+
+            heapAllocations++;
+            bytesReserved += nodeBytes*chunkNodes;
+
+            for(std::size_t i=0; i<chunkNodes; i++)
+            {
+               FreeNode* node = reinterpret_cast<FreeNode*>(chunk + i*nodeBytes);
+               node->next = freeList;
+               freeList = node;
+            }
+         }
+
+         FreeNode* freeList;
+         std::mutex mtx;
+
+      }; // End of class 'FixedPool'
+
+   }  // End of namespace poolDetail
+
+
+      /** Standard allocator taking single nodes from FixedPool.
+       *
+       * @code
+       *   std::map<int, double, std::less<int>,
+       *            PoolAllocator<std::pair<const int, double> > > m;
+       * @endcode
+       */
+   template <class T>
+   class PoolAllocator
+   {
+   public:
+
+      typedef T value_type;
+
+      template <class U>
+      struct rebind
+      {
+         typedef PoolAllocator<U> other;
+      };
+
+      PoolAllocator() noexcept {};
+
+      template <class U>
+      PoolAllocator(const PoolAllocator<U>&) noexcept {};
+
+      T* allocate(std::size_t n)
+      {
+         if(n == 1)
+         {
+            return static_cast<T*>(
+                      poolDetail::FixedPool<sizeof(T)>::instance().get());
+         }
+
+         poolDetail::heapFallbacks++;
+         return static_cast<T*>(::operator new(n*sizeof(T)));
+      }
+
+      void deallocate(T* p, std::size_t n)
+      {
+         if(n == 1)
+         {
+            poolDetail::FixedPool<sizeof(T)>::instance().put(p);
+            return;
+         }
+
+         ::operator delete(p);
+      }
+
+   }; // End of class 'PoolAllocator'
+
+
+      /// all the PoolAllocators share the same pools
+   template <class T, class U>
+   bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+   { return true; }
+
+   template <class T, class U>
+   bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+   { return false; }
+
+}  // End of namespace utilSpace
+
+#endif   // PoolAllocator_HPP
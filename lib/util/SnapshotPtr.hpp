@@ -0,0 +1,235 @@
+/**
+ * @file SnapshotPtr.hpp
+ * Pointer to an immutable snapshot, read without locks and replaced by
+ * the writers, with epoch-based reclamation of the old snapshots.
+ *
+ * A reader pins the current global epoch in one of the reader slots,
+ * then loads the pointer; it only reads the snapshot, and unpins when
+ * done (ReadGuard). A writer builds a new snapshot from the current one,
+ * swaps the pointer and retires the old snapshot with the epoch of the
+ * swap. The readers that may still see a retired snapshot are pinned at
+ * an epoch not later than its retirement, so the snapshot is deleted
+ * once all the pinned epochs are later, or no reader is pinned.
+ *
+ * The readers never wait for the writers and never write to the
+ * snapshot or to a shared counter: they only CAS their own slot. If more
+ * readers than slots are active at once, the extra ones yield until a
+ * slot is free. The writers are serialized by a mutex.
+ *
+ * @code
+ *   SnapshotPtr<Data> data(new Data);
+ *
+ *   // reader, any thread
+ *   {
+ *      SnapshotPtr<Data>::ReadGuard snap(data);
+ *      use(snap->value);
+ *   }
+ *
+ *   // writer
+ *   data.update([&](const Data& old) { Data* p = new Data(old);
+ *                                      p->value = 1; return p; });
+ * @endcode
+ */
+
+#ifndef SnapshotPtr_HPP
+#define SnapshotPtr_HPP
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+namespace utilSpace
+{
+
+   template <class T>
+   class SnapshotPtr
+   {
+   public:
+
+         /// number of readers pinned at the same time without waiting
+      static const int numSlots = 64;
+
+         /// Take the ownership of the first snapshot
+      explicit SnapshotPtr(T* initial)
+         : current(initial), globalEpoch(1)
+      {
+         for(int i=0; i<numSlots; i++)
+         {
+            slots[i].epoch.store(0);
+         }
+      };
+
+         /// No reader may be active any more
+      ~SnapshotPtr()
+      {
+         delete current.load();
+
+         for(size_t i=0; i<retired.size(); i++)
+         {
+            delete retired[i].second;
+         }
+      };
+
+
+         /// Read access to the current snapshot, valid until the guard
+         /// is destroyed. The guard is owned by one thread.
+      class ReadGuard
+      {
+      public:
+
+         explicit ReadGuard(const SnapshotPtr& owner)
+            : pSlot(owner.pin()), ptr(owner.current.load())
+         {};
+
+         ~ReadGuard()
+         {
+            pSlot->store(0);
+         };
+
+         const T* get() const
+         { return ptr; };
+
+         const T& operator*() const
+         { return *ptr; };
+
+         const T* operator->() const
+         { return ptr; };
+
+      private:
+
+         ReadGuard(const ReadGuard&);
+         ReadGuard& operator=(const ReadGuard&);
+
+         std::atomic<unsigned long>* pSlot;
+         const T* ptr;
+
+      }; // End of class 'ReadGuard'
+
+
+         /** Publish a new snapshot made from the current one.
+          *
+          * @param makeNext  returns the new snapshot, allocated with new,
+          *                  from the current one
+          */
+      void update(const std::function<T*(const T&)>& makeNext)
+      {
+         std::lock_guard<std::mutex> lock(writeMtx);
+
+         T* next = makeNext(*current.load());
+
+         T* old = current.exchange(next);
+
+         // the readers pinned until now may hold old
+         unsigned long epoch = globalEpoch.fetch_add(1);
+         retired.push_back(std::make_pair(epoch, old));
+
+         reclaim();
+      };
+
+         /// Delete the retired snapshots no reader can hold. This is also
+         /// done by every update().
+      void collect()
+      {
+         std::lock_guard<std::mutex> lock(writeMtx);
+         reclaim();
+      };
+
+         /// Retired snapshots not deleted yet
+      size_t numRetired() const
+      {
+         std::lock_guard<std::mutex> lock(writeMtx);
+         return retired.size();
+      };
+
+         /// Number of snapshots published by update()
+      unsigned long numUpdates() const
+      { return globalEpoch.load() - 1; };
+
+   private:
+
+      SnapshotPtr(const SnapshotPtr&);
+      SnapshotPtr& operator=(const SnapshotPtr&);
+
+         /// reader slot on its own cache line, 0 if free, otherwise the
+         /// epoch the reader is pinned at
+      struct Slot
+      {
+         std::atomic<unsigned long> epoch;
+         char pad[64 - sizeof(std::atomic<unsigned long>)];
+      };
+
+         /// Pin the current epoch in a free slot
+      std::atomic<unsigned long>* pin() const
+      {
+         // start from a slot of the thread, so the threads don't fight
+         // for the same slots
+         size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+         while(true)
+         {
+            unsigned long epoch = globalEpoch.load();
+
+            for(int k=0; k<numSlots; k++)
+            {
+               std::atomic<unsigned long>& slot
+                  = slots[(start+k) % numSlots].epoch;
+
+               unsigned long expected(0);
+               if( slot.load() == 0 &&
+                   slot.compare_exchange_strong(expected, epoch) )
+               {
+                  return &slot;
+               }
+            }
+
+            std::this_thread::yield();
+         }
+      };
+
+         /// Delete the retired snapshots older than all the pinned epochs,
+         /// the caller holds writeMtx
+      void reclaim()
+      {
+         unsigned long minEpoch(~0ul);
+         for(int i=0; i<numSlots; i++)
+         {
+            unsigned long epoch = slots[i].epoch.load();
+            if(epoch != 0 && epoch < minEpoch) minEpoch = epoch;
+         }
+
+         size_t k(0);
+         for(size_t i=0; i<retired.size(); i++)
+         {
+            if(retired[i].first < minEpoch)
+            {
+               delete retired[i].second;
+            }
+            else
+            {
+               retired[k++] = retired[i];
+            }
+         }
+         retired.resize(k);
+      };
+
+      std::atomic<T*> current;
+
+         /// incremented by each update
+      mutable std::atomic<unsigned long> globalEpoch;
+
+      mutable Slot slots[numSlots];
+
+         /// snapshots replaced, with the epoch of the replacement
+      std::vector< std::pair<unsigned long, T*> > retired;
+
+      mutable std::mutex writeMtx;
+
+   }; // End of class 'SnapshotPtr'
+
+}  // End of namespace utilSpace
+
+#endif   // SnapshotPtr_HPP